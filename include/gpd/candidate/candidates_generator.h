@@ -49,6 +49,7 @@
 #include <gpd/candidate/hand_search.h>
 #include <gpd/candidate/hand_set.h>
 #include <gpd/util/config_file.h>
+#include <gpd/util/voxel_map.h>
 
 namespace gpd {
 namespace candidate {
@@ -72,6 +73,11 @@ class CandidatesGenerator {
     bool sample_above_plane_;  ///< if samples are drawn above the support plane
     bool voxelize_;            ///< if the point cloud gets voxelized
     double voxel_size_;        ///< voxel size
+    int voxelize_method_ = 1;  ///< voxelization method (0: ordered set, 1:
+                               ///< parallel voxel grid)
+    bool incremental_preprocessing_ = false;  ///< if the normals are only
+                                              ///< recalculated where the cloud
+                                              ///< changed (needs voxelize_)
     double normals_radius_;    ///< neighborhood search radius used for normal
                                ///< estimation
     int refine_normals_k_;  ///< If 0, do not refine. If > 0, this is the number
@@ -81,6 +87,9 @@ class CandidatesGenerator {
     std::vector<double> workspace_;  ///< the robot's workspace
   };
 
+  static const int VOXELIZE_SET;  ///< voxelize with an ordered set (reference)
+  static const int VOXELIZE_PARALLEL;  ///< voxelize with a parallel voxel grid
+
   /**
    * \brief Constructor.
    * \param params the parameters to be used for the candidate generation
@@ -111,6 +120,26 @@ class CandidatesGenerator {
   std::vector<std::unique_ptr<HandSet>> generateGraspCandidateSets(
       const util::Cloud &cloud_cam);
 
+  /**
+   * \brief Generate grasp candidate sets at given samples.
+   * \param cloud_cam the point cloud
+   * \param samples the samples (a subset of the cloud's samples)
+   * \return list of grasp candidate sets
+   */
+  std::vector<std::unique_ptr<HandSet>> generateGraspCandidateSets(
+      const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples) const {
+    return hand_search_->searchHands(cloud_cam, samples);
+  }
+
+  /**
+   * \brief Return the samples of a point cloud as 3D points.
+   * \param cloud_cam the point cloud
+   * \return the samples
+   */
+  Eigen::Matrix3Xd getSamples(const util::Cloud &cloud_cam) const {
+    return hand_search_->collectSamples(cloud_cam);
+  }
+
   /**
    * \brief Reevaluate grasp candidates on a given point cloud.
    * \param cloud the point cloud
@@ -119,6 +148,18 @@ class CandidatesGenerator {
   std::vector<int> reevaluateHypotheses(
       const util::Cloud &cloud, std::vector<std::unique_ptr<Hand>> &grasps);
 
+  /**
+   * \brief Reevaluate grasp candidates on a given point cloud, and return
+   * which of them are still collision-free and contain points in their
+   * closing region.
+   * \param cloud the point cloud
+   * \param grasps the grasps to evaluate
+   * \param[out] is_valid if each grasp passed the collision check
+   */
+  std::vector<int> reevaluateHypotheses(
+      const util::Cloud &cloud, std::vector<std::unique_ptr<Hand>> &grasps,
+      Eigen::Array<bool, 1, Eigen::Dynamic> &is_valid);
+
   /**
    * \brief Set the number of samples.
    * \param num_samples the number of samples
@@ -135,6 +176,7 @@ class CandidatesGenerator {
 
  private:
   std::unique_ptr<candidate::HandSearch> hand_search_;
+  std::unique_ptr<util::VoxelMap> voxel_map_;  ///< voxels of the last cloud
 
   Parameters params_;
 };
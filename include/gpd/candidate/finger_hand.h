@@ -76,8 +76,8 @@ class FingerHand {
    * \param idx if this is larger than -1, only check the <idx>-th finger
    * placement
    */
-  void evaluateFingers(const Eigen::Matrix3Xd &points, double bite,
-                       int idx = -1);
+  void evaluateFingers(const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+                       double bite, int idx = -1);
 
   /**
    * \brief Chhose the middle among all valid finger placements.
@@ -97,8 +97,8 @@ class FingerHand {
    * object
    * \return the index of the middle finger placement
    */
-  int deepenHand(const Eigen::Matrix3Xd &points, double min_depth,
-                 double max_depth, double deepen_step);
+  int deepenHand(const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+                 double min_depth, double max_depth, double deepen_step);
 
   /**
    * \brief Compute which of the given points are located in the closing region
@@ -108,8 +108,8 @@ class FingerHand {
    * placement
    * \return the points that are located in the closing region
    */
-  std::vector<int> computePointsInClosingRegion(const Eigen::Matrix3Xd &points,
-                                                int idx = -1);
+  std::vector<int> computePointsInClosingRegion(
+      const Eigen::Ref<const Eigen::Matrix3Xd> &points, int idx = -1);
 
   /**
    * \brief Check which 2-finger placements are feasible.
@@ -240,14 +240,30 @@ class FingerHand {
 
  private:
   /**
-   * \brief Check that a given finger does not collide with the point cloud.
+   * \brief Calculate which finger placements are occupied by the points.
+   *
+   * Finds, for each finger placement, the smallest forward coordinate among
+   * the points in between the finger's sides. A finger placement collides
+   * with the points cropped at a given bite iff that coordinate is smaller
+   * than the bite. This is done once per orientation, so that evaluating the
+   * fingers at a different bite (see deepenHand()) is O(1) per placement.
+   *
    * \param points the points to be checked for collision (size: 3 x n)
-   * \param indices the indices of the points to be checked for collision
-   * \param idx the index of the finger to be checked
-   * \return true if it does not collide, false if it collides
+   * \param max_forward the largest bite that the occupancy is used for
+   * \param idx if this is larger than -1, only calculate the occupancy of the
+   * <idx>-th finger placement and its opposite finger
+   */
+  void calculateOccupancy(const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+                          double max_forward, int idx);
+
+  /**
+   * \brief Find possible finger placements from the occupancy calculated by
+   * calculateOccupancy().
+   * \param bite how far the robot can be moved into the object
+   * \param idx if this is larger than -1, only check the <idx>-th finger
+   * placement
    */
-  bool isGapFree(const Eigen::Matrix3Xd &points,
-                 const std::vector<int> &indices, int idx);
+  void evaluateOccupancy(double bite, int idx);
 
   int forward_axis_;  ///< the index of the horizontal axis in the hand frame
                       ///(grasp approach direction)
@@ -258,6 +274,10 @@ class FingerHand {
   double hand_depth_;    ///< the hand depth (finger length)
 
   Eigen::VectorXd finger_spacing_;  ///< the possible finger placements
+  Eigen::VectorXd finger_min_forward_;  ///< the smallest forward coordinate
+                                        /// of the points at each finger
+                                        /// placement
+  double min_forward_;  ///< the smallest forward coordinate of the points
   Eigen::Array<bool, 1, Eigen::Dynamic>
       fingers_;  ///< indicates the feasible fingers
   Eigen::Array<bool, 1, Eigen::Dynamic>
@@ -36,12 +36,13 @@
 
 #include <Eigen/Dense>
 
-#include <pcl/kdtree/kdtree.h>
+#include <pcl/search/kdtree.h>
 
 #include <omp.h>
 
 #include <gpd/candidate/local_frame.h>
 #include <gpd/util/cloud.h>
+#include <gpd/util/neighborhood.h>
 
 namespace gpd {
 namespace candidate {
@@ -74,7 +75,7 @@ class FrameEstimator {
    */
   std::vector<LocalFrame> calculateLocalFrames(
       const util::Cloud &cloud_cam, const std::vector<int> &indices,
-      double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const;
+      double radius, const util::KdTreeRGB &kdtree) const;
 
   /**
    * \brief Calculate local reference frames given a list of (x,y,z) samples.
@@ -86,7 +87,24 @@ class FrameEstimator {
    */
   std::vector<LocalFrame> calculateLocalFrames(
       const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples,
-      double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const;
+      double radius, const util::KdTreeRGB &kdtree) const;
+
+  /**
+   * \brief Calculate local reference frames given a list of (x,y,z) samples
+   * and their point neighborhoods.
+   *
+   * Each neighborhood must contain at least one point within <radius>.
+   * \param cloud_cam the point cloud
+   * \param samples the list of (x,y,z) samples
+   * \param neighborhoods the point neighborhood of each sample
+   * \param radius the radius of the point neighborhood used for the frames
+   * \return the list of local reference frames (one for each sample)
+   */
+  std::vector<LocalFrame> calculateLocalFrames(
+      const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples,
+      const std::vector<std::shared_ptr<const util::Neighborhood>>
+          &neighborhoods,
+      double radius) const;
 
   /**
    * \brief Calculate a local reference frame given a list of surface normals.
@@ -98,7 +116,7 @@ class FrameEstimator {
    */
   std::unique_ptr<LocalFrame> calculateFrame(
       const Eigen::Matrix3Xd &normals, const Eigen::Vector3d &sample,
-      double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const;
+      double radius, const util::KdTreeRGB &kdtree) const;
 
  private:
   /**
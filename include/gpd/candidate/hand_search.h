@@ -36,7 +36,7 @@
 
 #include <pcl/features/normal_3d_omp.h>
 #include <pcl/filters/random_sample.h>
-#include <pcl/kdtree/kdtree.h>
+#include <pcl/search/kdtree.h>
 #include <pcl/point_cloud.h>
 
 #include <omp.h>
@@ -50,6 +50,7 @@
 #include <gpd/candidate/hand_geometry.h>
 #include <gpd/candidate/hand_set.h>
 #include <gpd/candidate/local_frame.h>
+#include <gpd/util/neighborhood.h>
 #include <gpd/util/plot.h>
 #include <gpd/util/point_list.h>
 
@@ -77,6 +78,11 @@ class HandSearch {
     /** LRF estimation parameters */
     double nn_radius_frames_;  ///< radius for point neighborhood search for LRF
 
+    /** neighborhood caching */
+    double nn_radius_images_ = 0.0;  ///< radius of the point neighborhoods
+                                     ///< cached for the image generation (0:
+                                     ///< do not cache)
+
     /** grasp candidate generation */
     int num_threads_;             ///< the number of CPU threads to be used
     int num_samples_;             ///< the number of samples to be used
@@ -107,6 +113,22 @@ class HandSearch {
   std::vector<std::unique_ptr<candidate::HandSet>> searchHands(
       const util::Cloud &cloud) const;
 
+  /**
+   * \brief Search robot hand configurations at given samples.
+   * \param cloud the point cloud
+   * \param samples the samples (a subset of the cloud's samples)
+   * \return list of grasp candidate sets
+   */
+  std::vector<std::unique_ptr<candidate::HandSet>> searchHands(
+      const util::Cloud &cloud, const Eigen::Matrix3Xd &samples) const;
+
+  /**
+   * \brief Return the samples of a point cloud as 3D points.
+   * \param cloud the point cloud
+   * \return the samples, empty if the cloud has no samples or indices
+   */
+  Eigen::Matrix3Xd collectSamples(const util::Cloud &cloud) const;
+
   /**
    * \brief Reevaluate a list of grasp candidates.
    * \note Used to calculate ground truth.
@@ -119,6 +141,22 @@ class HandSearch {
       std::vector<std::unique_ptr<candidate::Hand>> &grasps,
       bool plot_samples = false) const;
 
+  /**
+   * \brief Reevaluate a list of grasp candidates, and return which of them
+   * are still collision-free and contain points in their closing region.
+   * \param cloud_cam the point cloud
+   * \param grasps the list of grasp candidates
+   * \param[out] is_valid if each grasp candidate passed the collision check,
+   * independent of its label
+   * \param plot_samples if the samples are plotted
+   * \return the list of reevaluated grasp candidates
+   */
+  std::vector<int> reevaluateHypotheses(
+      const util::Cloud &cloud_cam,
+      std::vector<std::unique_ptr<candidate::Hand>> &grasps,
+      Eigen::Array<bool, 1, Eigen::Dynamic> &is_valid,
+      bool plot_samples = false) const;
+
   /**
    * \brief Return the parameters for the hand search.
    * \return params the hand search parameters
@@ -132,18 +170,33 @@ class HandSearch {
   void setParameters(const Parameters &params) { params_ = params; }
 
  private:
+  /**
+   * \brief Find the point neighborhood of each sample.
+   *
+   * Runs one radius search per sample at the largest radius used by any stage
+   * (LRF estimation, hand search, image generation).
+   * \param samples the list of (x,y,z) samples
+   * \param radius the search radius
+   * \param kdtree the KDTree object used for fast neighborhood search
+   * \return the point neighborhood of each sample
+   */
+  std::vector<std::shared_ptr<const util::Neighborhood>> findNeighborhoods(
+      const Eigen::Matrix3Xd &samples, double radius,
+      const util::KdTreeRGB &kdtree) const;
+
   /**
    * \brief Search robot hand configurations given a list of local reference
    * frames.
    * \param cloud_cam the point cloud
    * \param frames the list of local reference frames
-   * \param kdtree the KDTree object used for fast neighborhood search
+   * \param neighborhoods the point neighborhood of each frame
    * \return the list of robot hand configurations
    */
   std::vector<std::unique_ptr<candidate::HandSet>> evalHands(
       const util::Cloud &cloud_cam,
       const std::vector<candidate::LocalFrame> &frames,
-      const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const;
+      const std::vector<std::shared_ptr<const util::Neighborhood>>
+          &neighborhoods) const;
 
   /**
    * \brief Reevaluate a grasp candidate.
@@ -45,7 +45,6 @@
 #include <boost/random/taus88.hpp>
 #include <boost/random/uniform_real.hpp>
 #include <boost/random/variate_generator.hpp>
-#include <boost/unordered_set.hpp>
 
 // Eigen
 #include <Eigen/Dense>
@@ -58,39 +57,14 @@
 #include <gpd/candidate/hand_geometry.h>
 #include <gpd/candidate/local_frame.h>
 #include <gpd/util/config_file.h>
+#include <gpd/util/neighborhood.h>
+#include <gpd/util/occlusion_grid.h>
+#include <gpd/util/occlusion_volume.h>
 #include <gpd/util/point_list.h>
 
-// The hash and equality functions below are necessary for boost's unordered
-// set.
-namespace boost {
-template <>
-struct hash<Eigen::Vector3i> {
-  inline size_t operator()(Eigen::Vector3i const &v) const {
-    std::size_t seed = 0;
-
-    for (int i = 0; i < v.size(); i++) {
-      boost::hash_combine(seed, v(i));
-    }
-
-    return seed;
-  }
-};
-}  // namespace boost
-
 namespace gpd {
 namespace candidate {
 
-struct Vector3iEqual {
-  inline bool operator()(const Eigen::Vector3i &a,
-                         const Eigen::Vector3i &b) const {
-    return a(0) == b(0) && a(1) == b(1) && a(2) == b(2);
-  }
-};
-
-typedef boost::unordered_set<Eigen::Vector3i, boost::hash<Eigen::Vector3i>,
-                             Vector3iEqual, std::allocator<Eigen::Vector3i>>
-    Vector3iSet;
-
 /**
  *
  * \brief Calculate a set of grasp candidates.
@@ -133,16 +107,6 @@ class HandSet {
   void evalHandSet(const util::PointList &point_list,
                    const LocalFrame &local_frame);
 
-  /**
-   * \brief Calculate grasp candidates for a given rotation axis.
-   * \param point_list the point neighborhood
-   * \param local_frame the local reference frame
-   * \param axis the index of the rotation axis
-   * \param start the index of the first free element in `hands_`
-   */
-  void evalHands(const util::PointList &point_list,
-                 const LocalFrame &local_frame, int axis, int start);
-
   /**
    * \brief Calculate the "shadow" of the point neighborhood.
    * \param point_list the point neighborhood
@@ -151,6 +115,19 @@ class HandSet {
   Eigen::Matrix3Xd calculateShadow(const util::PointList &point_list,
                                    double shadow_length) const;
 
+  /**
+   * \brief Crop the "shadow" of the point neighborhood from the occlusion
+   * volumes of the scene.
+   * \param shadows the occlusion volume of each camera
+   * \param point_list the point neighborhood
+   * \param radius the distance from the sample up to which the shadow is
+   * cropped
+   * \return the shadow points
+   */
+  Eigen::Matrix3Xd calculateShadow(
+      const std::vector<util::OcclusionVolume> &shadows,
+      const util::PointList &point_list, double radius) const;
+
   /**
    * \brief Return the grasps contained in this grasp set.
    * \return the grasps contained in this grasp set
@@ -181,6 +158,23 @@ class HandSet {
    */
   void setSample(const Eigen::Vector3d &sample) { sample_ = sample; }
 
+  /**
+   * \brief Return the cached point neighborhood of the sample.
+   * \return the point neighborhood (null if no neighborhood is cached)
+   */
+  const std::shared_ptr<const util::Neighborhood> &getNeighborhood() const {
+    return neighborhood_;
+  }
+
+  /**
+   * \brief Cache the point neighborhood of the sample for later stages.
+   * \param neighborhood the point neighborhood
+   */
+  void setNeighborhood(
+      const std::shared_ptr<const util::Neighborhood> &neighborhood) {
+    neighborhood_ = neighborhood;
+  }
+
   /**
    * \brief Return a list of booleans that indicate for each grasp if it is
    * valid or not.
@@ -206,32 +200,33 @@ class HandSet {
    */
   void setIsValidWithIndex(int idx, bool val) { is_valid_[idx] = val; }
 
+  static const double SHADOW_VOXEL_SIZE;  ///< the voxel size of the shadows
+
  private:
   /**
-   * \brief Calculate shadow for one camera.
-   * \param[in] points the list of points for which the shadow is calculated
-   * \param[in] shadow_vec the vector that describes the direction of the shadow
-   * relative to the camera origin
-   * \param[in] num_shadow_points the number of shadow points to be calculated
-   * \param[in] voxel_grid_size the size of the voxel grid
-   * \param[out] shadow_set the set of shadow points
+   * \brief Calculate the grasp candidate for a single hand orientation.
+   * \param point_list the point neighborhood
+   * \param points_frame the points rotated into the hand frame (3 x n)
+   * \param normals_frame the normals rotated into the hand frame (3 x n)
+   * \param frame_rot the orientation of the hand frame
+   * \param finger_hand the FingerHand object used to evaluate the fingers
+   * \param idx the index of the grasp candidate in `hands_`
    */
-  void calculateShadowForCamera(const Eigen::Matrix3Xd &points,
-                                const Eigen::Vector3d &shadow_vec,
-                                int num_shadow_points, double voxel_grid_size,
-                                Vector3iSet &shadow_set) const;
+  void evalHand(const util::PointList &point_list,
+                const Eigen::Ref<const Eigen::Matrix3Xd> &points_frame,
+                const Eigen::Ref<const Eigen::Matrix3Xd> &normals_frame,
+                const Eigen::Matrix3d &frame_rot, FingerHand &finger_hand,
+                int idx);
 
   /**
    * \brief Modify a grasp candidate.
    * \param hand the grasp candidate to be modified
-   * \param point_list the point neighborhood
-   * \param indices the indices of the points in the hand closing region
+   * \param point_list_closing the points in the hand closing region
    * \param finger_hand the FingerHand object that describes valid finger
    * placements
    * \return the modified grasp candidate
    */
-  void modifyCandidate(Hand &hand, const util::PointList &point_list,
-                       const std::vector<int> &indices,
+  void modifyCandidate(Hand &hand, const util::PointList &point_list_closing,
                        const FingerHand &finger_hand) const;
 
   /**
@@ -253,29 +248,14 @@ class HandSet {
   Eigen::Matrix3Xd shadowVoxelsToPoints(
       const std::vector<Eigen::Vector3i> &voxels, double voxel_grid_size) const;
 
-  /**
-   * \brief Calculate the intersection of two shadows.
-   * \param set1 the first shadow
-   * \param set2 the second shadow
-   * \return the intersection
-   */
-  Vector3iSet intersection(const Vector3iSet &set1,
-                           const Vector3iSet &set2) const;
-
-  /**
-   * \brief Generate a random integer.
-   * \note Source:
-   * http://software.intel.com/en-us/articles/fast-random-number-generator-on-
-   * the-intel-pentiumr-4-processor/
-   */
-  inline int fastrand() const;
-
   Eigen::Vector3d sample_;  ///< the center of the point neighborhood
   Eigen::Matrix3d frame_;   ///< the local reference frame
   std::vector<std::unique_ptr<Hand>>
       hands_;  ///< the grasp candidates contained in this set
   Eigen::Array<bool, 1, Eigen::Dynamic>
       is_valid_;  ///< indicates for each grasp candidate if it is valid or not
+  std::shared_ptr<const util::Neighborhood>
+      neighborhood_;  ///< the cached point neighborhood of the sample
   Eigen::VectorXd
       angles_;        ///< the hand orientations to consider in the local search
   bool deepen_hand_;  ///< if the hand is pushed forward onto the object
@@ -287,7 +267,7 @@ class HandSet {
 
   Antipodal &antipodal_;
 
-  static int seed_;  ///< seed for the random generator in fastrand()
+  static const unsigned int SHADOW_SEED;  ///< seed for the shadow jitter
 
   static const Eigen::Vector3d AXES[3];  ///< standard rotation axes
 
@@ -79,11 +79,27 @@ class Image15ChannelsStrategy : public ImageStrategy {
    * \brief Create grasp images given a list of grasp candidates.
    * \param hand_set the grasp candidates
    * \param nn_points the point neighborhoods used to calculate the images
-   * \return the grasp images
+   * \param shadows the occlusion volume of each camera (if empty, the shadow is
+   * calculated from <nn_points>)
+   * \param[out] images the grasp images
+   * \param offset the slot of the first image in <images>
    */
-  std::vector<std::unique_ptr<cv::Mat>> createImages(
-      const candidate::HandSet &hand_set,
-      const util::PointList &nn_points) const;
+  void createImages(const candidate::HandSet &hand_set,
+                    const util::PointList &nn_points,
+                    const std::vector<util::OcclusionVolume> &shadows,
+                    net::ImageTensor &images, int offset) const;
+
+  /**
+   * \brief Return if the images contain the "shadow" of the points.
+   * \return true
+   */
+  bool usesShadows() const { return true; }
+
+  /**
+   * \brief Return the length of the shadows.
+   * \return the shadow length
+   */
+  double getShadowLength() const { return shadow_length_; }
 
  protected:
   void createImage(const util::PointList &point_list,
@@ -91,14 +107,6 @@ class Image15ChannelsStrategy : public ImageStrategy {
                    cv::Mat &image) const;
 
  private:
-  cv::Mat calculateImage(const Eigen::Matrix3Xd &points,
-                         const Eigen::Matrix3Xd &normals,
-                         const Eigen::Matrix3Xd &shadow) const;
-
-  std::vector<cv::Mat> calculateChannels(const Eigen::Matrix3Xd &points,
-                                         const Eigen::Matrix3Xd &normals,
-                                         const Eigen::Matrix3Xd &shadow) const;
-
   void showImage(const cv::Mat &image) const;
 
   double shadow_length_;
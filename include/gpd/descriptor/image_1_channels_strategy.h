@@ -68,11 +68,14 @@ class Image1ChannelsStrategy : public ImageStrategy {
    * \brief Create grasp images given a list of grasp candidates.
    * \param hand_set the grasp candidates
    * \param nn_points the point neighborhoods used to calculate the images
-   * \return the grasp images
+   * \param shadows the occlusion volume of each camera (not used)
+   * \param[out] images the grasp images
+   * \param offset the slot of the first image in <images>
    */
-  std::vector<std::unique_ptr<cv::Mat>> createImages(
-      const candidate::HandSet &hand_set,
-      const util::PointList &nn_points) const;
+  void createImages(const candidate::HandSet &hand_set,
+                    const util::PointList &nn_points,
+                    const std::vector<util::OcclusionVolume> &shadows,
+                    net::ImageTensor &images, int offset) const;
 
  protected:
   void createImage(const util::PointList &point_list,
@@ -33,6 +33,7 @@
 #define IMAGE_GENERATOR_H_
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -52,8 +53,11 @@
 
 #include <gpd/candidate/hand_set.h>
 #include <gpd/descriptor/image_strategy.h>
+#include <gpd/net/image_tensor.h>
 #include <gpd/util/cloud.h>
 #include <gpd/util/eigen_utils.h>
+#include <gpd/util/occlusion_volume.h>
+#include <gpd/util/point_list.h>
 
 typedef std::pair<Eigen::Matrix3Xd, Eigen::Matrix3Xd> Matrix3XdPair;
 typedef pcl::PointCloud<pcl::PointXYZRGBA> PointCloudRGBA;
@@ -71,6 +75,16 @@ namespace descriptor {
  */
 class ImageGenerator {
  public:
+  /**
+   * \brief Point cloud data that is shared by the images of all grasp
+   * candidates.
+   */
+  struct Scene {
+    util::PointList point_list;  ///< the points (without the plane if removed)
+    std::vector<util::OcclusionVolume> shadows;  ///< occluded voxels of each
+                                                 /// camera
+  };
+
   /**
    * \brief Constructor.
    * \param params parameters for grasp images
@@ -83,11 +97,81 @@ class ImageGenerator {
                  int num_threads, int num_orientations, bool is_plotting,
                  bool remove_plane);
 
+  /**
+   * \brief Create grasp images for a given list of grasp candidates.
+   *
+   * The images are written straight into <images_out>, in the tensor's layout
+   * and precision. The tensor is resized to the number of valid grasps.
+   *
+   * \param cloud_cam the point cloud
+   * \param hand_set_list the list of grasp candidates
+   * \param[out] images_out the grasp images
+   * \param[out] hands_out the grasp candidates that correspond to the images
+   */
+  void createImages(
+      const util::Cloud &cloud_cam,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      net::ImageTensor &images_out,
+      std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const;
+
+  /**
+   * \brief Create grasp images for a given list of grasp candidates without
+   * taking the candidates out of their hand sets.
+   *
+   * The images are in the order of the valid grasps in <hand_set_list>.
+   *
+   * \param cloud_cam the point cloud
+   * \param hand_set_list the list of grasp candidates
+   * \param[out] images_out the grasp images
+   */
+  void createImages(
+      const util::Cloud &cloud_cam,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      net::ImageTensor &images_out) const;
+
+  /**
+   * \brief Prepare the point cloud data that is shared by all grasp images.
+   * Useful if images are created for several lists of grasp candidates in the
+   * same point cloud.
+   * \param cloud_cam the point cloud
+   * \return the scene
+   */
+  Scene createScene(const util::Cloud &cloud_cam) const;
+
+  /**
+   * \brief Create grasp images for a given list of grasp candidates in a
+   * prepared scene, without taking the candidates out of their hand sets.
+   * \param cloud_cam the point cloud
+   * \param scene the scene (see createScene())
+   * \param hand_set_list the list of grasp candidates
+   * \param[out] images_out the grasp images
+   */
+  void createImages(
+      const util::Cloud &cloud_cam, const Scene &scene,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      net::ImageTensor &images_out) const;
+
+  /**
+   * \brief Create grasp images for a given list of grasp candidates in a
+   * prepared scene, and take the candidates out of their hand sets.
+   * \param cloud_cam the point cloud
+   * \param scene the scene (see createScene())
+   * \param hand_set_list the list of grasp candidates
+   * \param[out] images_out the grasp images
+   * \param[out] hands_out the grasp candidates that correspond to the images
+   */
+  void createImages(
+      const util::Cloud &cloud_cam, const Scene &scene,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      net::ImageTensor &images_out,
+      std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const;
+
   /**
    * \brief Create a list of grasp images for a given list of grasp candidates.
    * \param cloud_cam the point cloud
    * \param hand_set_list the list of grasp candidates
-   * \return the list of grasp images
+   * \param[out] images_out the list of grasp images
+   * \param[out] hands_out the grasp candidates that correspond to the images
    */
   void createImages(
       const util::Cloud &cloud_cam,
@@ -114,11 +198,19 @@ class ImageGenerator {
   void removePlane(const util::Cloud &cloud_cam,
                    util::PointList &point_list) const;
 
+  /**
+   * \brief Calculate the occlusion volume of each camera for the whole scene.
+   * \param point_list the points of the scene
+   * \return the occlusion volume of each camera
+   */
+  std::vector<util::OcclusionVolume> calculateShadows(
+      const util::PointList &point_list) const;
+
   void createImageList(
       const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
       const std::vector<util::PointList> &nn_points_list,
-      std::vector<std::unique_ptr<cv::Mat>> &images_out,
-      std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const;
+      const std::vector<util::OcclusionVolume> &shadows,
+      net::ImageTensor &images_out) const;
 
   int num_threads_;
   int num_orientations_;
@@ -76,6 +76,13 @@ class ImageGeometry {
    */
   ImageGeometry(const std::string &filepath);
 
+  /**
+   * \brief Return the radius of the point neighborhood that covers the image
+   * volume, i.e., the largest dimension of the volume.
+   * \return the neighborhood radius
+   */
+  double getSearchRadius() const;
+
   double outer_diameter_;  ///< the width of the volume
   double depth_;           ///< the depth of the volume
   double height_;          ///< the height of the volume
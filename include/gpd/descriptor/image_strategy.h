@@ -41,6 +41,8 @@
 
 #include <gpd/candidate/hand_set.h>
 #include <gpd/descriptor/image_geometry.h>
+#include <gpd/net/image_tensor.h>
+#include <gpd/util/occlusion_volume.h>
 
 typedef std::pair<Eigen::Matrix3Xd, Eigen::Matrix3Xd> Matrix3XdPair;
 
@@ -87,13 +89,34 @@ class ImageStrategy {
 
   /**
    * \brief Create grasp images given a list of grasp candidates.
+   *
+   * The images of the valid grasps in <hand_set> are written in order into
+   * consecutive slots of <images>, starting at <offset>.
+   *
    * \param hand_set the grasp candidates
    * \param nn_points the point neighborhoods used to calculate the images
-   * \return the grasp images
+   * \param shadows the occlusion volume of each camera, calculated once for
+   * the scene (can be empty)
+   * \param[out] images the grasp images
+   * \param offset the slot of the first image in <images>
    */
-  virtual std::vector<std::unique_ptr<cv::Mat>> createImages(
-      const candidate::HandSet &hand_set,
-      const util::PointList &nn_points) const = 0;
+  virtual void createImages(const candidate::HandSet &hand_set,
+                            const util::PointList &nn_points,
+                            const std::vector<util::OcclusionVolume> &shadows,
+                            net::ImageTensor &images, int offset) const = 0;
+
+  /**
+   * \brief Return if the images contain the "shadow" of the points, i.e., if
+   * createImages() uses the occlusion volumes.
+   * \return true if the images contain the shadow, false otherwise
+   */
+  virtual bool usesShadows() const { return false; }
+
+  /**
+   * \brief Return the length of the shadows.
+   * \return the shadow length
+   */
+  virtual double getShadowLength() const { return 0.0; }
 
   /**
    * \brief Return the grasp image parameters.
@@ -102,6 +125,17 @@ class ImageStrategy {
   const ImageGeometry &getImageParameters() const { return image_params_; }
 
  protected:
+  /**
+   * \brief Return the image into which a grasp image is calculated. This is
+   * the memory of the slot in <images> if the tensor stores interleaved uchar
+   * images, otherwise a per-thread buffer that needs to be stored with
+   * net::ImageTensor::setImage().
+   * \param images the grasp images
+   * \param index the slot of the image in <images>
+   * \return the image
+   */
+  cv::Mat getImageBuffer(net::ImageTensor &images, int index) const;
+
   /**
    * \brief Transform a given list of points to the unit image.
    * \param point_list the list of points
@@ -166,13 +200,28 @@ class ImageStrategy {
                            const Eigen::VectorXi &cell_indices) const;
 
   /**
-   * \brief Create a grey value image based on the depth of the shadow points.
-   * \param points the shadow points
-   * \param cell_indices the indices of the shadow points in the image
-   * \return the image
+   * \brief Create a multi-channel image that contains the surface normals, the
+   * depth and, optionally, the shadow of the points from three projections.
+   *
+   * All channels of all projections are rasterized in one pass over the
+   * points into an interleaved buffer that is then dilated and normalized in
+   * one go. Each projection has four channels (normals, depth) or five
+   * channels (normals, depth, shadow), depending on the number of channels in
+   * the image parameters.
+   *
+   * \param points the points in the unit image
+   * \param normals the surface normals of the points
+   * \param shadow the shadow points in the unit image (not used for 12
+   * channels)
+   * \param[out] image the image
    */
-  cv::Mat createShadowImage(const Eigen::Matrix3Xd &points,
-                            const Eigen::VectorXi &cell_indices) const;
+  void createProjectionsImage(const Eigen::Matrix3Xd &points,
+                              const Eigen::Matrix3Xd &normals,
+                              const Eigen::Matrix3Xd &shadow,
+                              cv::Mat &image) const;
+
+  static const int NUM_PROJECTIONS;  ///< number of projections
+  static const int PROJECTION_AXES[3][3];  ///< (row, col, depth) axes
 
   ImageGeometry image_params_;  ///< grasp image parameters
   int num_orientations_;        ///< number of hand orientations
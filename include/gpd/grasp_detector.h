@@ -34,7 +34,11 @@
 
 // System
 #include <algorithm>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <vector>
 
 // PCL
@@ -49,7 +53,11 @@
 #include <gpd/candidate/hand_set.h>
 #include <gpd/clustering.h>
 #include <gpd/descriptor/image_generator.h>
+#include <gpd/grasp_tracker.h>
 #include <gpd/net/classifier.h>
+#include <gpd/net/image_tensor.h>
+#include <gpd/score_cache.h>
+#include <gpd/top_k_selector.h>
 #include <gpd/util/config_file.h>
 #include <gpd/util/plot.h>
 
@@ -68,6 +76,8 @@ class GraspDetector {
  struct Parameters {
     // classification parameters
     double min_score_;           ///< minimum classifier confidence score
+    double cascade_min_score_;   ///< score below which the first stage of the
+                                 /// cascade rejects candidates
     bool create_image_batches_;  ///< if images are created in batches (reduces
                                  /// memory usage)
 
@@ -92,6 +102,22 @@ class GraspDetector {
 
     // selection parameters
     int num_selected_;  ///< the number of selected grasps
+    int topk_batch_size_;       ///< the number of candidates per batch in the
+                                /// bounded top-k selection (0: not used)
+    double topk_bound_margin_;  ///< margin added to the first-stage score to
+                                /// bound the score of a candidate
+
+    // pipelining parameters
+    int pipeline_chunk_size_;  ///< the number of samples per chunk in the
+                               /// pipelined detection (0: no pipelining)
+
+    // anytime parameters
+    int anytime_batch_size_;  ///< the number of samples per batch in the
+                              /// deadline-bounded detection
+
+    // tracking parameters
+    double tracking_max_change_;  ///< the fraction of changed voxels above
+                                  /// which grasps are detected from scratch
   };
   Parameters params_;
 
@@ -112,6 +138,37 @@ class GraspDetector {
   std::vector<std::unique_ptr<candidate::Hand>> detectGrasps(
       const util::Cloud &cloud);
 
+  /**
+   * \brief Detect grasps in a point cloud within a given time.
+   *
+   * The samples are processed in a random order, in batches of
+   * <anytime_batch_size_>, so that any prefix covers the whole scene. After
+   * each batch, only the <num_selected_> highest scoring grasps are kept. No
+   * new batch is started if it is not expected to finish before the deadline.
+   *
+   * \param cloud the point cloud
+   * \param deadline the time budget in seconds, measured from the call
+   * \param[out] budget_used the fraction of the samples that were processed
+   * \return list of grasps
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> detectGrasps(
+      const util::Cloud &cloud, double deadline, double &budget_used);
+
+  /**
+   * \brief Detect grasps in a point cloud that follows the previous one, e.g.,
+   * in a camera stream of a mostly static scene.
+   *
+   * The previous grasps are re-checked on the new cloud, and new candidates
+   * are only searched where the cloud has changed. If the scene has changed
+   * too much (see <tracking_max_change_>), or for the first cloud, this falls
+   * back to detectGrasps().
+   *
+   * \param cloud the point cloud
+   * \return list of grasps
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> trackGrasps(
+      const util::Cloud &cloud);
+
   /**
    * \brief Preprocess the point cloud.
    * \param cloud_cam the point cloud
@@ -182,6 +239,88 @@ class GraspDetector {
       const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
       double min_score);
 
+  /**
+   * \brief Reject grasp candidates with the cheap first stage of the cascade.
+   *
+   * Creates the (small) first-stage images of all candidates, classifies them
+   * and marks the candidates with a score below <cascade_min_score_> as
+   * invalid. Only the remaining candidates go through the full classifier.
+   * Their score is set to the first-stage score until then.
+   *
+   * \param cloud the point cloud
+   * \param hand_set_list the grasp candidates
+   * \param[out] num_candidates the number of candidates before the rejection
+   * \param[out] num_rejected the number of rejected candidates
+   * \param scene the first-stage scene (see ImageGenerator::createScene()),
+   * or nullptr to create it from <cloud>
+   * \return the hand sets that still contain valid candidates
+   */
+  std::vector<std::unique_ptr<candidate::HandSet>> rejectGraspCandidates(
+      const util::Cloud &cloud,
+      std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      int &num_candidates, int &num_rejected,
+      const descriptor::ImageGenerator::Scene *scene = nullptr);
+
+  /**
+   * \brief Score grasp candidates with the classifier.
+   *
+   * Candidates found in the score cache (if enabled) skip both image creation
+   * and classification. The other candidates are classified and added to the
+   * cache.
+   *
+   * \param cloud the point cloud
+   * \param hand_set_list the grasp candidates
+   * \param[out] hands_out the valid grasp candidates with their scores
+   * \param[out] t_images the time spent on image creation
+   * \param[out] t_classify the time spent on classification
+   * \param scene the scene (see ImageGenerator::createScene()), or nullptr to
+   * create it from <cloud>
+   * \return the number of candidates that were classified
+   */
+  int scoreGraspCandidates(
+      const util::Cloud &cloud,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      std::vector<std::unique_ptr<candidate::Hand>> &hands_out,
+      double &t_images, double &t_classify,
+      const descriptor::ImageGenerator::Scene *scene = nullptr);
+
+  /**
+   * \brief Score grasp candidates and select the <num_selected_> best of them.
+   *
+   * The candidates are classified in batches, in the order of an upper bound
+   * on their score: the first-stage score of the cascade plus
+   * <topk_bound_margin_>. A candidate whose bound is not above the lowest
+   * score selected so far is skipped without creating its image.
+   *
+   * \param cloud the point cloud
+   * \param hand_set_list the grasp candidates, scored by the cascade
+   * \param[out] hands_out the selected grasp candidates with their scores
+   * \param[out] num_skipped the number of skipped candidates
+   * \param[out] t_images the time spent on image creation
+   * \param[out] t_classify the time spent on classification
+   * \return the number of candidates that were classified
+   */
+  int selectGraspCandidates(
+      const util::Cloud &cloud,
+      const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+      std::vector<std::unique_ptr<candidate::Hand>> &hands_out,
+      int &num_skipped, double &t_images, double &t_classify);
+
+  /**
+   * \brief Generate and score grasp candidates in a pipeline.
+   *
+   * The samples are split into chunks of <pipeline_chunk_size_>. Each chunk
+   * goes through candidate generation, filtering, image creation and
+   * classification as OpenMP tasks, so that the stages of different chunks
+   * overlap. At most two chunks per thread are in flight at the same time.
+   *
+   * \param cloud the point cloud
+   * \param[out] t_first_score the time at which the first chunk was scored
+   * \return the valid grasp candidates with their scores
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> streamGraspCandidates(
+      const util::Cloud &cloud, double &t_first_score);
+
   /**
    * \brief Select the k highest scoring grasps.
    * \param hands the grasps
@@ -219,6 +358,31 @@ class GraspDetector {
   }
 
  private:
+  /**
+   * \brief Search, filter and score grasp candidates at given samples.
+   * \param cloud the point cloud
+   * \param samples the samples
+   * \param[in,out] t_images the time spent on image creation (accumulated)
+   * \param[in,out] t_classify the time spent on classification (accumulated)
+   * \param scene the scene of <cloud>, or nullptr to create it
+   * \param cascade_scene the first-stage scene of <cloud>, or nullptr to
+   * create it
+   * \return the valid grasp candidates with their scores
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> scoreSamples(
+      const util::Cloud &cloud, const Eigen::Matrix3Xd &samples,
+      double &t_images, double &t_classify,
+      const descriptor::ImageGenerator::Scene *scene = nullptr,
+      const descriptor::ImageGenerator::Scene *cascade_scene = nullptr);
+
+  /**
+   * \brief Cluster grasps (if enabled) and sort them by their score.
+   * \param hands the grasps
+   * \return the clustered grasps
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> clusterGrasps(
+      std::vector<std::unique_ptr<candidate::Hand>> &hands);
+
   void printStdVector(const std::vector<int> &v, const std::string &name) const;
 
   void printStdVector(const std::vector<double> &v,
@@ -229,6 +393,16 @@ class GraspDetector {
   std::unique_ptr<Clustering> clustering_;
   std::unique_ptr<util::Plot> plotter_;
   std::shared_ptr<net::Classifier> classifier_;
+  net::ImageTensor image_tensor_;  ///< input of the classifier, reused
+
+  // first stage of the cascade (optional)
+  std::unique_ptr<descriptor::ImageGenerator> cascade_image_generator_;
+  std::shared_ptr<net::Classifier> cascade_classifier_;
+  net::ImageTensor cascade_image_tensor_;  ///< input of the first stage
+
+  std::unique_ptr<ScoreCache> score_cache_;  ///< scores of earlier candidates
+  std::unique_ptr<GraspTracker> tracker_;  ///< scene and grasps of the last
+                                          /// cloud (optional)
 };
 
 }  // namespace gpd
@@ -0,0 +1,173 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GRASP_TRACKER_H_
+#define GRASP_TRACKER_H_
+
+// System
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <gpd/candidate/hand.h>
+#include <gpd/util/cloud.h>
+
+namespace gpd {
+
+/**
+ *
+ * \brief Track grasps and scene changes across consecutive point clouds
+ *
+ * Keeps the voxels occupied by the previous point cloud and the grasps that
+ * were detected in it. A voxel of the new cloud has changed if none of the 27
+ * voxels around it was occupied in the previous cloud (and vice versa for
+ * voxels that became free), so that sensor noise which moves a surface into
+ * an adjacent voxel does not count as a change. If the preprocessing marks
+ * the changed points of the cloud (see util::VoxelMap), their voxels are used
+ * instead of the voxels that appeared. Grasp detection can then re-check the
+ * previous grasps and only sample the regions that changed.
+ *
+ */
+class GraspTracker {
+ public:
+  /**
+   * \brief Constructor.
+   * \param voxel_size the size of the voxels that are compared
+   * \param change_radius the distance up to which a point is affected by a
+   * changed voxel
+   */
+  GraspTracker(double voxel_size, double change_radius);
+
+  /**
+   * \brief Find the changed voxels between the previous and a new point cloud,
+   * and make the new cloud the previous one.
+   * \param cloud the new point cloud
+   */
+  void update(const util::Cloud &cloud);
+
+  /**
+   * \brief Check if a point is close to a changed voxel.
+   * \param point the point
+   * \return `true` if the point is within <change_radius> of a changed voxel,
+   * `false` otherwise
+   */
+  bool isChanged(const Eigen::Vector3d &point) const;
+
+  /**
+   * \brief Select the samples that are close to a changed voxel.
+   * \param samples the samples (size: 3 x n)
+   * \return the selected samples
+   */
+  Eigen::Matrix3Xd selectChanged(const Eigen::Matrix3Xd &samples) const;
+
+  /**
+   * \brief Store a copy of the grasps detected in the latest point cloud.
+   * \param hands the grasps
+   */
+  void setGrasps(const std::vector<std::unique_ptr<candidate::Hand>> &hands);
+
+  /**
+   * \brief Return a copy of the grasps detected in the previous point cloud.
+   * \return the grasps
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> copyGrasps() const;
+
+  /**
+   * \brief Forget the previous point cloud and its grasps.
+   */
+  void reset();
+
+  /**
+   * \brief Check if there is a previous point cloud to compare with.
+   * \return `true` if update() was called for two clouds since the last reset
+   */
+  bool hasPreviousFrame() const { return num_frames_ >= 2; }
+
+  /**
+   * \brief Return the fraction of the occupied voxels that changed in the
+   * latest update.
+   * \return the fraction
+   */
+  double getChangedFraction() const { return changed_fraction_; }
+
+ private:
+  /**
+   * \brief Return the hash set key of a voxel.
+   * \param voxel the voxel (each element must be in [-2^20, 2^20))
+   * \return the key
+   */
+  static uint64_t toKey(const Eigen::Vector3i &voxel);
+
+  /**
+   * \brief Return the voxel that contains a point.
+   * \param point the point
+   * \return the voxel
+   */
+  Eigen::Vector3i toVoxel(const Eigen::Vector3d &point) const;
+
+  /**
+   * \brief Check if a set contains a voxel within a cube around a given voxel.
+   * \param voxels the set of voxels
+   * \param voxel the center of the cube
+   * \param radius the number of voxels in each direction from the center
+   * \return `true` if a voxel is found, `false` otherwise
+   */
+  static bool containsNear(const std::unordered_set<uint64_t> &voxels,
+                           const Eigen::Vector3i &voxel, int radius);
+
+  /**
+   * \brief Find the voxels within a cube around any of the given voxels.
+   * \param voxels the voxels
+   * \param radius the number of voxels in each direction from a voxel
+   * \return the keys of the voxels found
+   */
+  static std::unordered_set<uint64_t> dilate(
+      const std::vector<Eigen::Vector3i> &voxels, int radius);
+
+  double voxel_size_;
+  int change_radius_;  ///< <change_radius> in voxels
+  int num_frames_;
+  double changed_fraction_;
+  std::vector<Eigen::Vector3i> occupied_;       ///< voxels of the last cloud
+  std::unordered_set<uint64_t> occupied_keys_;  ///< keys of <occupied_>
+  std::unordered_set<uint64_t> changed_;        ///< keys of changed voxels
+  std::unordered_set<uint64_t> changed_near_;   ///< keys within change radius
+  std::vector<std::unique_ptr<candidate::Hand>> grasps_;  ///< last grasps
+};
+
+}  // namespace gpd
+
+#endif /* GRASP_TRACKER_H_ */
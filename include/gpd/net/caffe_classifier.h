@@ -33,6 +33,7 @@
 #define CAFFE_CLASSIFIER_H_
 
 // System
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -69,23 +70,26 @@ class CaffeClassifier : public Classifier {
                   const std::string &weights_file, Classifier::Device device,
                   int batch_size);
 
+  using Classifier::classifyImages;
+
   /**
    * \brief Classify grasp candidates as viable grasps or not.
-   * \param image_list the list of grasp images
+   * \param images the grasp images (NCHW, FP32)
    * \return the classified grasp candidates
    */
-  std::vector<float> classifyImages(
-      const std::vector<std::unique_ptr<cv::Mat>> &image_list);
+  std::vector<float> classifyImages(const ImageTensor &images);
 
   /**
    * \brief Return the batch size.
    * \return the batch size
    */
-  int getBatchSize() const { return input_layer_->batch_size(); }
+  int getBatchSize() const { return batch_size_; }
 
  private:
   boost::shared_ptr<caffe::Net<float>> net_;
   boost::shared_ptr<caffe::MemoryDataLayer<float>> input_layer_;
+  int batch_size_;
+  std::vector<float> labels_;  ///< dummy labels required by the data layer
 };
 
 }  // namespace net
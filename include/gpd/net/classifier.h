@@ -40,6 +40,8 @@
 // OpenCV
 #include <opencv2/core/core.hpp>
 
+#include <gpd/net/image_tensor.h>
+
 namespace gpd {
 namespace net {
 
@@ -58,26 +60,67 @@ class Classifier {
    * \param model_file filepath to the network model
    * \param weights_file filepath to the network parameters
    * \param device target device on which the network is run
+   * \param batch_size the number of images per batch
+   * \param num_threads the number of CPU threads (Eigen classifier) or the
+   * number of infer requests that run in parallel (OpenVINO classifier)
    * \return the classifier
    */
   static std::shared_ptr<Classifier> create(const std::string &model_file,
                                             const std::string &weights_file,
                                             Device device = Device::eCPU,
-                                            int batch_size = 1);
+                                            int batch_size = 1,
+                                            int num_threads = 1);
+
+  virtual ~Classifier() {}
+
+  /**
+   * \brief Classify grasp candidates as viable grasps or not.
+   * \param images the grasp images, stored in the layout and precision given
+   * by getInputLayout() and getInputPrecision()
+   * \return the classified grasp candidates
+   */
+  virtual std::vector<float> classifyImages(const ImageTensor &images) = 0;
 
   /**
    * \brief Classify grasp candidates as viable grasps or not.
+   *
+   * Copies the images into a tensor first. Prefer the tensor version for
+   * online detection.
+   *
    * \param image_list the list of grasp images
    * \return the classified grasp candidates
    */
-  virtual std::vector<float> classifyImages(
-      const std::vector<std::unique_ptr<cv::Mat>> &image_list) = 0;
+  std::vector<float> classifyImages(
+      const std::vector<std::unique_ptr<cv::Mat>> &image_list);
+
+  /**
+   * \brief Return the memory layout of the input expected by the classifier.
+   * \return the memory layout
+   */
+  virtual ImageTensor::Layout getInputLayout() const {
+    return ImageTensor::Layout::eNCHW;
+  }
+
+  /**
+   * \brief Return the data type of the input expected by the classifier.
+   * \return the data type
+   */
+  virtual ImageTensor::Precision getInputPrecision() const {
+    return ImageTensor::Precision::eFP32;
+  }
 
   /**
    * \brief Return the batch size.
    * \return the batch size
    */
   virtual int getBatchSize() const = 0;
+
+  /**
+   * \brief Return if classifyImages() can be called concurrently, e.g., from
+   * several OpenMP tasks.
+   * \return `true` if concurrent calls are safe, `false` otherwise
+   */
+  virtual bool isReentrant() const { return false; }
 };
 
 }  // namespace net
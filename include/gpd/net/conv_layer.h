@@ -70,23 +70,156 @@ class ConvLayer : public Layer {
    */
   Eigen::MatrixXf forward(const std::vector<float> &x) const;
 
- private:
-  typedef Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic,
-                                         Eigen::RowMajor>>
-      RowMajorMatrixMap;
+  /**
+   * \brief Fuse a ReLU and/or a max pooling layer into this layer.
+   *
+   * The convolution is calculated in tiles of output rows. The bias, the ReLU
+   * and the pooling are applied to each tile while it is in the cache, so that
+   * only the pooled output is written to memory.
+   *
+   * \param relu if a ReLU is applied to the output
+   * \param pool_size the size of the pooling filter (1: no pooling)
+   * \param pool_stride the stride of the pooling filter
+   */
+  void fuse(bool relu, int pool_size, int pool_stride);
 
   /**
-   * \brief Calculate the forward pass.
-   * \param W weight matrix
-   * \param b bias vector
-   * \param X input matrix
-   * \return output of forward pass
+   * \brief Batched forward pass.
+   *
+   * The c-th input channel of the n-th image starts at
+   * x[n * image_stride + c * channel_stride]. For each tile of output rows,
+   * the image patches are arranged into a matrix so that the convolution of
+   * the tile is a single matrix multiplication. The output is stored channel
+   * by channel with the images of the batch next to each other in each
+   * channel, i.e., as a row-major (num_filters) x (num_images * output size)
+   * matrix, which is the input layout of the next layer.
+   *
+   * \param x the input volumes
+   * \param num_images the number of images
+   * \param image_stride the distance between two images in <x>
+   * \param channel_stride the distance between two channels of an image in <x>
+   * \param buffer buffer for the image patches and the convolution of a tile
+   * (resized if necessary)
+   * \param[out] y the output volumes
+   */
+  void forward(const float *x, int num_images, int image_stride,
+               int channel_stride, std::vector<float> &buffer, float *y) const;
+
+  /**
+   * \brief Batched forward pass with INT8 weights for uchar input volumes.
+   *
+   * Same as the FP32 forward pass, but the image patches are stored one after
+   * another and multiplied with the quantized weights as integers. The input
+   * is used as is, i.e., the input scale should be one.
+   *
+   * \param x the input volumes
+   * \param num_images the number of images
+   * \param image_stride the distance between two images in <x>
+   * \param channel_stride the distance between two channels of an image in <x>
+   * \param patches buffer for the quantized image and its patches (resized if
+   * necessary)
+   * \param buffer buffer for the convolution of a tile (resized if necessary)
+   * \param[out] y the output volumes
+   */
+  void forwardQuantized(const uint8_t *x, int num_images, int image_stride,
+                        int channel_stride, std::vector<int16_t> &patches,
+                        std::vector<float> &buffer, float *y) const;
+
+  /**
+   * \brief Batched forward pass with INT8 weights for float input volumes.
+   *
+   * The input is quantized to INT8 with the input scale before the image
+   * patches are arranged.
+   *
+   * \param x the input volumes
+   * \param num_images the number of images
+   * \param image_stride the distance between two images in <x>
+   * \param channel_stride the distance between two channels of an image in <x>
+   * \param patches buffer for the quantized image and its patches (resized if
+   * necessary)
+   * \param buffer buffer for the convolution of a tile (resized if necessary)
+   * \param[out] y the output volumes
+   */
+  void forwardQuantized(const float *x, int num_images, int image_stride,
+                        int channel_stride, std::vector<int16_t> &patches,
+                        std::vector<float> &buffer, float *y) const;
+
+  /**
+   * \brief Quantize the weights of the layer to INT8 (one scale per filter).
+   * \param input_scale the scale of the quantized input
+   */
+  void quantize(float input_scale);
+
+  /**
+   * \brief Return the width of the output volume (after pooling).
+   * \return the width of the output volume
+   */
+  int getOutputWidth() const { return w3; }
+
+  /**
+   * \brief Return the size of each channel of the output volume (after
+   * pooling).
+   * \return the size of each channel of the output volume
+   */
+  int getOutputSize() const { return w3 * h3; }
+
+  /**
+   * \brief Return the size of the buffer of the FP32 forward pass.
+   * \return the number of elements in the buffer
+   */
+  int getBufferSize() const { return (X_col_r + W_row_r) * getTileSize(); }
+
+  /**
+   * \brief Return the size of the patches buffer of the INT8 forward pass.
+   * \return the number of elements in the patches buffer
    */
-  Eigen::MatrixXf forward(const Eigen::MatrixXf &W, const Eigen::VectorXf &b,
-                          const Eigen::MatrixXf &X) const;
+  int getQuantizedBufferSize() const {
+    return d1 * h1 * w1 + X_col_r * getTileSize();
+  }
+
+  /**
+   * \brief Return the number of filters (channels of the output volume).
+   * \return the number of filters
+   */
+  int getNumFilters() const { return d2; }
+
+ private:
+  typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      RowMajorMatrix;
+  typedef Eigen::Map<const RowMajorMatrix> RowMajorMatrixMap;
 
   bool is_a_ge_zero_and_a_lt_b(int a, int b) const;
 
+  /**
+   * \brief Return the number of convolution rows needed for a number of
+   * output rows.
+   * \param rows the number of output rows (after pooling)
+   * \return the number of convolution rows
+   */
+  int getConvRows(int rows) const {
+    return (rows - 1) * pool_stride_ + pool_size_;
+  }
+
+  /**
+   * \brief Return the maximum number of convolution outputs in a tile.
+   * \return the maximum number of convolution outputs in a tile
+   */
+  int getTileSize() const { return getConvRows(tile_rows_) * w2; }
+
+  /**
+   * \brief Apply the bias, the ReLU and the pooling to the convolution of a
+   * tile and write the result into the output volumes.
+   * \param tile the convolution of the tile (one row per filter, without bias)
+   * \param tile_size the number of convolution outputs in the tile
+   * \param row the first output row of the tile
+   * \param rows the number of output rows of the tile
+   * \param image the index of the image
+   * \param num_images the number of images
+   * \param[out] y the output volumes
+   */
+  void poolTile(const float *tile, int tile_size, int row, int rows, int image,
+                int num_images, float *y) const;
+
   /**
    * \brief Convert image to array. Arranges image slices into columns so that
    * the forward pass can be expressed as a
@@ -95,25 +228,66 @@ class ConvLayer : public Layer {
    * \param channels number of image channels
    * \param height image height
    * \param width image width
-   * \param num_kernels number of filters to be used in the convolution
+   * \param channel_stride distance between two channels in <data_im>
    * \param kernel_h filter height
    * \param kernel_w filter width
    * \param stride_h stride height
    * \param stride_w stride width
+   * \param col_stride distance between two rows in <data_col>
    * \param[out] data_col the array
    */
   void imageToColumns(const float *data_im, const int channels,
-                      const int height, const int width, const int num_kernels,
-                      const int kernel_h, const int kernel_w,
-                      const int stride_h, const int stride_w,
+                      const int height, const int width,
+                      const int channel_stride, const int kernel_h,
+                      const int kernel_w, const int stride_h,
+                      const int stride_w, const int col_stride,
                       float *data_col) const;
 
+  /**
+   * \brief Quantize the input volume of one image to INT8.
+   * \param data_im the image
+   * \param channel_stride distance between two channels in <data_im>
+   * \param inv_scale the inverse of the input scale (float input only)
+   * \param[out] image the quantized image (one channel after another)
+   */
+  template <typename T>
+  void quantizeImage(const T *data_im, int channel_stride, float inv_scale,
+                     int16_t *image) const;
+
+  /**
+   * \brief Arrange the image patches of a range of convolution rows of one
+   * quantized image one after another, each patch as a contiguous vector of
+   * (channel, row, column) elements.
+   * \param image the quantized image (one channel after another)
+   * \param row the first convolution row
+   * \param rows the number of convolution rows
+   * \param[out] patches the image patches
+   */
+  void imageToPatches(const int16_t *image, int row, int rows,
+                      int16_t *patches) const;
+
+  /**
+   * \brief Multiply the image patches with the quantized weights.
+   * \param patches the image patches (one after another)
+   * \param num_patches the number of patches
+   * \param[out] tile the convolution (one row per filter, without bias)
+   */
+  void multiplyPatches(const int16_t *patches, int num_patches,
+                       float *tile) const;
+
   int w1, h1, d1;  // size of input volume: w1 x h1 x d1
   int w2, h2, d2;  // size of output volume: w2 x h2 x d2
   int k, f, s, p;  // number of filters, their spatial extent, stride, amount of
                    // zero padding
   int W_row_r, W_row_c;  // number of rows and columns in matrix W_row
   int X_col_r, X_col_c;  // number of rows and columns in matrix X_col
+  int w3, h3;            // size of output volume after pooling: w3 x h3 x d2
+  bool relu_;            // if a ReLU is applied to the output
+  int pool_size_;        // size of the pooling filter (1: no pooling)
+  int pool_stride_;      // stride of the pooling filter
+  int tile_rows_;        // number of output rows per tile
+
+  static const int TILE_SIZE;  // number of convolution outputs per tile
 };
 
 }  // namespace net
@@ -64,6 +64,38 @@ class DenseLayer : public Layer {
    */
   Eigen::MatrixXf forward(const std::vector<float> &x) const;
 
+  /**
+   * \brief Batched forward pass.
+   * \param X input (each column is the input for one image)
+   * \param[out] H output of forward pass (one column per image)
+   */
+  void forward(const Eigen::Ref<const Eigen::MatrixXf> &X,
+               Eigen::Ref<Eigen::MatrixXf> H) const;
+
+  /**
+   * \brief Batched forward pass with INT8 weights. The input is quantized
+   * with the input scale and multiplied with the quantized weights as
+   * integers.
+   * \param X input (each column is the input for one image)
+   * \param inputs buffer for the quantized input (resized if necessary)
+   * \param[out] H output of forward pass (one column per image)
+   */
+  void forwardQuantized(const Eigen::Ref<const Eigen::MatrixXf> &X,
+                        std::vector<int16_t> &inputs,
+                        Eigen::Ref<Eigen::MatrixXf> H) const;
+
+  /**
+   * \brief Quantize the weights of the layer to INT8 (one scale per unit).
+   * \param input_scale the scale of the quantized input
+   */
+  void quantize(float input_scale);
+
+  /**
+   * \brief Return the number of units.
+   * \return the number of units
+   */
+  int getNumUnits() const { return num_units_; }
+
  private:
   int num_units_;  ///< the number of units
 };
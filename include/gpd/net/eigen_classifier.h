@@ -32,15 +32,21 @@
 #ifndef EIGEN_CLASSIFIER_H_
 #define EIGEN_CLASSIFIER_H_
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include <omp.h>
+
 #include <gpd/net/classifier.h>
 #include <gpd/net/conv_layer.h>
 #include <gpd/net/dense_layer.h>
+#include <gpd/net/weight_bundle.h>
+#include <gpd/util/config_file.h>
 
 namespace gpd {
 namespace net {
@@ -50,7 +56,8 @@ namespace net {
  * \brief Classify grasp candidates as viable grasps or not with Eigen
  *
  * Classifies grasps as viable or not using a custom neural network framework
- * based on the Eigen library.
+ * based on the Eigen library. The network topology is read from a description
+ * file (see cfg files in models/lenet/<model>/params/network.cfg).
  *
  */
 class EigenClassifier : public Classifier {
@@ -58,60 +65,259 @@ class EigenClassifier : public Classifier {
   /**
    * \brief Constructor.
    * \param model_file the location of the file that describes the network model
-   * \param weights_file the location of the file that contains the network
-   * weights
+   * (if empty, <weights_file>/network.cfg is used)
+   * \param weights_file the location of the directory that contains the
+   * network weights
+   * \param device target device on which the network is run (not used)
+   * \param batch_size the number of images per forward pass (if not positive,
+   * <DEFAULT_BATCH_SIZE> is used)
+   * \param num_threads the number of CPU threads to be used
    */
   EigenClassifier(const std::string &model_file,
                   const std::string &weights_file, Classifier::Device device,
-                  int batch_size);
+                  int batch_size, int num_threads);
+
+  using Classifier::classifyImages;
 
   /**
    * \brief Classify grasp candidates as viable grasps or not.
-   * \param image_list the list of grasp images
+   * \param images the grasp images (NCHW, FP32 or U8, see getInputPrecision())
    * \return the classified grasp candidates
    */
-  std::vector<float> classifyImages(
-      const std::vector<std::unique_ptr<cv::Mat>> &image_list);
+  std::vector<float> classifyImages(const ImageTensor &images);
+
+  /**
+   * \brief Return the precision of the input images. The INT8 network takes
+   * uchar images.
+   * \return the precision of the input images
+   */
+  ImageTensor::Precision getInputPrecision() const {
+    return is_quantized_ ? ImageTensor::Precision::eU8
+                         : ImageTensor::Precision::eFP32;
+  }
 
-  int getBatchSize() const { return 0; }
+  /**
+   * \brief Quantize the network to INT8 and switch to the INT8 forward pass.
+   *
+   * The FP32 network is run on the calibration images to find the range of
+   * the input of each layer. The weights are quantized with one scale per
+   * output channel.
+   *
+   * \param images the calibration images (NCHW, FP32)
+   * \return true if the network has been quantized, false otherwise
+   */
+  bool quantize(const ImageTensor &images);
+
+  /**
+   * \brief Switch between the FP32 and the INT8 forward pass.
+   * \param is_quantized if the INT8 forward pass is used
+   * \return true if the forward pass has been switched, false otherwise
+   */
+  bool setQuantized(bool is_quantized);
+
+  /**
+   * \brief Write the INT8 parameters of each layer to <name>_weights_int8.bin
+   * and <name>_scales.bin.
+   * \param params_dir path to the directory to write the files to
+   * \return true if all files have been written, false otherwise
+   */
+  bool saveQuantizedWeights(const std::string &params_dir) const;
+
+  /**
+   * \brief Write the parameters of all layers into a single weight bundle.
+   *
+   * The bundle holds <name>_weights and <name>_biases for each conv and dense
+   * layer, and <name>_weights_int8 and <name>_scales if the layer has INT8
+   * parameters.
+   *
+   * \param filename the location of the bundle
+   * \return true if the bundle has been written, false otherwise
+   */
+  bool saveWeightBundle(const std::string &filename) const;
+
+  /**
+   * \brief Return if the parameters have been read from a weight bundle.
+   * \return true if the parameters are in a weight bundle, false otherwise
+   */
+  bool hasWeightBundle() const { return bundle_ != nullptr; }
+
+  /**
+   * \brief Return if the INT8 forward pass is used.
+   * \return true if the INT8 forward pass is used, false otherwise
+   */
+  bool isQuantized() const { return is_quantized_; }
+
+  /**
+   * \brief Return the batch size.
+   * \return the number of images per forward pass
+   */
+  int getBatchSize() const { return batch_size_; }
+
+  /**
+   * \brief Return if classifyImages() can be called concurrently. Calls from
+   * inside a parallel region run on the calling thread with their own
+   * workspace.
+   * \return `true`
+   */
+  bool isReentrant() const { return true; }
 
  private:
+  /** \brief Types of layers that can appear in the network description. */
+  enum class LayerType { eConv, ePool, eDense, eRelu };
+
   /**
-   * \brief Forward pass of the network.
-   * \param x input to the network
-   * \return output of the network
+   * \brief A node of the layer graph and the shape of its output.
    */
-  std::vector<float> forward(const std::vector<float> &x);
+  struct LayerNode {
+    std::string name;  ///< name of the layer (prefix of its .bin files)
+    LayerType type;    ///< type of the layer
+    int index;  ///< index into <conv_layers_> or <dense_layers_> (or -1)
+    int filter_size;  ///< filter size (pooling layers)
+    int stride;       ///< stride (pooling layers)
+    int channels;  ///< number of output channels (units for dense layers)
+    int width;     ///< width of the output planes (1 for dense layers)
+    bool is_flat;  ///< if the output is a vector (after a dense layer)
+    int num_fused;  ///< number of following layers fused into this layer
+    std::vector<int> shape;  ///< shape of the weights (conv and dense layers)
+  };
 
   /**
-   * \brief Convert an image to an array (std::vector) so that it can be used as
-   * input for a layer.
-   * \param img the image to be converted
-   * \return the array
+   * \brief Scratch memory for the forward pass of one thread. Holds the
+   * intermediate results of all layers for one batch.
    */
-  std::vector<float> imageToArray(const cv::Mat &img) const;
+  struct Workspace {
+    std::vector<float> columns;  ///< image patches and tiles of the conv layers
+    std::vector<int16_t> quantized;  ///< quantized inputs (INT8 forward pass)
+    std::vector<float> planes[2];  ///< outputs of the spatial layers
+    Eigen::MatrixXf units[2];      ///< inputs and outputs of the dense layers
+  };
+
+  /**
+   * \brief Read the network description and build the layer graph.
+   *
+   * If the description can not be read, the LeNet topology for 15-channel
+   * images is used.
+   *
+   * \param filename path to the network description
+   * \param params_dir path to the directory that contains the weights
+   * \return true if the layer graph is valid, false otherwise
+   */
+  bool buildNetwork(const std::string &filename,
+                    const std::string &params_dir);
+
+  /**
+   * \brief Add a layer to the layer graph and calculate its output shape.
+   * \param name the name of the layer
+   * \param description the type and shape of the layer (e.g., "conv 20 5 1")
+   * \param params_dir path to the directory that contains the weights
+   * \return true if the layer is valid, false otherwise
+   */
+  bool addLayer(const std::string &name, const std::string &description,
+                const std::string &params_dir);
+
+  /**
+   * \brief Fuse the ReLU and pooling layers that follow a conv layer into the
+   * conv layer.
+   *
+   * Each conv layer absorbs the following spatial ReLU layers and at most one
+   * pooling layer. Because max pooling and ReLU commute, their order does not
+   * matter.
+   */
+  void fuseLayers();
+
+  /**
+   * \brief Read the FP32 parameters of a layer. The parameters are used in
+   * place if they are in the weight bundle, otherwise they are read from
+   * <name>_weights.bin and <name>_biases.bin.
+   * \param node the node of the layer
+   * \param params_dir path to the directory that contains the weights
+   * \param[out] layer the layer
+   * \return true if the parameters match the layer, false otherwise
+   */
+  bool readWeights(const LayerNode &node, const std::string &params_dir,
+                   Layer &layer);
+
+  /**
+   * \brief Read the INT8 parameters of a layer.
+   * \param node the node of the layer
+   * \param params_dir path to the directory that contains the weights
+   * \return true if the parameters match the layer, false otherwise
+   */
+  bool readQuantizedWeights(const LayerNode &node,
+                            const std::string &params_dir);
+
+  /**
+   * \brief Return a layer of the graph (conv or dense layers only).
+   * \param node the node of the layer
+   * \return the layer
+   */
+  Layer &getLayer(const LayerNode &node) const;
+
+  /**
+   * \brief Allocate the scratch memory for a batch of <batch_size_> images.
+   * \param[out] workspace the scratch memory
+   */
+  void initWorkspace(Workspace &workspace) const;
+
+  /**
+   * \brief Batched forward pass of the network.
+   * \param images the grasp images (NCHW, FP32)
+   * \param start the index of the first image of the batch
+   * \param num_images the number of images in the batch (at most
+   * <batch_size_>)
+   * \param workspace the scratch memory of the calling thread
+   * \param[out] scores the score of each image in the batch
+   * \param[in,out] input_ranges the largest absolute value of the input of
+   * each layer (updated if not null, FP32 forward pass only)
+   */
+  void forward(const ImageTensor &images, int start, int num_images,
+               Workspace &workspace, float *scores,
+               std::vector<float> *input_ranges = nullptr) const;
 
   /**
    * \brief Forward pass for a max pooling layer.
-   * \param X input
+   * \param x input (<num_planes> square planes, one after another)
+   * \param num_planes the number of planes (channels times images)
+   * \param width_in the width of each input plane
    * \param filter_size the size of the filter
    * \param stride the stride at which to apply the filter
+   * \param[out] y output (<num_planes> square planes, one after another)
    */
-  Eigen::MatrixXf poolForward(const Eigen::MatrixXf &X, int filter_size,
-                              int stride) const;
+  void poolForward(const float *x, int num_planes, int width_in,
+                   int filter_size, int stride, float *y) const;
 
   /**
    * \brief Read a binary file into a vector.
    * \param location path to the binary file
    */
-  std::vector<float> readBinaryFileIntoVector(const std::string &location);
+  template <typename T = float>
+  std::vector<T> readBinaryFileIntoVector(const std::string &location);
+
+  /**
+   * \brief Write a vector into a binary file.
+   * \param location path to the binary file
+   * \param vals the values to be written
+   * \return true if the file has been written, false otherwise
+   */
+  template <typename T>
+  bool writeVectorIntoBinaryFile(const std::string &location,
+                                 const std::vector<T> &vals) const;
+
+  // The bundle is declared before the layers so that it outlives them.
+  std::shared_ptr<const WeightBundle> bundle_;  ///< mapped parameters
+  std::vector<LayerNode> nodes_;  ///< the layer graph (in order)
+  std::vector<std::unique_ptr<ConvLayer>> conv_layers_;    ///< conv layers
+  std::vector<std::unique_ptr<DenseLayer>> dense_layers_;  ///< dense layers
+  std::vector<Workspace> workspaces_;  ///< scratch memory of each thread
+  int image_size_;    ///< width and height of the input images
+  int num_channels_;  ///< number of channels of the input images
+  bool is_valid_;     ///< if the layer graph is valid
+  bool is_quantized_;  ///< if the INT8 forward pass is used
+  int batch_size_;  ///< number of images per forward pass
+  int num_threads_;  ///< number of CPU threads to be used
 
-  std::unique_ptr<ConvLayer> conv1_;                  ///< 1st conv layer
-  std::unique_ptr<ConvLayer> conv2_;                  ///< 2nd conv layer
-  std::unique_ptr<DenseLayer> dense1_;                ///< 1st dense layer
-  std::unique_ptr<DenseLayer> dense2_;                ///< 2nd dense layer
-  std::vector<float> x_dense1_, x_dense2_, x_conv2_;  ///< inputs for layers
-  int num_threads_{1};
+  static const int DEFAULT_BATCH_SIZE;  ///< default number of images per pass
+  static const std::string DEFAULT_NETWORK_FILE;  ///< name of the description
 };
 
 }  // namespace net
@@ -0,0 +1,195 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef IMAGE_TENSOR_H_
+#define IMAGE_TENSOR_H_
+
+// System
+#include <cstdint>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+namespace gpd {
+namespace net {
+
+/**
+ *
+ * \brief Contiguous batch of grasp images
+ *
+ * Stores N grasp images of size HxW with C channels in one contiguous buffer,
+ * in the memory layout and precision expected by a classifier. The descriptor
+ * stage writes each image straight into its slot so that the classifier can
+ * read the batch without repacking it.
+ *
+ */
+class ImageTensor {
+ public:
+  /** Memory layout of the tensor. */
+  enum class Layout : uint8_t { eNCHW = 0, eNHWC = 1 };
+
+  /** Data type of the tensor elements. */
+  enum class Precision : uint8_t { eFP32 = 0, eU8 = 1 };
+
+  /**
+   * \brief Constructor.
+   * \param layout the memory layout
+   * \param precision the data type of the elements
+   */
+  ImageTensor(Layout layout = Layout::eNCHW,
+              Precision precision = Precision::eFP32);
+
+  /**
+   * \brief Set the dimensions of the tensor. Memory allocated by earlier calls
+   * is reused.
+   * \param num_images the number of images (N)
+   * \param rows the number of rows of each image (H)
+   * \param cols the number of columns of each image (W)
+   * \param channels the number of channels of each image (C)
+   */
+  void resize(int num_images, int rows, int cols, int channels);
+
+  /**
+   * \brief Store an image in the tensor.
+   *
+   * Does nothing if <image> already refers to the memory of the slot (see
+   * wrapImage()).
+   *
+   * \param index the index of the image in the tensor
+   * \param image the image (rows x cols, CV_8UC(channels), interleaved)
+   */
+  void setImage(int index, const cv::Mat &image);
+
+  /**
+   * \brief Return an image header that refers to the memory of a slot. This is
+   * only possible if the tensor stores interleaved uchar images (NHWC, U8).
+   * \param index the index of the image in the tensor
+   * \return the image header, empty if the layout does not match
+   */
+  cv::Mat wrapImage(int index);
+
+  /**
+   * \brief Return a copy of an image in the tensor.
+   * \param index the index of the image in the tensor
+   * \return the image (rows x cols, CV_8UC(channels), interleaved)
+   */
+  cv::Mat getImage(int index) const;
+
+  /**
+   * \brief Return the elements of an image (FP32 precision only).
+   * \param index the index of the image in the tensor
+   * \return pointer to the first element of the image
+   */
+  const float *getFloatData(int index = 0) const {
+    return float_data_.data() + (size_t)index * getImageSize();
+  }
+
+  /**
+   * \brief Return the elements of an image (U8 precision only).
+   * \param index the index of the image in the tensor
+   * \return pointer to the first element of the image
+   */
+  const uchar *getByteData(int index = 0) const {
+    return byte_data_.data() + (size_t)index * getImageSize();
+  }
+
+  /**
+   * \brief Return the number of elements in each image.
+   * \return the number of elements in each image
+   */
+  int getImageSize() const { return rows_ * cols_ * channels_; }
+
+  /**
+   * \brief Return the number of images.
+   * \return the number of images
+   */
+  int size() const { return num_images_; }
+
+  int getRows() const { return rows_; }
+
+  int getCols() const { return cols_; }
+
+  int getChannels() const { return channels_; }
+
+  Layout getLayout() const { return layout_; }
+
+  Precision getPrecision() const { return precision_; }
+
+  /**
+   * \brief Convert interleaved pixels into planes (HWC to CHW).
+   * \param src the interleaved pixels
+   * \param num_pixels the number of pixels
+   * \param channels the number of channels of each pixel
+   * \param plane_size the number of elements between two planes in <dst>
+   * \param[out] dst the first element of the first plane
+   */
+  static void deinterleave(const uchar *src, int num_pixels, int channels,
+                           int plane_size, float *dst);
+
+  /**
+   * \brief Same as above, but keeps the pixels as bytes (for U8 tensors).
+   */
+  static void deinterleave(const uchar *src, int num_pixels, int channels,
+                           int plane_size, uchar *dst);
+
+ private:
+  /**
+   * \brief Copy an interleaved image into the tensor's layout.
+   * \param image the image
+   * \param dst the first element of the slot
+   */
+  template <typename T>
+  void packImage(const cv::Mat &image, T *dst) const;
+
+  /**
+   * \brief Copy the elements of a slot into an interleaved image.
+   * \param src the first element of the slot
+   * \param image the image
+   */
+  template <typename T>
+  void unpackImage(const T *src, cv::Mat &image) const;
+
+  Layout layout_;
+  Precision precision_;
+  int num_images_;
+  int rows_;
+  int cols_;
+  int channels_;
+  std::vector<float> float_data_;  ///< elements for FP32 precision
+  std::vector<uchar> byte_data_;   ///< elements for U8 precision
+};
+
+}  // namespace net
+}  // namespace gpd
+
+#endif /* IMAGE_TENSOR_H_ */
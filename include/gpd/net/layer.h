@@ -34,6 +34,9 @@
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 
 namespace gpd {
@@ -64,13 +67,181 @@ class Layer {
    */
   void setWeightsAndBiases(const std::vector<float> &weights,
                            const std::vector<float> &biases) {
+    weights_storage_ = weights;
+    biases_storage_ = biases;
+    setWeightsAndBiases(weights_storage_.data(), weights_storage_.size(),
+                        biases_storage_.data(), biases_storage_.size());
+  }
+
+  /**
+   * \brief Set the parameters of the layer without copying them. The memory
+   * needs to stay valid as long as the layer is used (e.g., a mapped
+   * `WeightBundle`).
+   * \param weights the weights
+   * \param num_weights the number of weights
+   * \param biases the biases
+   * \param num_biases the number of biases
+   */
+  void setWeightsAndBiases(const float *weights, int num_weights,
+                           const float *biases, int num_biases) {
     weights_ = weights;
+    num_weights_ = num_weights;
     biases_ = biases;
+    num_biases_ = num_biases;
   }
 
+  const float *getWeights() const { return weights_; }
+
+  int getNumWeights() const { return num_weights_; }
+
+  const float *getBiases() const { return biases_; }
+
+  int getNumBiases() const { return num_biases_; }
+
+  /**
+   * \brief Set the INT8 parameters of the layer. A weight w is approximated by
+   * q * weight_scales[i] where q is its quantized value and i is the output
+   * channel it belongs to. An input x is quantized as round(x / input_scale).
+   * \param weights the quantized weights (one row per output channel)
+   * \param weight_scales the scale of the weights of each output channel
+   * \param input_scale the scale of the quantized input
+   */
+  void setQuantizedWeights(const std::vector<int8_t> &weights,
+                           const std::vector<float> &weight_scales,
+                           float input_scale) {
+    quantized_weights_.assign(weights.begin(), weights.end());
+    weight_scales_ = weight_scales;
+    input_scale_ = input_scale;
+  }
+
+  /**
+   * \brief Quantize the weights of the layer to INT8 (one scale per output
+   * channel).
+   * \param input_scale the scale of the quantized input
+   */
+  virtual void quantize(float input_scale) = 0;
+
+  /**
+   * \brief Return if the layer has INT8 parameters.
+   * \return true if the layer has INT8 parameters, false otherwise
+   */
+  bool isQuantized() const { return !quantized_weights_.empty(); }
+
+  std::vector<int8_t> getQuantizedWeights() const {
+    return std::vector<int8_t>(quantized_weights_.begin(),
+                               quantized_weights_.end());
+  }
+
+  const std::vector<float> &getWeightScales() const { return weight_scales_; }
+
+  float getInputScale() const { return input_scale_; }
+
  protected:
-  std::vector<float> weights_;
-  std::vector<float> biases_;
+  /**
+   * \brief Quantize a value to INT8.
+   * \param x the value
+   * \param inv_scale the inverse of the scale
+   * \return the quantized value
+   */
+  static int16_t quantizeValue(float x, float inv_scale) {
+    // Round to nearest (away from zero on ties).
+    const float q = std::max(-127.0f, std::min(127.0f, x * inv_scale));
+    return static_cast<int16_t>(q + (q >= 0.0f ? 0.5f : -0.5f));
+  }
+
+  /**
+   * \brief Pass a uchar value through (uchar inputs are not quantized).
+   * \param x the value
+   * \return the value
+   */
+  static int16_t quantizeValue(uint8_t x, float) { return x; }
+
+  /**
+   * \brief Calculate the dot product of a quantized input and a row of
+   * quantized weights with 32-bit integer accumulation.
+   * \param x the quantized input
+   * \param w the quantized weights
+   * \param n the number of elements
+   * \return the dot product
+   */
+  static int32_t dotProduct(const int16_t *x, const int16_t *w, int n) {
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += static_cast<int32_t>(x[i]) * w[i];
+    }
+    return sum;
+  }
+
+  /**
+   * \brief Calculate the dot products of a quantized input and four
+   * consecutive rows of quantized weights. Each input element is loaded once
+   * for all four rows.
+   * \param x the quantized input
+   * \param w the first of the four rows of quantized weights
+   * \param n the number of elements (the length of each row)
+   * \param[out] dots the four dot products
+   */
+  static void dotProducts4(const int16_t *x, const int16_t *w, int n,
+                           int32_t *dots) {
+    const int16_t *w1 = w + n;
+    const int16_t *w2 = w + 2 * n;
+    const int16_t *w3 = w + 3 * n;
+    int32_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for (int i = 0; i < n; i++) {
+      const int32_t xi = x[i];
+      sum0 += xi * w[i];
+      sum1 += xi * w1[i];
+      sum2 += xi * w2[i];
+      sum3 += xi * w3[i];
+    }
+    dots[0] = sum0;
+    dots[1] = sum1;
+    dots[2] = sum2;
+    dots[3] = sum3;
+  }
+
+  /**
+   * \brief Quantize the rows of a weight matrix symmetrically to [-127, 127].
+   * \param weights the weights (row i starts at weights[i * row_stride] and
+   * its elements are <col_stride> apart)
+   * \param rows the number of rows (output channels)
+   * \param cols the number of columns
+   * \param row_stride the distance between two rows in <weights>
+   * \param col_stride the distance between two columns in <weights>
+   * \param input_scale the scale of the quantized input
+   */
+  void quantizeRows(const float *weights, int rows, int cols, int row_stride,
+                    int col_stride, float input_scale) {
+    quantized_weights_.resize((size_t)rows * cols);
+    weight_scales_.resize(rows);
+    input_scale_ = input_scale;
+
+    for (int i = 0; i < rows; i++) {
+      const float *row = weights + (size_t)i * row_stride;
+      float max = 0.0f;
+      for (int j = 0; j < cols; j++) {
+        max = std::max(max, std::abs(row[j * col_stride]));
+      }
+      weight_scales_[i] = (max > 0.0f) ? max / 127.0f : 1.0f;
+
+      int16_t *dst = &quantized_weights_[(size_t)i * cols];
+      for (int j = 0; j < cols; j++) {
+        dst[j] = quantizeValue(row[j * col_stride], 1.0f / weight_scales_[i]);
+      }
+    }
+  }
+
+  const float *weights_ = nullptr;  ///< points to the storage or a bundle
+  const float *biases_ = nullptr;   ///< points to the storage or a bundle
+  int num_weights_ = 0;
+  int num_biases_ = 0;
+  std::vector<float> weights_storage_;  ///< copied weights (if any)
+  std::vector<float> biases_storage_;   ///< copied biases (if any)
+  // The INT8 weights are stored with 16 bits so that the dot products map to
+  // 16-bit multiply-add instructions.
+  std::vector<int16_t> quantized_weights_;  ///< one row per output channel
+  std::vector<float> weight_scales_;  ///< scale of each output channel
+  float input_scale_ = 1.0f;          ///< scale of the quantized input
 };
 
 }  // namespace net
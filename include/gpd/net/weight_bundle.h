@@ -0,0 +1,156 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef WEIGHT_BUNDLE_H_
+#define WEIGHT_BUNDLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gpd {
+namespace net {
+
+/**
+ *
+ * \brief Single-file bundle of network parameters.
+ *
+ * A bundle stores named tensors (shape, data type, checksum) in one file. The
+ * file starts with a header and a table of the tensors, followed by the data
+ * of each tensor at a 64-byte aligned offset. The file is memory-mapped, so
+ * the layers can use the parameters in place without copying them.
+ *
+ */
+class WeightBundle {
+ public:
+  /** \brief Data types of the tensors. */
+  enum class DataType : uint32_t { eFP32 = 0, eINT8 = 1 };
+
+  /**
+   * \brief A named tensor. The data is owned by the bundle (or, when writing a
+   * bundle, by the caller).
+   */
+  struct Tensor {
+    std::string name;        ///< the name of the tensor
+    DataType dtype;          ///< the data type of the elements
+    std::vector<int> shape;  ///< the size of each dimension
+    const void *data;        ///< the elements
+    size_t num_bytes;        ///< the size of the data in bytes
+
+    /**
+     * \brief Return the number of elements.
+     * \return the number of elements
+     */
+    size_t size() const;
+
+    /**
+     * \brief Return the elements as FP32 values.
+     * \return the elements
+     */
+    const float *floats() const { return static_cast<const float *>(data); }
+  };
+
+  /**
+   * \brief Destructor. Unmaps the file.
+   */
+  ~WeightBundle();
+
+  /**
+   * \brief Memory-map a bundle and check its header and checksums.
+   *
+   * A bundle that is already open in this process is shared, so that multiple
+   * classifiers do not map the same file twice.
+   *
+   * \param filename the location of the bundle
+   * \return the bundle, or nullptr if the file is not a valid bundle
+   */
+  static std::shared_ptr<const WeightBundle> open(
+      const std::string &filename);
+
+  /**
+   * \brief Write tensors into a bundle. The file is written under a temporary
+   * name and then renamed, so that processes which have mapped the old bundle
+   * are not affected.
+   * \param filename the location of the bundle
+   * \param tensors the tensors
+   * \return true if the bundle has been written, false otherwise
+   */
+  static bool write(const std::string &filename,
+                    const std::vector<Tensor> &tensors);
+
+  /**
+   * \brief Find a tensor by its name.
+   * \param name the name of the tensor
+   * \return the tensor, or nullptr if there is no tensor with that name
+   */
+  const Tensor *find(const std::string &name) const;
+
+  /**
+   * \brief Return the tensors in the bundle.
+   * \return the tensors
+   */
+  const std::vector<Tensor> &getTensors() const { return tensors_; }
+
+  static const uint32_t VERSION;  ///< version of the file format
+  static const int ALIGNMENT;     ///< alignment of the data of each tensor
+  static const int MAX_DIMS;      ///< maximum number of dimensions of a tensor
+
+ private:
+  WeightBundle() : data_(nullptr), size_(0) {}
+
+  /**
+   * \brief Memory-map a file and read its tensor table.
+   * \param filename the location of the bundle
+   * \return true if the file is a valid bundle, false otherwise
+   */
+  bool map(const std::string &filename);
+
+  /**
+   * \brief Calculate the checksum of a block of memory (64-bit FNV-1a over
+   * 8-byte words).
+   * \param data the memory
+   * \param num_bytes the size of the memory in bytes
+   * \return the checksum
+   */
+  static uint64_t checksum(const void *data, size_t num_bytes);
+
+  void *data_;                   ///< the mapped file
+  size_t size_;                  ///< the size of the mapped file in bytes
+  std::vector<Tensor> tensors_;  ///< the tensors (pointing into <data_>)
+};
+
+}  // namespace net
+}  // namespace gpd
+
+#endif /* WEIGHT_BUNDLE_H_ */
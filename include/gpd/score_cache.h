@@ -0,0 +1,135 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SCORE_CACHE_H_
+#define SCORE_CACHE_H_
+
+// System
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include <gpd/candidate/hand.h>
+#include <gpd/util/cloud.h>
+
+namespace gpd {
+
+/**
+ *
+ * \brief Cache the scores of grasp candidates
+ *
+ * Least recently used (LRU) cache that maps grasp candidates to the scores
+ * given by the classifier. The key of a candidate is a hash of its quantized
+ * pose and of the point cloud, so candidates that are found again in the same
+ * scene (e.g., by repeated detection on a static scene) skip both image
+ * creation and classification.
+ *
+ */
+class ScoreCache {
+ public:
+  /**
+   * \brief Constructor.
+   * \param capacity the maximum number of scores in the cache
+   * \param position_resolution the resolution at which positions are
+   * quantized (in meters, must be positive)
+   * \param orientation_resolution the resolution at which the entries of the
+   * hand orientation are quantized (must be positive)
+   */
+  ScoreCache(int capacity, double position_resolution,
+             double orientation_resolution);
+
+  /**
+   * \brief Compute a hash of the points and the camera view points of a point
+   * cloud.
+   * \param cloud the point cloud
+   * \return the hash
+   */
+  static uint64_t hashCloud(const util::Cloud &cloud);
+
+  /**
+   * \brief Compute the key of a grasp candidate.
+   * \param hand the grasp candidate
+   * \param cloud_hash the hash of the point cloud (see hashCloud())
+   * \return the key
+   */
+  uint64_t computeKey(const candidate::Hand &hand, uint64_t cloud_hash) const;
+
+  /**
+   * \brief Look up the score for a key, and mark it as the most recently
+   * used.
+   * \param key the key
+   * \param[out] score the score, only set if the key is found
+   * \return `true` if the key is found, `false` otherwise
+   */
+  bool find(uint64_t key, float &score);
+
+  /**
+   * \brief Insert a score. If the cache is full, the least recently used score
+   * is evicted.
+   * \param key the key
+   * \param score the score
+   */
+  void insert(uint64_t key, float score);
+
+  /**
+   * \brief Remove all scores and reset the counters.
+   */
+  void clear();
+
+  /**
+   * \brief Return the number of scores in the cache.
+   * \return the number of scores
+   */
+  int size() const { return entries_.size(); }
+
+  int getCapacity() const { return capacity_; }
+
+  long getNumHits() const { return num_hits_; }
+
+  long getNumMisses() const { return num_misses_; }
+
+ private:
+  typedef std::list<std::pair<uint64_t, float>> EntryList;
+
+  int capacity_;
+  double position_resolution_;
+  double orientation_resolution_;
+  EntryList entries_;  ///< keys and scores, most recently used first
+  std::unordered_map<uint64_t, EntryList::iterator> index_;  ///< key -> entry
+  long num_hits_;
+  long num_misses_;
+};
+
+}  // namespace gpd
+
+#endif /* SCORE_CACHE_H_ */
@@ -0,0 +1,113 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TOP_K_SELECTOR_H_
+#define TOP_K_SELECTOR_H_
+
+// System
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gpd/candidate/hand.h>
+
+namespace gpd {
+
+/**
+ *
+ * \brief Select the k highest scoring grasps incrementally
+ *
+ * Keeps the k highest scoring grasps pushed so far in a min-heap, so the
+ * lowest of them (the score a new grasp has to beat) is always at hand. A
+ * grasp whose upper bound on the score does not beat it can be skipped before
+ * its image is created and classified.
+ *
+ */
+class TopKSelector {
+ public:
+  /**
+   * \brief Constructor.
+   * \param k the number of grasps to be selected
+   */
+  TopKSelector(int k) : k_(k) {}
+
+  /**
+   * \brief Check if a grasp with a given score (or an upper bound on its
+   * score) would be selected.
+   * \param score the score
+   * \return `true` if the grasp would be selected, `false` otherwise
+   */
+  bool canEnter(double score) const {
+    return k_ > 0 && (heap_.size() < k_ || score > heap_[0]->getScore());
+  }
+
+  /**
+   * \brief Add a grasp. If k grasps are selected already, the lowest scoring
+   * grasp is dropped.
+   * \param hand the grasp
+   * \return `true` if the grasp is selected, `false` otherwise
+   */
+  bool push(std::unique_ptr<candidate::Hand> hand);
+
+  /**
+   * \brief Return the selected grasps, sorted by their score, and reset the
+   * selector.
+   * \return the selected grasps
+   */
+  std::vector<std::unique_ptr<candidate::Hand>> extract();
+
+  /**
+   * \brief Return the lowest score among the selected grasps.
+   * \return the lowest score
+   */
+  double getMinScore() const { return heap_[0]->getScore(); }
+
+  int size() const { return heap_.size(); }
+
+  bool isFull() const { return heap_.size() >= k_; }
+
+ private:
+  /**
+   * \brief Heap order: the lowest score is at the front.
+   */
+  static bool isScoreGreater(const std::unique_ptr<candidate::Hand> &hand1,
+                             const std::unique_ptr<candidate::Hand> &hand2) {
+    return hand1->getScore() > hand2->getScore();
+  }
+
+  int k_;
+  std::vector<std::unique_ptr<candidate::Hand>> heap_;  ///< min-heap of grasps
+};
+
+}  // namespace gpd
+
+#endif /* TOP_K_SELECTOR_H_ */
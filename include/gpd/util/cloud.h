@@ -33,9 +33,11 @@
 #define CLOUD_H_
 
 #include <math.h>
+#include <stdint.h>
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include <Eigen/Dense>
@@ -65,6 +67,7 @@ typedef pcl::PointCloud<pcl::PointXYZ> PointCloudXYZ;
 typedef pcl::PointCloud<pcl::PointXYZRGBA> PointCloudRGB;
 typedef pcl::PointCloud<pcl::PointNormal> PointCloudPointNormal;
 typedef pcl::PointCloud<pcl::Normal> PointCloudNormal;
+typedef pcl::search::KdTree<pcl::PointXYZRGBA> KdTreeRGB;
 
 /**
  *
@@ -214,8 +217,28 @@ class Cloud {
    * \brief Voxelize the point cloud and keep track of the camera source for
    * each voxel.
    * \param[in] cell_size the size of each voxel
+   * \param[in] align_to_origin if the voxel grid is aligned to the origin
+   * instead of the minimum of the cloud, so that the voxels of consecutive
+   * clouds can be compared
    */
-  void voxelizeCloud(float cell_size);
+  void voxelizeCloud(float cell_size, bool align_to_origin = false);
+
+  /**
+   * \brief Voxelize the point cloud in parallel.
+   *
+   * Each point is assigned the Morton code of the voxel it falls into. The
+   * (code, index) pairs are sorted in parallel and each run of equal codes is
+   * reduced to one voxel. The voxel positions and the averaged surface normals
+   * are the same as for voxelizeCloud(), but the camera source of a voxel is
+   * the union over all of its points. Falls back to voxelizeCloud() if the
+   * cloud spans more than 2^21 voxels along one axis.
+   * \param[in] cell_size the size of each voxel
+   * \param[in] num_threads the number of CPU threads to be used
+   * \param[in] align_to_origin if the voxel grid is aligned to the origin
+   * (see voxelizeCloud())
+   */
+  void voxelizeCloudParallel(float cell_size, int num_threads,
+                             bool align_to_origin = false);
 
   /**
    * \brief Subsample the point cloud according to the uniform distribution.
@@ -257,6 +280,16 @@ class Cloud {
    */
   void calculateNormals(int num_threads, double radius);
 
+  /**
+   * \brief Calculate the surface normals of a subset of the points, and keep
+   * the normals of the other points.
+   * \param[in] num_threads the number of CPU threads to be used
+   * \param[in] radius the neighborhood search radius
+   * \param[in] indices the indices of the points
+   */
+  void calculateNormals(int num_threads, double radius,
+                        const std::vector<int> &indices);
+
   /**
    * \brief Calculate surface normals for an organized point cloud.
    */
@@ -313,6 +346,15 @@ class Cloud {
    */
   const PointCloudRGB::Ptr &getCloudOriginal() const { return cloud_original_; }
 
+  /**
+   * \brief Return the spatial index for the preprocessed point cloud.
+   *
+   * The kd-tree is built on the first call and then shared by all stages that
+   * search the cloud until the preprocessed point cloud changes.
+   * \return the kd-tree
+   */
+  const KdTreeRGB::Ptr &getSearchTree() const;
+
   /**
    * \brief Return the original point cloud.
    * \return the point cloud
@@ -345,6 +387,25 @@ class Cloud {
    */
   void setSamples(const Eigen::Matrix3Xd &samples);
 
+  /**
+   * \brief Return the points in the regions that changed since the previous
+   * point cloud (see VoxelMap).
+   * \return the mask (size: n, empty if unknown)
+   */
+  const Eigen::Array<bool, 1, Eigen::Dynamic> &getChangedMask() const {
+    return changed_mask_;
+  }
+
+  /**
+   * \brief Set the points in the regions that changed since the previous point
+   * cloud. The mask is cleared when the points change.
+   * \param changed_mask the mask (size: n)
+   */
+  void setChangedMask(
+      const Eigen::Array<bool, 1, Eigen::Dynamic> &changed_mask) {
+    changed_mask_ = changed_mask;
+  }
+
   /**
    * \brief Set the surface normals.
    * \return the surface normals (size: 3 x n)
@@ -375,9 +436,30 @@ class Cloud {
  private:
   std::vector<std::vector<int>> convertCameraSourceMatrixToLists();
 
+  /**
+   * \brief Interleave the bits of a voxel index into a 63-bit Morton code.
+   * \param cell the voxel index (each element must be in [0, 2^21))
+   * \return the Morton code
+   */
+  static uint64_t encodeMorton(const Eigen::Vector3i &cell);
+
+  /**
+   * \brief Sort a list of (key, index) pairs using multiple threads.
+   *
+   * Each thread sorts one contiguous chunk, and the sorted chunks are then
+   * merged pairwise.
+   * \param[in,out] keys the list to be sorted
+   * \param[in] num_threads the number of CPU threads to be used
+   */
+  static void sortKeys(std::vector<std::pair<uint64_t, int>> &keys,
+                       int num_threads);
+
   PointCloudRGB::Ptr cloud_processed_;
   PointCloudRGB::Ptr cloud_original_;
 
+  // spatial index for <cloud_processed_> (reset whenever it changes)
+  mutable KdTreeRGB::Ptr search_tree_;
+
   // binary matrix: (i,j) = 1 if point j is seen by camera i, 0 otherwise
   Eigen::MatrixXi camera_source_;
   Eigen::Matrix3Xd normals_;
@@ -385,6 +467,9 @@ class Cloud {
 
   std::vector<int> sample_indices_;
   Eigen::Matrix3Xd samples_;
+
+  // points in changed regions (empty if unknown)
+  Eigen::Array<bool, 1, Eigen::Dynamic> changed_mask_;
 };
 
 }  // namespace util
@@ -0,0 +1,115 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef NEIGHBORHOOD_H_
+#define NEIGHBORHOOD_H_
+
+#include <algorithm>
+#include <vector>
+
+namespace gpd {
+namespace util {
+
+/**
+ *
+ * \brief Point neighborhood of a sample
+ *
+ * Stores the indices of the points within a given radius of a sample, sorted
+ * by their distance to the sample. Because the indices are sorted, the
+ * neighborhood for any smaller radius is a prefix of the stored indices. This
+ * allows the different stages of the grasp detection (local reference frame
+ * estimation, hand search, and image generation) to share the result of a
+ * single radius search.
+ *
+ */
+class Neighborhood {
+ public:
+  /**
+   * \brief Default constructor.
+   */
+  Neighborhood() : radius_(0.0) {}
+
+  /**
+   * \brief Constructor.
+   * \param radius the radius of the search that found the neighborhood
+   * \param indices the indices of the points, sorted by their distance
+   * \param sqr_dists the squared distances of the points (ascending)
+   */
+  Neighborhood(double radius, std::vector<int> &&indices,
+               std::vector<float> &&sqr_dists)
+      : radius_(radius),
+        indices_(std::move(indices)),
+        sqr_dists_(std::move(sqr_dists)) {}
+
+  /**
+   * \brief Return the number of points within a given radius.
+   *
+   * The points within the radius are the first *n* elements of the indices
+   * returned by getIndices(). As for the radius search, points exactly on the
+   * radius are included.
+   * \param radius the radius (must not be larger than the search radius)
+   * \return the number of points within the radius
+   */
+  int countWithin(double radius) const {
+    return std::upper_bound(sqr_dists_.begin(), sqr_dists_.end(),
+                            static_cast<float>(radius * radius)) -
+           sqr_dists_.begin();
+  }
+
+  /**
+   * \brief Return the radius of the search that found the neighborhood.
+   * \return the search radius
+   */
+  double getRadius() const { return radius_; }
+
+  /**
+   * \brief Return the indices of the points, sorted by their distance.
+   * \return the indices
+   */
+  const std::vector<int> &getIndices() const { return indices_; }
+
+  /**
+   * \brief Return the number of points in the neighborhood.
+   * \return the number of points
+   */
+  int size() const { return indices_.size(); }
+
+ private:
+  double radius_;
+  std::vector<int> indices_;
+  std::vector<float> sqr_dists_;
+};
+
+}  // namespace util
+}  // namespace gpd
+
+#endif /* NEIGHBORHOOD_H_ */
@@ -0,0 +1,207 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OCCLUSION_GRID_H_
+#define OCCLUSION_GRID_H_
+
+#include <Eigen/Dense>
+
+#include <stdint.h>
+#include <limits>
+#include <vector>
+
+namespace gpd {
+namespace util {
+
+/**
+ * \brief Visit the voxels that a line segment passes through.
+ *
+ * Walks the segment with a 3-D DDA (digital differential analyzer) and calls
+ * <visit> once for each voxel, in order from <start> to <end>. Voxel *v*
+ * covers the points *p* with `floor(p) = v`.
+ * \param start the start of the segment in voxel units
+ * \param end the end of the segment in voxel units
+ * \param visit the function called with each voxel (`Eigen::Vector3i`)
+ */
+template <typename Function>
+void traverseVoxels(const Eigen::Vector3d &start, const Eigen::Vector3d &end,
+                    Function visit) {
+  Eigen::Vector3i voxel = start.array().floor().cast<int>();
+  const Eigen::Vector3i end_voxel = end.array().floor().cast<int>();
+  const Eigen::Vector3d dir = end - start;
+
+  // For each axis: the direction of the steps, the segment parameter at which
+  // the next voxel boundary is crossed, and the parameter increment per voxel.
+  Eigen::Vector3i step;
+  Eigen::Vector3d t_max;
+  Eigen::Vector3d t_delta;
+  for (int j = 0; j < 3; j++) {
+    if (dir(j) > 0.0) {
+      step(j) = 1;
+      t_max(j) = (voxel(j) + 1 - start(j)) / dir(j);
+      t_delta(j) = 1.0 / dir(j);
+    } else if (dir(j) < 0.0) {
+      step(j) = -1;
+      t_max(j) = (voxel(j) - start(j)) / dir(j);
+      t_delta(j) = -1.0 / dir(j);
+    } else {
+      step(j) = 0;
+      t_max(j) = std::numeric_limits<double>::infinity();
+      t_delta(j) = std::numeric_limits<double>::infinity();
+    }
+  }
+
+  // The number of boundary crossings along each axis is known in advance, so
+  // the walk always ends in <end_voxel>.
+  Eigen::Vector3i remaining = (end_voxel - voxel).cwiseAbs();
+  const int num_steps = remaining.sum();
+  visit(voxel);
+
+  for (int k = 0; k < num_steps; k++) {
+    int axis = -1;
+    for (int j = 0; j < 3; j++) {
+      if (remaining(j) > 0 && (axis == -1 || t_max(j) < t_max(axis))) {
+        axis = j;
+      }
+    }
+    voxel(axis) += step(axis);
+    t_max(axis) += t_delta(axis);
+    remaining(axis)--;
+    visit(voxel);
+  }
+}
+
+/**
+ *
+ * \brief Dense bitmap of occluded voxels
+ *
+ * Stores one bit per voxel for a box-shaped region of a regular voxel grid.
+ * Voxel *v* covers the points *p* with `floor(p / voxel_size) = v`. Voxels are
+ * marked by walking rays through the grid with a 3-D DDA (digital
+ * differential analyzer), which visits every voxel that a ray passes through
+ * exactly once. Two grids with the same bounds are intersected with a bitwise
+ * AND, so the voxels occluded from several cameras are found without hashing.
+ *
+ */
+class OcclusionGrid {
+ public:
+  /**
+   * \brief Constructor.
+   * \param lower the lower corner of the region covered by the grid
+   * \param upper the upper corner of the region covered by the grid
+   * \param voxel_size the size of a voxel
+   */
+  OcclusionGrid(const Eigen::Vector3d &lower, const Eigen::Vector3d &upper,
+                double voxel_size);
+
+  /**
+   * \brief Mark the voxels along a set of parallel rays.
+   *
+   * Marks each voxel that the segment from a point to the point plus the ray
+   * vector passes through. Voxels outside of the grid are ignored.
+   * \param points the origins of the rays (size: 3 x n)
+   * \param ray the direction and length of the rays
+   */
+  void castRays(const Eigen::Matrix3Xd &points, const Eigen::Vector3d &ray);
+
+  /**
+   * \brief Keep only the voxels that are also marked in another grid.
+   * \param other the other grid (must have the same bounds)
+   */
+  void intersect(const OcclusionGrid &other);
+
+  /**
+   * \brief Unmark all voxels.
+   */
+  void clear();
+
+  /**
+   * \brief Mark a voxel.
+   * \param voxel the voxel (ignored if outside of the grid)
+   */
+  void mark(const Eigen::Vector3i &voxel);
+
+  /**
+   * \brief Check if a voxel is marked.
+   * \param voxel the voxel
+   * \return true if the voxel is inside of the grid and marked
+   */
+  bool isMarked(const Eigen::Vector3i &voxel) const;
+
+  /**
+   * \brief Return the marked voxels, ordered by their position in the grid.
+   * \return the marked voxels
+   */
+  std::vector<Eigen::Vector3i> getMarkedVoxels() const;
+
+  /**
+   * \brief Return the number of marked voxels.
+   * \return the number of marked voxels
+   */
+  int countMarked() const;
+
+  /**
+   * \brief Return the voxel at the lower corner of the grid.
+   * \return the lower corner voxel
+   */
+  const Eigen::Vector3i &getMinVoxel() const { return min_voxel_; }
+
+  /**
+   * \brief Return the number of voxels along each dimension.
+   * \return the grid size
+   */
+  const Eigen::Vector3i &getSize() const { return size_; }
+
+  /**
+   * \brief Return the size of a voxel.
+   * \return the voxel size
+   */
+  double getVoxelSize() const { return voxel_size_; }
+
+ private:
+  /**
+   * \brief Return the position of a voxel in the bitmap.
+   * \param voxel the voxel
+   * \return the bit index, or -1 if the voxel is outside of the grid
+   */
+  int64_t toIndex(const Eigen::Vector3i &voxel) const;
+
+  Eigen::Vector3i min_voxel_;  ///< the voxel at the lower corner of the grid
+  Eigen::Vector3i size_;       ///< the number of voxels along each dimension
+  double voxel_size_;          ///< the size of a voxel
+  std::vector<uint64_t> bits_;  ///< one bit per voxel (x varies fastest)
+};
+
+}  // namespace util
+}  // namespace gpd
+
+#endif /* OCCLUSION_GRID_H_ */
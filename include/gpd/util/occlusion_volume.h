@@ -0,0 +1,126 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OCCLUSION_VOLUME_H_
+#define OCCLUSION_VOLUME_H_
+
+#include <Eigen/Dense>
+
+#include <stdint.h>
+#include <array>
+#include <unordered_map>
+
+#include <gpd/util/occlusion_grid.h>
+
+namespace gpd {
+namespace util {
+
+/**
+ *
+ * \brief Sparse volume of voxels occluded from a camera
+ *
+ * Stores the voxels that lie in the shadow of the points seen by one camera,
+ * i.e., behind the points as seen from the camera's view point. Unlike
+ * OcclusionGrid, the volume is unbounded: voxels are grouped into bricks of
+ * 8 x 8 x 8 voxels, and only bricks that contain occluded voxels are stored (in
+ * a hash map). This allows to calculate the occlusion of a whole scene once,
+ * and to crop it into an OcclusionGrid for each region of interest.
+ *
+ */
+class OcclusionVolume {
+ public:
+  /**
+   * \brief Constructor.
+   * \param voxel_size the size of a voxel
+   */
+  OcclusionVolume(double voxel_size) : voxel_size_(voxel_size) {}
+
+  /**
+   * \brief Mark the voxels in the shadows of a set of points.
+   *
+   * The shadow of a point is the segment that starts at the point and points
+   * away from the view point.
+   * \param points the points (size: 3 x n)
+   * \param view_point the view point of the camera that sees the points
+   * \param length the length of the shadows
+   */
+  void castShadows(const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+                   const Eigen::Vector3d &view_point, double length);
+
+  /**
+   * \brief Add the occluded voxels of another volume to this volume.
+   * \param other the other volume (must have the same voxel size)
+   */
+  void merge(const OcclusionVolume &other);
+
+  /**
+   * \brief Mark the voxels of a grid that are occluded in this volume.
+   * \param grid the grid (must have the same voxel size)
+   */
+  void crop(OcclusionGrid &grid) const;
+
+  /**
+   * \brief Mark a voxel.
+   * \param voxel the voxel
+   */
+  void mark(const Eigen::Vector3i &voxel);
+
+  /**
+   * \brief Return the number of bricks that contain occluded voxels.
+   * \return the number of bricks
+   */
+  int getNumBricks() const { return bricks_.size(); }
+
+  /**
+   * \brief Return the size of a voxel.
+   * \return the voxel size
+   */
+  double getVoxelSize() const { return voxel_size_; }
+
+ private:
+  typedef std::array<uint64_t, 8> Brick;  ///< one 64-bit word per z-slice
+
+  /**
+   * \brief Return the hash map key of a brick.
+   * \param brick the brick coordinates (voxel coordinates divided by 8)
+   * \return the key
+   */
+  static uint64_t toKey(const Eigen::Vector3i &brick);
+
+  double voxel_size_;  ///< the size of a voxel
+  std::unordered_map<uint64_t, Brick> bricks_;  ///< the occupied bricks
+};
+
+}  // namespace util
+}  // namespace gpd
+
+#endif /* OCCLUSION_VOLUME_H_ */
@@ -90,6 +90,15 @@ class PointList {
    */
   PointList slice(const std::vector<int> &indices) const;
 
+  /**
+   * \brief Slice the point list given the first elements of a set of indices.
+   * \param indices the indices to be sliced
+   * \param size the number of indices to be used
+   * \return the point list containing the points given by the first <size>
+   * indices
+   */
+  PointList slice(const std::vector<int> &indices, int size) const;
+
   /**
    * \brief Transform a point list to a robot hand frame.
    * \param centroid the origin of the frame
@@ -0,0 +1,125 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Andreas ten Pas
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef VOXEL_MAP_H_
+#define VOXEL_MAP_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <gpd/util/cloud.h>
+
+namespace gpd {
+namespace util {
+
+/**
+ *
+ * \brief Persistent voxel map for incremental point cloud preprocessing
+ *
+ * Stores the voxels of the previous point cloud together with their surface
+ * normals, the cameras that see them, and the cloud in which their normal was
+ * calculated. A new (voxelized) cloud is compared with the map voxel by voxel.
+ * Only the normals of the voxels within the normals radius of a voxel that
+ * appeared, disappeared, or is seen by other cameras are recalculated. The
+ * other voxels have the same neighborhood as before, and keep their normal.
+ *
+ */
+class VoxelMap {
+ public:
+  /**
+   * \brief Constructor.
+   * \param voxel_size the size of a voxel
+   */
+  VoxelMap(double voxel_size);
+
+  /**
+   * \brief Calculate the surface normals of a point cloud incrementally, and
+   * make the cloud the new map.
+   *
+   * The cloud must be voxelized with a grid that is aligned to the origin (see
+   * Cloud::voxelizeCloud()). Sets the changed mask of the cloud to the points
+   * whose normal was recalculated.
+   *
+   * \param cloud the point cloud
+   * \param num_threads the number of CPU threads to be used
+   * \param normals_radius the neighborhood search radius of the normals
+   */
+  void update(Cloud &cloud, int num_threads, double normals_radius);
+
+  /**
+   * \brief Remove all voxels from the map.
+   */
+  void reset();
+
+  /**
+   * \brief Return the number of voxels in the map.
+   * \return the number of voxels
+   */
+  int size() const { return voxels_.size(); }
+
+  /**
+   * \brief Return the number of normals recalculated in the last update.
+   * \return the number of normals
+   */
+  int getNumRecalculated() const { return num_recalculated_; }
+
+ private:
+  /**
+   * \brief Voxel of the map.
+   */
+  struct Voxel {
+    Eigen::Vector3f position;  ///< the position of the voxel
+    Eigen::Vector3d normal;    ///< the surface normal
+    int cameras;               ///< bit i is set if camera i sees the voxel
+    int stamp;                 ///< the update in which <normal> was calculated
+  };
+
+  /**
+   * \brief Return the hash map key of the voxel that contains a point.
+   * \param point the point
+   * \return the key
+   */
+  uint64_t toKey(const Eigen::Vector3f &point) const;
+
+  double voxel_size_;
+  int num_updates_;
+  int num_recalculated_;
+  std::unordered_map<uint64_t, Voxel> voxels_;
+};
+
+}  // namespace util
+}  // namespace gpd
+
+#endif /* VOXEL_MAP_H_ */
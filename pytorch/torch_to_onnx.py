@@ -21,5 +21,9 @@ net = Net(input_channels)
 net.load_state_dict(state_dict)
 print(net)
 
+# Keep the batch dimension dynamic so that the model can classify batches of
+# images (e.g., with OpenCV's dnn module).
 dummy_input = torch.randn(1, input_channels, 60, 60)
-torch.onnx.export(net, dummy_input, sys.argv[2], verbose=True)
+torch.onnx.export(net, dummy_input, sys.argv[2], verbose=True,
+                  input_names=['input'], output_names=['output'],
+                  dynamic_axes={'input': {0: 'batch'}, 'output': {0: 'batch'}})
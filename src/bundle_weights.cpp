@@ -0,0 +1,51 @@
+#include <string>
+
+#include <gpd/net/eigen_classifier.h>
+
+namespace gpd {
+namespace apps {
+namespace bundle_weights {
+
+int DoMain(int argc, char *argv[]) {
+  // Read arguments from command line.
+  if (argc < 2) {
+    std::cout << "Error: Not enough input arguments!\n\n";
+    std::cout << "Usage: bundle_weights PARAMS_DIR [BUNDLE_FILE]\n\n";
+    std::cout << "Convert the *.bin files of the network in PARAMS_DIR into a "
+                 "single weight bundle BUNDLE_FILE (default: "
+                 "PARAMS_DIR/weights.bundle). The INT8 parameters are "
+                 "included if PARAMS_DIR/network.cfg has <precision = "
+                 "int8>.\n\n";
+    std::cout << "Set <weights_bundle = weights.bundle> in "
+                 "PARAMS_DIR/network.cfg to use the bundle.\n";
+    return (-1);
+  }
+
+  const std::string params_dir = argv[1];
+  const std::string bundle_file =
+      (argc >= 3) ? argv[2] : params_dir + "weights.bundle";
+
+  net::EigenClassifier classifier("", params_dir, net::Classifier::Device::eCPU,
+                                  1, 1);
+  if (classifier.hasWeightBundle()) {
+    std::cout << "Error: The network already uses a weight bundle. Remove "
+                 "<weights_bundle> from network.cfg to convert the *.bin "
+                 "files.\n";
+    return (-1);
+  }
+
+  if (!classifier.saveWeightBundle(bundle_file)) {
+    return (-1);
+  }
+  printf("Wrote weight bundle to: %s\n", bundle_file.c_str());
+
+  return 0;
+}
+
+}  // namespace bundle_weights
+}  // namespace apps
+}  // namespace gpd
+
+int main(int argc, char *argv[]) {
+  return gpd::apps::bundle_weights::DoMain(argc, argv);
+}
@@ -65,6 +65,7 @@ int DoMain(int argc, char *argv[]) {
   std::cout << "deepen_step: " << hand_geom.params_.deepen_step_ << "\n";
 
   bool voxelize = config_file.getValueOfKey<bool>("voxelize", true);
+  int voxelize_method = config_file.getValueOfKey<int>("voxelize_method", 1);
   bool remove_outliers =
       config_file.getValueOfKey<bool>("remove_outliers", false);
   std::string workspace_str =
@@ -74,6 +75,7 @@ int DoMain(int argc, char *argv[]) {
   std::vector<double> workspace = stringToDouble(workspace_str);
   std::vector<double> camera_pose = stringToDouble(camera_pose_str);
   std::cout << "voxelize: " << voxelize << "\n";
+  std::cout << "voxelize_method: " << voxelize_method << "\n";
   std::cout << "remove_outliers: " << remove_outliers << "\n";
   std::cout << "workspace: " << workspace_str << "\n";
   std::cout << "camera_pose: " << camera_pose_str << "\n";
@@ -108,6 +110,7 @@ int DoMain(int argc, char *argv[]) {
   generator_params.num_threads_ = num_threads;
   generator_params.remove_statistical_outliers_ = remove_outliers;
   generator_params.voxelize_ = voxelize;
+  generator_params.voxelize_method_ = voxelize_method;
   generator_params.workspace_ = workspace;
   candidate::HandSearch::Parameters hand_search_params;
   hand_search_params.hand_geometry_ = hand_geom;
@@ -3,12 +3,23 @@
 namespace gpd {
 namespace candidate {
 
+const int CandidatesGenerator::VOXELIZE_SET = 0;
+const int CandidatesGenerator::VOXELIZE_PARALLEL = 1;
+
 CandidatesGenerator::CandidatesGenerator(
     const Parameters &params, const HandSearch::Parameters &hand_search_params)
     : params_(params) {
   Eigen::initParallel();
 
   hand_search_ = std::make_unique<candidate::HandSearch>(hand_search_params);
+
+  if (params_.incremental_preprocessing_) {
+    if (params_.voxelize_) {
+      voxel_map_ = std::make_unique<util::VoxelMap>(params_.voxel_size_);
+    } else {
+      printf("ERROR: Incremental preprocessing needs voxelization!\n");
+    }
+  }
 }
 
 void CandidatesGenerator::preprocessPointCloud(util::Cloud &cloud) {
@@ -19,11 +30,26 @@ void CandidatesGenerator::preprocessPointCloud(util::Cloud &cloud) {
 
   cloud.filterWorkspace(params_.workspace_);
 
+  // With incremental preprocessing, the voxel grid is aligned to the origin
+  // so that the voxels of consecutive clouds can be compared.
+  const bool align_to_origin = (voxel_map_ != nullptr);
+
   if (params_.voxelize_) {
-    cloud.voxelizeCloud(params_.voxel_size_);
+    double t0 = omp_get_wtime();
+    if (params_.voxelize_method_ == VOXELIZE_SET) {
+      cloud.voxelizeCloud(params_.voxel_size_, align_to_origin);
+    } else {
+      cloud.voxelizeCloudParallel(params_.voxel_size_, params_.num_threads_,
+                                  align_to_origin);
+    }
+    printf(" runtime (voxelize): %3.4f\n", omp_get_wtime() - t0);
   }
 
-  cloud.calculateNormals(params_.num_threads_, params_.normals_radius_);
+  if (voxel_map_) {
+    voxel_map_->update(cloud, params_.num_threads_, params_.normals_radius_);
+  } else {
+    cloud.calculateNormals(params_.num_threads_, params_.normals_radius_);
+  }
 
   if (params_.refine_normals_k_ > 0) {
     cloud.refineNormals(params_.refine_normals_k_);
@@ -73,5 +99,11 @@ std::vector<int> CandidatesGenerator::reevaluateHypotheses(
   return hand_search_->reevaluateHypotheses(cloud, grasps);
 }
 
+std::vector<int> CandidatesGenerator::reevaluateHypotheses(
+    const util::Cloud &cloud, std::vector<std::unique_ptr<Hand>> &grasps,
+    Eigen::Array<bool, 1, Eigen::Dynamic> &is_valid) {
+  return hand_search_->reevaluateHypotheses(cloud, grasps, is_valid);
+}
+
 }  // namespace candidate
 }  // namespace gpd
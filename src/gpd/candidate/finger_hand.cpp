@@ -1,5 +1,8 @@
 #include <gpd/candidate/finger_hand.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace gpd {
 namespace candidate {
 
@@ -23,53 +26,10 @@ FingerHand::FingerHand(double finger_width, double hand_outer_diameter,
       Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(1, num_placements, false);
 }
 
-void FingerHand::evaluateFingers(const Eigen::Matrix3Xd &points, double bite,
-                                 int idx) {
-  // Calculate top and bottom of the hand (top = fingertip, bottom = base).
-  top_ = bite;
-  bottom_ = bite - hand_depth_;
-
-  center_ = 0.0;
-
-  fingers_.setConstant(false);
-
-  // Crop points at bite.
-  std::vector<int> cropped_indices;
-  for (int i = 0; i < points.cols(); i++) {
-    if (points(forward_axis_, i) < bite) {
-      // Check that the hand would be able to extend by <bite> onto the object
-      // without causing the back of the hand to
-      // collide with <points>.
-      if (points(forward_axis_, i) < bottom_) {
-        return;
-      }
-
-      cropped_indices.push_back(i);
-    }
-  }
-
-  // Check that there is at least one point in between the fingers.
-  if (cropped_indices.size() == 0) {
-    return;
-  }
-
-  // Identify free gaps (finger placements that do not collide with the point
-  // cloud).
-  if (idx == -1) {
-    for (int i = 0; i < fingers_.size(); i++) {
-      if (isGapFree(points, cropped_indices, i)) {
-        fingers_(i) = true;
-      }
-    }
-  } else {
-    if (isGapFree(points, cropped_indices, idx)) {
-      fingers_(idx) = true;
-    }
-
-    if (isGapFree(points, cropped_indices, fingers_.size() / 2 + idx)) {
-      fingers_(fingers_.size() / 2 + idx) = true;
-    }
-  }
+void FingerHand::evaluateFingers(
+    const Eigen::Ref<const Eigen::Matrix3Xd> &points, double bite, int idx) {
+  calculateOccupancy(points, bite, idx);
+  evaluateOccupancy(bite, idx);
 }
 
 void FingerHand::evaluateHand() {
@@ -104,22 +64,25 @@ int FingerHand::chooseMiddleHand() {
   return idx;
 }
 
-int FingerHand::deepenHand(const Eigen::Matrix3Xd &points, double min_depth,
-                           double max_depth, double deepen_step) {
+int FingerHand::deepenHand(const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+                           double min_depth, double max_depth,
+                           double deepen_step) {
   // Choose middle hand.
   int hand_eroded_idx = chooseMiddleHand();  // middle index
   int opposite_idx =
       fingers_.size() / 2 + hand_eroded_idx;  // opposite finger index
 
   // Attempt to deepen hand (move as far onto the object as possible without
-  // collision).
+  // collision). The occupancy does not depend on the depth, so each step is
+  // only a comparison per finger.
+  calculateOccupancy(points, max_depth, hand_eroded_idx);
   FingerHand new_hand = *this;
   FingerHand last_new_hand = new_hand;
 
   for (double depth = min_depth + deepen_step; depth <= max_depth;
        depth += deepen_step) {
     // Check if the new hand placement is feasible
-    new_hand.evaluateFingers(points, depth, hand_eroded_idx);
+    new_hand.evaluateOccupancy(depth, hand_eroded_idx);
     if (!new_hand.fingers_(hand_eroded_idx) ||
         !new_hand.fingers_(opposite_idx)) {
       break;
@@ -138,7 +101,7 @@ int FingerHand::deepenHand(const Eigen::Matrix3Xd &points, double min_depth,
 }
 
 std::vector<int> FingerHand::computePointsInClosingRegion(
-    const Eigen::Matrix3Xd &points, int idx) {
+    const Eigen::Ref<const Eigen::Matrix3Xd> &points, int idx) {
   // Find feasible finger placement.
   if (idx == -1) {
     for (int i = 0; i < hand_.cols(); i++) {
@@ -169,17 +132,112 @@ std::vector<int> FingerHand::computePointsInClosingRegion(
   return indices;
 }
 
-bool FingerHand::isGapFree(const Eigen::Matrix3Xd &points,
-                           const std::vector<int> &indices, int idx) {
-  for (int i = 0; i < indices.size(); i++) {
-    const double &x = points(lateral_axis_, indices[i]);
+void FingerHand::calculateOccupancy(
+    const Eigen::Ref<const Eigen::Matrix3Xd> &points, double max_forward,
+    int idx) {
+  const int n = finger_spacing_.size() / 2;
+  finger_min_forward_.setConstant(finger_spacing_.size(),
+                                  std::numeric_limits<double>::infinity());
+  min_forward_ = (points.cols() > 0) ? points.row(forward_axis_).minCoeff()
+                                     : std::numeric_limits<double>::infinity();
+
+  // Points at or beyond <max_forward> cannot collide with the fingers.
+
+  // Only the <idx>-th finger placement and its opposite finger.
+  if (idx > -1) {
+    const double left[2] = {finger_spacing_(idx), finger_spacing_(n + idx)};
+    const double right[2] = {finger_spacing_(idx) + finger_width_,
+                             finger_spacing_(n + idx) + finger_width_};
+    double min_forward[2] = {std::numeric_limits<double>::infinity(),
+                             std::numeric_limits<double>::infinity()};
+
+    for (int i = 0; i < points.cols(); i++) {
+      const double y = points(forward_axis_, i);
+      if (!(y < max_forward)) {
+        continue;
+      }
+      const double x = points(lateral_axis_, i);
+      for (int j = 0; j < 2; j++) {
+        if (x > left[j] && x < right[j]) {
+          min_forward[j] = std::min(min_forward[j], y);
+        }
+      }
+    }
 
-    if (x > finger_spacing_(idx) && x < finger_spacing_(idx) + finger_width_) {
-      return false;
+    finger_min_forward_(idx) = min_forward[0];
+    finger_min_forward_(n + idx) = min_forward[1];
+    return;
+  }
+
+  // The finger placements on each side of the hand are evenly spaced, so the
+  // placements that contain a point can be found from its lateral coordinate.
+  // The range is padded by one placement on each side to absorb rounding,
+  // and each candidate is checked with the exact comparison.
+  const double step =
+      (n > 1) ? (finger_spacing_(n - 1) - finger_spacing_(0)) / (n - 1) : 0.0;
+  const double step_inv = (step > 0.0) ? 1.0 / step : 0.0;
+  const double width_steps = finger_width_ * step_inv;
+
+  for (int i = 0; i < points.cols(); i++) {
+    const double y = points(forward_axis_, i);
+    if (!(y < max_forward)) {
+      continue;
     }
+    const double x = points(lateral_axis_, i);
+
+    for (int side = 0; side < 2; side++) {
+      const int offset = side * n;
+      int first = 0;
+      int last = n - 1;
+      if (step > 0.0) {
+        const double u = (x - finger_spacing_(offset)) * step_inv;
+        if (u <= 0.0 || u - width_steps >= n) {
+          continue;
+        }
+        first = std::max(first, (int)(u - width_steps) - 1);
+        last = std::min(last, (int)u + 1);
+      }
+
+      for (int j = offset + first; j <= offset + last; j++) {
+        if (x > finger_spacing_(j) && x < finger_spacing_(j) + finger_width_) {
+          finger_min_forward_(j) = std::min(finger_min_forward_(j), y);
+        }
+      }
+    }
+  }
+}
+
+void FingerHand::evaluateOccupancy(double bite, int idx) {
+  // Calculate top and bottom of the hand (top = fingertip, bottom = base).
+  top_ = bite;
+  bottom_ = bite - hand_depth_;
+
+  center_ = 0.0;
+
+  fingers_.setConstant(false);
+
+  // Check that the hand would be able to extend by <bite> onto the object
+  // without causing the back of the hand to collide with the points.
+  if (min_forward_ < bottom_) {
+    return;
   }
 
-  return true;
+  // Check that there is at least one point in between the fingers.
+  if (!(min_forward_ < bite)) {
+    return;
+  }
+
+  // Identify free gaps (finger placements that do not collide with the points
+  // cropped at <bite>).
+  if (idx == -1) {
+    for (int i = 0; i < fingers_.size(); i++) {
+      fingers_(i) = !(finger_min_forward_(i) < bite);
+    }
+  } else {
+    fingers_(idx) = !(finger_min_forward_(idx) < bite);
+    fingers_(fingers_.size() / 2 + idx) =
+        !(finger_min_forward_(fingers_.size() / 2 + idx) < bite);
+  }
 }
 
 }  // namespace candidate
@@ -5,7 +5,7 @@ namespace candidate {
 
 std::vector<LocalFrame> FrameEstimator::calculateLocalFrames(
     const util::Cloud &cloud_cam, const std::vector<int> &indices,
-    double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const {
+    double radius, const util::KdTreeRGB &kdtree) const {
   double t1 = omp_get_wtime();
   std::vector<std::unique_ptr<LocalFrame>> frames;
   frames.resize(indices.size());
@@ -36,7 +36,7 @@ std::vector<LocalFrame> FrameEstimator::calculateLocalFrames(
 
 std::vector<LocalFrame> FrameEstimator::calculateLocalFrames(
     const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples,
-    double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const {
+    double radius, const util::KdTreeRGB &kdtree) const {
   double t1 = omp_get_wtime();
   std::vector<std::unique_ptr<LocalFrame>> frames;
   frames.resize(samples.cols());
@@ -63,9 +63,40 @@ std::vector<LocalFrame> FrameEstimator::calculateLocalFrames(
   return frames_out;
 }
 
+std::vector<LocalFrame> FrameEstimator::calculateLocalFrames(
+    const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples,
+    const std::vector<std::shared_ptr<const util::Neighborhood>> &neighborhoods,
+    double radius) const {
+  double t1 = omp_get_wtime();
+  const Eigen::Matrix3Xd &normals = cloud_cam.getNormals();
+  std::vector<LocalFrame> frames_out(samples.cols(),
+                                     LocalFrame(Eigen::Vector3d::Zero()));
+
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_threads_)
+#endif
+  for (int i = 0; i < samples.cols(); i++) {
+    // The points within <radius> are a prefix of the neighborhood.
+    const std::vector<int> &nn_indices = neighborhoods[i]->getIndices();
+    Eigen::Matrix3Xd nn_normals(3, neighborhoods[i]->countWithin(radius));
+
+    for (int j = 0; j < nn_normals.cols(); j++) {
+      nn_normals.col(j) = normals.col(nn_indices[j]);
+    }
+
+    frames_out[i].setSample(samples.col(i));
+    frames_out[i].findAverageNormalAxis(nn_normals);
+  }
+
+  double t2 = omp_get_wtime();
+  printf("Estimated %zu frames in %3.4fs.\n", frames_out.size(), t2 - t1);
+
+  return frames_out;
+}
+
 std::unique_ptr<LocalFrame> FrameEstimator::calculateFrame(
     const Eigen::Matrix3Xd &normals, const Eigen::Vector3d &sample,
-    double radius, const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const {
+    double radius, const util::KdTreeRGB &kdtree) const {
   std::unique_ptr<LocalFrame> frame = nullptr;
   std::vector<int> nn_indices;
   std::vector<float> nn_dists;
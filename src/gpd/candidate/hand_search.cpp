@@ -23,39 +23,73 @@ HandSearch::HandSearch(Parameters params)
 
 std::vector<std::unique_ptr<HandSet>> HandSearch::searchHands(
     const util::Cloud &cloud_cam) const {
-  double t0_total = omp_get_wtime();
+  Eigen::Matrix3Xd samples = collectSamples(cloud_cam);
+  if (samples.cols() == 0) {
+    std::cout << "Error: No samples or no indices!\n";
+    std::vector<std::unique_ptr<HandSet>> hand_set_list(0);
+    return hand_set_list;
+  }
 
-  // Create KdTree for neighborhood search.
-  const PointCloudRGB::Ptr &cloud = cloud_cam.getCloudProcessed();
-  pcl::KdTreeFLANN<pcl::PointXYZRGBA> kdtree;
-  kdtree.setInputCloud(cloud);
+  return searchHands(cloud_cam, samples);
+}
 
-  // 1. Estimate local reference frames.
-  std::cout << "Estimating local reference frames ...\n";
-  std::vector<LocalFrame> frames;
-  FrameEstimator frame_estimator(params_.num_threads_);
+Eigen::Matrix3Xd HandSearch::collectSamples(
+    const util::Cloud &cloud_cam) const {
+  Eigen::Matrix3Xd samples;
   if (cloud_cam.getSamples().cols() > 0) {  // use samples
-    frames = frame_estimator.calculateLocalFrames(
-        cloud_cam, cloud_cam.getSamples(), params_.nn_radius_frames_, kdtree);
+    samples = cloud_cam.getSamples();
   } else if (cloud_cam.getSampleIndices().size() > 0) {  // use indices
-    frames = frame_estimator.calculateLocalFrames(
-        cloud_cam, cloud_cam.getSampleIndices(), params_.nn_radius_frames_,
-        kdtree);
-  } else {
-    std::cout << "Error: No samples or no indices!\n";
-    std::vector<std::unique_ptr<HandSet>> hand_set_list(0);
-    // hand_set_list.resize(0);
-    return hand_set_list;
+    const std::vector<int> &indices = cloud_cam.getSampleIndices();
+    samples.resize(3, indices.size());
+    for (int i = 0; i < indices.size(); i++) {
+      samples.col(i) = cloud_cam.getCloudProcessed()
+                           ->points[indices[i]]
+                           .getVector3fMap()
+                           .cast<double>();
+    }
   }
 
+  return samples;
+}
+
+std::vector<std::unique_ptr<HandSet>> HandSearch::searchHands(
+    const util::Cloud &cloud_cam, const Eigen::Matrix3Xd &samples) const {
+  double t0_total = omp_get_wtime();
+
+  // Use the cloud's kd-tree for neighborhood search.
+  const util::KdTreeRGB &kdtree = *cloud_cam.getSearchTree();
+
+  // 1. Find the point neighborhoods with one search at the largest radius.
+  // Only keep samples that have at least one neighbor for the LRF estimation.
+  double nn_radius_max = std::max(
+      std::max(params_.nn_radius_frames_, nn_radius_), params_.nn_radius_images_);
+  std::vector<std::shared_ptr<const util::Neighborhood>> neighborhoods_all =
+      findNeighborhoods(samples, nn_radius_max, kdtree);
+  std::vector<std::shared_ptr<const util::Neighborhood>> neighborhoods;
+  std::vector<int> indices_kept;
+  for (int i = 0; i < neighborhoods_all.size(); i++) {
+    if (neighborhoods_all[i]->countWithin(params_.nn_radius_frames_) > 0) {
+      neighborhoods.push_back(neighborhoods_all[i]);
+      indices_kept.push_back(i);
+    }
+  }
+  Eigen::Matrix3Xd samples_kept =
+      util::EigenUtils::sliceMatrix(samples, indices_kept);
+
+  // 2. Estimate local reference frames.
+  std::cout << "Estimating local reference frames ...\n";
+  FrameEstimator frame_estimator(params_.num_threads_);
+  std::vector<LocalFrame> frames = frame_estimator.calculateLocalFrames(
+      cloud_cam, samples_kept, neighborhoods, params_.nn_radius_frames_);
+
   if (plots_local_axes_) {
     plot_->plotLocalAxes(frames, cloud_cam.getCloudOriginal());
   }
 
-  // 2. Evaluate possible hand placements.
+  // 3. Evaluate possible hand placements.
   std::cout << "Finding hand poses ...\n";
   std::vector<std::unique_ptr<HandSet>> hand_set_list =
-      evalHands(cloud_cam, frames, kdtree);
+      evalHands(cloud_cam, frames, neighborhoods);
 
   const double t2 = omp_get_wtime();
   std::cout << "====> HAND SEARCH TIME: " << t2 - t0_total << std::endl;
@@ -63,16 +97,49 @@ std::vector<std::unique_ptr<HandSet>> HandSearch::searchHands(
   return hand_set_list;
 }
 
+std::vector<std::shared_ptr<const util::Neighborhood>>
+HandSearch::findNeighborhoods(const Eigen::Matrix3Xd &samples, double radius,
+                              const util::KdTreeRGB &kdtree) const {
+  double t1 = omp_get_wtime();
+  std::vector<std::shared_ptr<const util::Neighborhood>> neighborhoods(
+      samples.cols());
+
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(params_.num_threads_)
+#endif
+  for (int i = 0; i < samples.cols(); i++) {
+    // The kd-tree returns the neighbors sorted by their distance.
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    kdtree.radiusSearch(eigenVectorToPcl(samples.col(i)), radius, nn_indices,
+                        nn_dists);
+    neighborhoods[i] = std::make_shared<const util::Neighborhood>(
+        radius, std::move(nn_indices), std::move(nn_dists));
+  }
+
+  printf("Found %zu neighborhoods (radius: %.3f) in %3.4fs.\n",
+         neighborhoods.size(), radius, omp_get_wtime() - t1);
+
+  return neighborhoods;
+}
+
 std::vector<int> HandSearch::reevaluateHypotheses(
     const util::Cloud &cloud_cam,
     std::vector<std::unique_ptr<candidate::Hand>> &grasps,
     bool plot_samples) const {
-  // Create KdTree for neighborhood search.
+  Eigen::Array<bool, 1, Eigen::Dynamic> is_valid;
+  return reevaluateHypotheses(cloud_cam, grasps, is_valid, plot_samples);
+}
+
+std::vector<int> HandSearch::reevaluateHypotheses(
+    const util::Cloud &cloud_cam,
+    std::vector<std::unique_ptr<candidate::Hand>> &grasps,
+    Eigen::Array<bool, 1, Eigen::Dynamic> &is_valid, bool plot_samples) const {
+  // Use the cloud's kd-tree for neighborhood search.
   const Eigen::MatrixXi &camera_source = cloud_cam.getCameraSource();
   const Eigen::Matrix3Xd &cloud_normals = cloud_cam.getNormals();
   const PointCloudRGB::Ptr &cloud = cloud_cam.getCloudProcessed();
-  pcl::KdTreeFLANN<pcl::PointXYZRGBA> kdtree;
-  kdtree.setInputCloud(cloud);
+  const util::KdTreeRGB &kdtree = *cloud_cam.getSearchTree();
 
   if (plot_samples) {
     Eigen::Matrix3Xd samples(3, grasps.size());
@@ -91,6 +158,8 @@ std::vector<int> HandSearch::reevaluateHypotheses(
                              cloud_cam.getViewPoints());
   util::PointList nn_points;
   std::vector<int> labels(grasps.size());
+  is_valid = Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(
+      1, grasps.size(), false);
 
 #ifdef _OPENMP
 #pragma omp parallel for private(nn_indices, nn_dists, nn_points) \
@@ -119,6 +188,7 @@ std::vector<int> HandSearch::reevaluateHypotheses(
       // Check for collisions and if the hand contains at least one point.
       if (reevaluateHypothesis(nn_points, *grasps[i], finger_hand,
                                nn_points_frame)) {
+        is_valid(i) = true;
         int label = labelHypothesis(nn_points_frame, finger_hand);
         if (label == Antipodal::FULL_GRASP) {
           labels[i] = 1;
@@ -144,7 +214,8 @@ pcl::PointXYZRGBA HandSearch::eigenVectorToPcl(const Eigen::Vector3d &v) const {
 std::vector<std::unique_ptr<candidate::HandSet>> HandSearch::evalHands(
     const util::Cloud &cloud_cam,
     const std::vector<candidate::LocalFrame> &frames,
-    const pcl::KdTreeFLANN<pcl::PointXYZRGBA> &kdtree) const {
+    const std::vector<std::shared_ptr<const util::Neighborhood>>
+        &neighborhoods) const {
   double t1 = omp_get_wtime();
 
   // possible angles used for hand orientations
@@ -154,8 +225,6 @@ std::vector<std::unique_ptr<candidate::HandSet>> HandSearch::evalHands(
   // necessary b/c assignment in Eigen does not change vector size
   const Eigen::VectorXd angles = angles_space.head(params_.num_orientations_);
 
-  std::vector<int> nn_indices;
-  std::vector<float> nn_dists;
   const PointCloudRGB::Ptr &cloud = cloud_cam.getCloudProcessed();
   const Eigen::Matrix3Xd points =
       cloud->getMatrixXfMap().block(0, 0, 3, cloud->size()).cast<double>();
@@ -166,19 +235,24 @@ std::vector<std::unique_ptr<candidate::HandSet>> HandSearch::evalHands(
   util::PointList nn_points;
 
 #ifdef _OPENMP  // parallelization using OpenMP
-#pragma omp parallel for private(nn_indices, nn_dists, nn_points) \
-    num_threads(params_.num_threads_)
+#pragma omp parallel for private(nn_points) num_threads(params_.num_threads_)
 #endif
   for (std::size_t i = 0; i < frames.size(); i++) {
-    pcl::PointXYZRGBA sample = eigenVectorToPcl(frames[i].getSample());
     hand_set_list[i] = std::make_unique<HandSet>(
         params_.hand_geometry_, angles, params_.hand_axes_,
         params_.num_finger_placements_, params_.deepen_hand_, *antipodal_);
 
-    if (kdtree.radiusSearch(sample, nn_radius_, nn_indices, nn_dists) > 0) {
-      nn_points = point_list.slice(nn_indices);
+    // The points within <nn_radius_> are a prefix of the neighborhood.
+    const int num_nn = neighborhoods[i]->countWithin(nn_radius_);
+    if (num_nn > 0) {
+      nn_points = point_list.slice(neighborhoods[i]->getIndices(), num_nn);
       hand_set_list[i]->evalHandSet(nn_points, frames[i]);
     }
+
+    // Keep the neighborhood for the image generation.
+    if (params_.nn_radius_images_ > 0.0) {
+      hand_set_list[i]->setNeighborhood(neighborhoods[i]);
+    }
   }
 
   printf("Found %d hand sets in %3.2fs\n", (int)hand_set_list.size(),
@@ -1,5 +1,7 @@
 #include <gpd/candidate/hand_set.h>
 
+#include <algorithm>
+#include <limits>
 #include <random>
 
 namespace gpd {
@@ -11,7 +13,9 @@ const Eigen::Vector3d HandSet::AXES[3] = {Eigen::Vector3d::UnitX(),
 
 const bool HandSet::MEASURE_TIME = false;
 
-int HandSet::seed_ = 0;
+const unsigned int HandSet::SHADOW_SEED = 0;
+
+const double HandSet::SHADOW_VOXEL_SIZE = 0.003;
 
 HandSet::HandSet(const HandGeometry &hand_geometry,
                  const Eigen::VectorXd &angles,
@@ -30,103 +34,148 @@ HandSet::HandSet(const HandGeometry &hand_geometry,
 
 void HandSet::evalHandSet(const util::PointList &point_list,
                           const LocalFrame &local_frame) {
-  hands_.resize(hand_axes_.size() * angles_.size());
-  is_valid_ = Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(
-      1, angles_.size() * hand_axes_.size(), false);
+  const int num_angles = angles_.size();
+  const int k = hand_axes_.size() * num_angles;
+  const int n = point_list.size();
+  hands_.resize(k);
+  is_valid_ = Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(1, k, false);
 
   // Local reference frame
   sample_ = local_frame.getSample();
   frame_ << local_frame.getNormal(), local_frame.getBinormal(),
       local_frame.getCurvatureAxis();
 
-  // Iterate over rotation axes.
-  for (int i = 0; i < hand_axes_.size(); i++) {
-    int start = i * angles_.size();
-    evalHands(point_list, local_frame, hand_axes_[i], start);
-  }
-}
-
-void HandSet::evalHands(const util::PointList &point_list,
-                        const LocalFrame &local_frame, int axis, int start) {
   // Rotate about binormal by 180 degrees to reverses direction of normal.
   const Eigen::Matrix3d ROT_BINORMAL =
       Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitY()).toRotationMatrix();
 
+  // 1. Stack the rotations into the hand frames of all orientations (3k x 3).
+  // Orientation <i> about the <j>-th hand axis is at index j*num_angles + i.
+  Eigen::MatrixXd rotations(3 * k, 3);
+  for (int j = 0; j < hand_axes_.size(); j++) {
+    for (int i = 0; i < num_angles; i++) {
+      // Rotation about <axis> by <angles_(i)> radians.
+      Eigen::Matrix3d rot =
+          Eigen::AngleAxisd(angles_(i), AXES[hand_axes_[j]]).toRotationMatrix();
+      rotations.middleRows<3>(3 * (j * num_angles + i)) =
+          (frame_ * ROT_BINORMAL * rot).transpose();
+    }
+  }
+
+  // 2. Transform the centered points and the normals into all hand frames
+  // with a single matrix product. The buffers are reused across hand sets
+  // evaluated by the same thread.
+  static thread_local Eigen::Matrix3Xd points_normals;
+  static thread_local Eigen::MatrixXd points_normals_frames;
+  if (points_normals.cols() < 2 * n) {
+    points_normals.resize(3, 2 * n);
+  }
+  if (points_normals_frames.rows() != 3 * k ||
+      points_normals_frames.cols() < 2 * n) {
+    points_normals_frames.resize(3 * k,
+                                 std::max(2 * n, (int)points_normals.cols()));
+  }
+  points_normals.leftCols(n) =
+      point_list.getPoints().colwise() - local_frame.getSample();
+  points_normals.middleCols(n, n) = point_list.getNormals();
+  points_normals_frames.leftCols(2 * n).noalias() =
+      rotations * points_normals.leftCols(2 * n);
+
   // This object is used to evaluate the finger placement.
   FingerHand finger_hand(hand_geometry_.params_.finger_width_,
-                         hand_geometry_.params_.outer_diameter_, hand_geometry_.params_.depth_,
-                         num_finger_placements_);
+                         hand_geometry_.params_.outer_diameter_,
+                         hand_geometry_.params_.depth_, num_finger_placements_);
 
   // Set the forward and lateral axis of the robot hand frame (closing direction
   // and grasp approach direction).
   finger_hand.setForwardAxis(0);
   finger_hand.setLateralAxis(1);
 
-  // Evaluate grasp at each hand orientation.
-  for (int i = 0; i < angles_.rows(); i++) {
-    // Rotation about <axis> by <angles_(i)> radians.
-    Eigen::Matrix3d rot =
-        Eigen::AngleAxisd(angles_(i), AXES[axis]).toRotationMatrix();
-
-    // Rotate points into this hand orientation.
-    Eigen::Matrix3d frame_rot;
-    frame_rot.noalias() = frame_ * ROT_BINORMAL * rot;
-    util::PointList point_list_frame = point_list.transformToHandFrame(
-        local_frame.getSample(), frame_rot.transpose());
-
-    // Crop points on hand height.
-    util::PointList point_list_cropped =
-        point_list_frame.cropByHandHeight(hand_geometry_.params_.height_);
-
-    // Evaluate finger placements for this orientation.
-    finger_hand.evaluateFingers(point_list_cropped.getPoints(),
-                                hand_geometry_.params_.init_bite_);
-
-    // Check that there is at least one feasible 2-finger placement.
-    finger_hand.evaluateHand();
-
-    // Create the grasp candidate.
-    hands_[start + i] = std::make_unique<Hand>(local_frame.getSample(),
-                                               frame_rot, finger_hand, 0.0);
-
-    // Check that there is at least one feasible 2-finger placement.
-    if (finger_hand.getHand().any()) {
-      int finger_idx;
-      if (deepen_hand_) {
-        // Try to move the hand as deep as possible onto the object.
-        finger_idx = finger_hand.deepenHand(point_list_cropped.getPoints(),
-                                            hand_geometry_.params_.init_bite_,
-                                            hand_geometry_.params_.max_depth_,
-                                            hand_geometry_.params_.deepen_step_);
-      } else {
-        finger_idx = finger_hand.chooseMiddleHand();
-      }
-      // Calculate points in the closing region of the hand.
-      std::vector<int> indices_closing =
-          finger_hand.computePointsInClosingRegion(
-              point_list_cropped.getPoints(), finger_idx);
-      if (indices_closing.size() == 0) {
-        continue;
-      }
+  // 3. Evaluate grasp at each hand orientation.
+  for (int i = 0; i < k; i++) {
+    const auto frame_block = points_normals_frames.middleRows<3>(3 * i);
+    evalHand(point_list, frame_block.leftCols(n), frame_block.middleCols(n, n),
+             rotations.middleRows<3>(3 * i).transpose(), finger_hand, i);
+  }
+}
 
-      is_valid_[start + i] = true;
-      modifyCandidate(*hands_[start + i], point_list_cropped, indices_closing,
-                      finger_hand);
+void HandSet::evalHand(const util::PointList &point_list,
+                       const Eigen::Ref<const Eigen::Matrix3Xd> &points_frame,
+                       const Eigen::Ref<const Eigen::Matrix3Xd> &normals_frame,
+                       const Eigen::Matrix3d &frame_rot,
+                       FingerHand &finger_hand, int idx) {
+  // Crop points on hand height. The cropped points are gathered into a buffer
+  // that is reused across orientations.
+  static thread_local Eigen::Matrix3Xd points_cropped;
+  static thread_local std::vector<int> indices_cropped;
+  if (points_cropped.cols() < points_frame.cols()) {
+    points_cropped.resize(3, points_frame.cols());
+  }
+  indices_cropped.clear();
+  const double height = hand_geometry_.params_.height_;
+  for (int i = 0; i < points_frame.cols(); i++) {
+    if (points_frame(2, i) > -1.0 * height && points_frame(2, i) < height) {
+      points_cropped.col(indices_cropped.size()) = points_frame.col(i);
+      indices_cropped.push_back(i);
     }
   }
+  const auto points = points_cropped.leftCols(indices_cropped.size());
+
+  // Evaluate finger placements for this orientation.
+  finger_hand.evaluateFingers(points, hand_geometry_.params_.init_bite_);
+
+  // Check that there is at least one feasible 2-finger placement.
+  finger_hand.evaluateHand();
+
+  // Create the grasp candidate.
+  hands_[idx] = std::make_unique<Hand>(sample_, frame_rot, finger_hand, 0.0);
+
+  // Check that there is at least one feasible 2-finger placement.
+  if (finger_hand.getHand().any()) {
+    int finger_idx;
+    if (deepen_hand_) {
+      // Try to move the hand as deep as possible onto the object.
+      finger_idx = finger_hand.deepenHand(points,
+                                          hand_geometry_.params_.init_bite_,
+                                          hand_geometry_.params_.max_depth_,
+                                          hand_geometry_.params_.deepen_step_);
+    } else {
+      finger_idx = finger_hand.chooseMiddleHand();
+    }
+    // Calculate points in the closing region of the hand.
+    std::vector<int> indices_closing =
+        finger_hand.computePointsInClosingRegion(points, finger_idx);
+    if (indices_closing.size() == 0) {
+      return;
+    }
+
+    // Extract points in hand closing region.
+    const int m = indices_closing.size();
+    Eigen::Matrix3Xd points_closing(3, m);
+    Eigen::Matrix3Xd normals_closing(3, m);
+    Eigen::MatrixXi cam_source_closing(point_list.getCamSource().rows(), m);
+    for (int i = 0; i < m; i++) {
+      const int j = indices_cropped[indices_closing[i]];
+      points_closing.col(i) = points_frame.col(j);
+      normals_closing.col(i) = normals_frame.col(j);
+      cam_source_closing.col(i) = point_list.getCamSource().col(j);
+    }
+    util::PointList point_list_closing(points_closing, normals_closing,
+                                       cam_source_closing,
+                                       point_list.getViewPoints());
+
+    is_valid_[idx] = true;
+    modifyCandidate(*hands_[idx], point_list_closing, finger_hand);
+  }
 }
 
 Eigen::Matrix3Xd HandSet::calculateShadow(const util::PointList &point_list,
                                           double shadow_length) const {
   // Set voxel size for points that fill occluded region.
-  const double voxel_grid_size = 0.003;
-  // Calculate number of points along each shadow vector.
-  double num_shadow_points = floor(shadow_length / voxel_grid_size);
+  const double voxel_grid_size = SHADOW_VOXEL_SIZE;
 
   const int num_cams = point_list.getCamSource().rows();
 
-  Eigen::Matrix3Xd shadow;
-
   // Calculate the set of cameras which see the points.
   Eigen::VectorXi camera_set = point_list.getCamSource().rowwise().sum();
 
@@ -134,63 +183,105 @@ Eigen::Matrix3Xd HandSet::calculateShadow(const util::PointList &point_list,
   Eigen::Vector3d center = point_list.getPoints().rowwise().sum();
   center /= (double)point_list.size();
 
-  // Stores the list of all bins of the voxelized, occluded points.
-  std::vector<Vector3iSet> shadows;
-  shadows.resize(num_cams, Vector3iSet(num_shadow_points * 10000));
+  // Calculate the shadow vector of each camera and the region that is
+  // occluded from all cameras, i.e., the intersection of the bounding boxes of
+  // the shadows.
+  const Eigen::Vector3d points_min = point_list.getPoints().rowwise().minCoeff();
+  const Eigen::Vector3d points_max = point_list.getPoints().rowwise().maxCoeff();
+  Eigen::Vector3d lower = Eigen::Vector3d::Constant(
+      -std::numeric_limits<double>::infinity());
+  Eigen::Vector3d upper = Eigen::Vector3d::Constant(
+      std::numeric_limits<double>::infinity());
+  std::vector<int> cams;
+  Eigen::Matrix3Xd shadow_vecs(3, num_cams);
 
   for (int i = 0; i < num_cams; i++) {
     if (camera_set(i) >= 1) {
-      double t0_if = omp_get_wtime();
-
       // Calculate the unit vector that points from the camera position to the
       // center of the point neighborhood.
       Eigen::Vector3d shadow_vec = center - point_list.getViewPoints().col(i);
 
       // Scale that vector by the shadow length.
       shadow_vec = shadow_length * shadow_vec / shadow_vec.norm();
+      shadow_vecs.col(i) = shadow_vec;
 
-      // Calculate occluded points for this camera.
-      calculateShadowForCamera(point_list.getPoints(), shadow_vec,
-                               num_shadow_points, voxel_grid_size, shadows[i]);
+      lower = lower.cwiseMax(points_min + shadow_vec.cwiseMin(0.0));
+      upper = upper.cwiseMin(points_max + shadow_vec.cwiseMax(0.0));
+      cams.push_back(i);
     }
   }
 
-  // Only one camera view point.
-  if (num_cams == 1) {
-    // Convert voxels back to points.
-    shadow = shadowVoxelsToPoints(
-        std::vector<Eigen::Vector3i>(shadows[0].begin(), shadows[0].end()),
-        voxel_grid_size);
-    return shadow;
+  if (cams.size() == 0 || (lower.array() > upper.array()).any()) {
+    return Eigen::Matrix3Xd(3, 0);
   }
 
-  // Multiple camera view points: find the intersection of all sets of occluded
-  // points.
-  double t0_intersection = omp_get_wtime();
-  Vector3iSet bins_all = shadows[0];
+  // Calculate occluded voxels for each camera, and intersect them.
+  double t0_shadow = omp_get_wtime();
+  util::OcclusionGrid shadow(lower, upper, voxel_grid_size);
+  shadow.castRays(point_list.getPoints(), shadow_vecs.col(cams[0]));
+
+  if (cams.size() > 1) {
+    util::OcclusionGrid shadow_cam(lower, upper, voxel_grid_size);
+    for (int i = 1; i < cams.size(); i++) {
+      shadow_cam.clear();
+      shadow_cam.castRays(point_list.getPoints(), shadow_vecs.col(cams[i]));
+      shadow.intersect(shadow_cam);
+    }
+  }
 
-  for (int i = 1; i < num_cams; i++) {
-    // Check that there are points seen by this camera.
+  if (MEASURE_TIME) {
+    printf(
+        "Shadow calculation. Runtime: %.3f, #points: %d, #cameras: %d, "
+        "#shadow: %d\n",
+        omp_get_wtime() - t0_shadow, point_list.size(), (int)cams.size(),
+        shadow.countMarked());
+  }
+
+  // Convert voxels back to points.
+  return shadowVoxelsToPoints(shadow.getMarkedVoxels(), voxel_grid_size);
+}
+
+Eigen::Matrix3Xd HandSet::calculateShadow(
+    const std::vector<util::OcclusionVolume> &shadows,
+    const util::PointList &point_list, double radius) const {
+  // Calculate the set of cameras which see the points.
+  Eigen::VectorXi camera_set = point_list.getCamSource().rowwise().sum();
+
+  // Crop the occluded voxels around the sample for each camera that sees the
+  // points, and intersect them.
+  const Eigen::Vector3d lower = sample_.array() - radius;
+  const Eigen::Vector3d upper = sample_.array() + radius;
+  util::OcclusionGrid shadow(lower, upper, SHADOW_VOXEL_SIZE);
+  util::OcclusionGrid shadow_cam(lower, upper, SHADOW_VOXEL_SIZE);
+  bool is_empty = true;
+
+  for (int i = 0; i < shadows.size() && i < camera_set.size(); i++) {
     if (camera_set(i) >= 1) {
-      bins_all = intersection(bins_all, shadows[i]);
+      if (is_empty) {
+        shadows[i].crop(shadow);
+        is_empty = false;
+      } else {
+        shadow_cam.clear();
+        shadows[i].crop(shadow_cam);
+        shadow.intersect(shadow_cam);
+      }
     }
   }
-  if (MEASURE_TIME) {
-    printf("intersection runtime: %.3fs\n", omp_get_wtime() - t0_intersection);
+
+  if (is_empty) {
+    return Eigen::Matrix3Xd(3, 0);
   }
 
   // Convert voxels back to points.
-  std::vector<Eigen::Vector3i> voxels(bins_all.begin(), bins_all.end());
-  shadow = shadowVoxelsToPoints(voxels, voxel_grid_size);
-  return shadow;
+  return shadowVoxelsToPoints(shadow.getMarkedVoxels(), SHADOW_VOXEL_SIZE);
 }
 
 Eigen::Matrix3Xd HandSet::shadowVoxelsToPoints(
     const std::vector<Eigen::Vector3i> &voxels, double voxel_grid_size) const {
-  // Convert voxels back to points.
+  // Convert voxels back to points. The generator is seeded locally, so the
+  // jitter only depends on the voxels.
   double t0_voxels = omp_get_wtime();
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
+  std::mt19937 gen{SHADOW_SEED};
   std::normal_distribution<double> distr{0.0, 1.0};
   Eigen::Matrix3Xd shadow(3, voxels.size());
 
@@ -206,42 +297,12 @@ Eigen::Matrix3Xd HandSet::shadowVoxelsToPoints(
   return shadow;
 }
 
-void HandSet::calculateShadowForCamera(const Eigen::Matrix3Xd &points,
-                                       const Eigen::Vector3d &shadow_vec,
-                                       int num_shadow_points,
-                                       double voxel_grid_size,
-                                       Vector3iSet &shadow_set) const {
-  double t0_set = omp_get_wtime();
-  const int n = points.cols() * num_shadow_points;
-  const double voxel_grid_size_mult = 1.0 / voxel_grid_size;
-  const double max = 1.0 / 32767.0;
-
-  for (int i = 0; i < n; i++) {
-    const int pt_idx = i / num_shadow_points;
-    shadow_set.insert(
-        ((points.col(pt_idx) + ((double)fastrand() * max) * shadow_vec) *
-         voxel_grid_size_mult)
-            .cast<int>());
-  }
-
-  if (MEASURE_TIME) {
-    printf(
-        "Shadow (1 camera) calculation. Runtime: %.3f, #points: %d, "
-        "num_shadow_points: %d, #shadow: %d, max #shadow: %d\n",
-        omp_get_wtime() - t0_set, (int)points.cols(), num_shadow_points,
-        (int)shadow_set.size(), n);
-  }
-}
-
-void HandSet::modifyCandidate(Hand &hand, const util::PointList &point_list,
-                              const std::vector<int> &indices,
+void HandSet::modifyCandidate(Hand &hand,
+                              const util::PointList &point_list_closing,
                               const FingerHand &finger_hand) const {
   // Modify the grasp.
   hand.construct(finger_hand);
 
-  // Extract points in hand closing region.
-  util::PointList point_list_closing = point_list.slice(indices);
-
   // Calculate grasp width (hand opening width).
   double width = point_list_closing.getPoints().row(1).maxCoeff() -
                  point_list_closing.getPoints().row(1).minCoeff();
@@ -261,27 +322,5 @@ void HandSet::labelHypothesis(const util::PointList &point_list,
   hand.setFullAntipodal(label == Antipodal::FULL_GRASP);
 }
 
-inline int HandSet::fastrand() const {
-  seed_ = (214013 * seed_ + 2531011);
-  return (seed_ >> 16) & 0x7FFF;
-}
-
-Vector3iSet HandSet::intersection(const Vector3iSet &set1,
-                                  const Vector3iSet &set2) const {
-  if (set2.size() < set1.size()) {
-    return intersection(set2, set1);
-  }
-
-  Vector3iSet set_out(set1.size());
-
-  for (Vector3iSet::const_iterator it = set1.begin(); it != set1.end(); it++) {
-    if (set2.find(*it) != set2.end()) {
-      set_out.insert(*it);
-    }
-  }
-
-  return set_out;
-}
-
 }  // namespace candidate
 }  // namespace gpd
@@ -3,23 +3,21 @@
 namespace gpd {
 namespace descriptor {
 
-std::vector<std::unique_ptr<cv::Mat>> Image12ChannelsStrategy::createImages(
-    const candidate::HandSet &hand_set,
-    const util::PointList &nn_points) const {
+void Image12ChannelsStrategy::createImages(
+    const candidate::HandSet &hand_set, const util::PointList &nn_points,
+    const std::vector<util::OcclusionVolume> &shadows, net::ImageTensor &images,
+    int offset) const {
   const std::vector<std::unique_ptr<candidate::Hand>> &hands =
       hand_set.getHands();
-  std::vector<std::unique_ptr<cv::Mat>> images(hands.size());
 
   for (int i = 0; i < hands.size(); i++) {
     if (hand_set.getIsValid()(i)) {
-      images[i] = std::make_unique<cv::Mat>(
-          image_params_.size_, image_params_.size_,
-          CV_8UC(image_params_.num_channels_), cv::Scalar(0.0));
-      createImage(nn_points, *hands[i], *images[i]);
+      cv::Mat image = getImageBuffer(images, offset);
+      createImage(nn_points, *hands[i], image);
+      images.setImage(offset, image);
+      offset++;
     }
   }
-
-  return images;
 }
 
 void Image12ChannelsStrategy::createImage(const util::PointList &point_list,
@@ -29,60 +27,12 @@ void Image12ChannelsStrategy::createImage(const util::PointList &point_list,
   Matrix3XdPair points_normals = transformToUnitImage(point_list, hand);
 
   // 2. Create grasp image.
-  image = calculateImage(points_normals.first, points_normals.second);
-}
-
-cv::Mat Image12ChannelsStrategy::calculateImage(
-    const Eigen::Matrix3Xd &points, const Eigen::Matrix3Xd &normals) const {
-  double t = omp_get_wtime();
-  const int kNumProjections = 3;
-
-  std::vector<cv::Mat> channels(image_params_.num_channels_);
-
-  Eigen::Matrix3Xd points_proj = points;
-  int swap_indices[3][2] = {{-1, -1}, {0, 2}, {1, 2}};
-  // int swap_indices[3][2] = {{-1, -1}, {0, 2}, {0, 1}};
-
-  for (size_t i = 0; i < kNumProjections; i++) {
-    if (i > 0) {
-      points_proj.row(swap_indices[i][0])
-          .swap(points_proj.row(swap_indices[i][1]));
-    }
-
-    std::vector<cv::Mat> channels_i = calculateChannels(points_proj, normals);
-    for (size_t j = 0; j < channels_i.size(); j++) {
-      channels[i * 4 + j] = channels_i[j];
-    }
-  }
-
-  cv::Mat image;
-  cv::merge(channels, image);
-
-  t = omp_get_wtime() - t;
-  // printf("runtime: %3.10f\n", t);
+  createProjectionsImage(points_normals.first, points_normals.second,
+                         Eigen::Matrix3Xd(3, 0), image);
 
   if (is_plotting_) {
     showImage(image);
   }
-
-  return image;
-}
-
-std::vector<cv::Mat> Image12ChannelsStrategy::calculateChannels(
-    const Eigen::Matrix3Xd &points, const Eigen::Matrix3Xd &normals) const {
-  std::vector<cv::Mat> channels(4);
-
-  Eigen::VectorXi cell_indices = findCellIndices(points);
-  cv::Mat normals_image = createNormalsImage(normals, cell_indices);
-  std::vector<cv::Mat> normals_image_channels;
-  cv::split(normals_image, normals_image_channels);
-  for (size_t i = 0; i < normals_image.channels(); i++) {
-    channels[i] = normals_image_channels[i];
-  }
-
-  channels[3] = createDepthImage(points, cell_indices);
-
-  return channels;
 }
 
 void Image12ChannelsStrategy::showImage(const cv::Mat &image) const {
@@ -3,25 +3,27 @@
 namespace gpd {
 namespace descriptor {
 
-std::vector<std::unique_ptr<cv::Mat>> Image15ChannelsStrategy::createImages(
-    const candidate::HandSet &hand_set,
-    const util::PointList &nn_points) const {
+void Image15ChannelsStrategy::createImages(
+    const candidate::HandSet &hand_set, const util::PointList &nn_points,
+    const std::vector<util::OcclusionVolume> &shadows, net::ImageTensor &images,
+    int offset) const {
   const std::vector<std::unique_ptr<candidate::Hand>> &hands =
       hand_set.getHands();
-  std::vector<std::unique_ptr<cv::Mat>> images(hands.size());
 
-  Eigen::Matrix3Xd shadow = hand_set.calculateShadow(nn_points, shadow_length_);
+  // Crop the shadow from the occlusion volumes of the scene if available.
+  Eigen::Matrix3Xd shadow =
+      shadows.empty()
+          ? hand_set.calculateShadow(nn_points, shadow_length_)
+          : hand_set.calculateShadow(shadows, nn_points, shadow_length_);
 
   for (int i = 0; i < hands.size(); i++) {
     if (hand_set.getIsValid()(i)) {
-      images[i] = std::make_unique<cv::Mat>(
-          image_params_.size_, image_params_.size_,
-          CV_8UC(image_params_.num_channels_), cv::Scalar(0.0));
-      createImage(nn_points, *hands[i], shadow, *images[i]);
+      cv::Mat image = getImageBuffer(images, offset);
+      createImage(nn_points, *hands[i], shadow, image);
+      images.setImage(offset, image);
+      offset++;
     }
   }
-
-  return images;
 }
 
 void Image15ChannelsStrategy::createImage(const util::PointList &point_list,
@@ -40,68 +42,12 @@ void Image15ChannelsStrategy::createImage(const util::PointList &point_list,
       transformPointsToUnitImage(hand, shadow_frame, indices);
 
   // 3. Create grasp image.
-  image = calculateImage(points_normals.first, points_normals.second,
-                         cropped_shadow_points);
-}
-
-cv::Mat Image15ChannelsStrategy::calculateImage(
-    const Eigen::Matrix3Xd &points, const Eigen::Matrix3Xd &normals,
-    const Eigen::Matrix3Xd &shadow) const {
-  double t = omp_get_wtime();
-  const int kNumProjections = 3;
-
-  std::vector<cv::Mat> channels(image_params_.num_channels_);
-
-  Eigen::Matrix3Xd points_proj = points;
-  Eigen::Matrix3Xd shadow_proj = shadow;
-  int swap_indices[3][2] = {{-1, -1}, {0, 2}, {1, 2}};
-
-  for (size_t i = 0; i < kNumProjections; i++) {
-    if (i > 0) {
-      points_proj.row(swap_indices[i][0])
-          .swap(points_proj.row(swap_indices[i][1]));
-      shadow_proj.row(swap_indices[i][0])
-          .swap(shadow_proj.row(swap_indices[i][1]));
-    }
-    std::vector<cv::Mat> channels_i =
-        calculateChannels(points_proj, normals, shadow_proj);
-    for (size_t j = 0; j < channels_i.size(); j++) {
-      channels[i * 5 + j] = channels_i[j];
-    }
-  }
-
-  cv::Mat image;
-  cv::merge(channels, image);
-
-  t = omp_get_wtime() - t;
-  // printf("runtime: %3.10f\n", t);
+  createProjectionsImage(points_normals.first, points_normals.second,
+                         cropped_shadow_points, image);
 
   if (is_plotting_) {
     showImage(image);
   }
-
-  return image;
-}
-
-std::vector<cv::Mat> Image15ChannelsStrategy::calculateChannels(
-    const Eigen::Matrix3Xd &points, const Eigen::Matrix3Xd &normals,
-    const Eigen::Matrix3Xd &shadow) const {
-  std::vector<cv::Mat> channels(5);
-
-  Eigen::VectorXi cell_indices = findCellIndices(points);
-  cv::Mat normals_image = createNormalsImage(normals, cell_indices);
-  std::vector<cv::Mat> normals_image_channels;
-  cv::split(normals_image, normals_image_channels);
-  for (size_t i = 0; i < normals_image.channels(); i++) {
-    channels[i] = normals_image_channels[i];
-  }
-
-  channels[3] = createDepthImage(points, cell_indices);
-
-  cell_indices = findCellIndices(shadow);
-  channels[4] = createShadowImage(shadow, cell_indices);
-
-  return channels;
 }
 
 void Image15ChannelsStrategy::showImage(const cv::Mat &image) const {
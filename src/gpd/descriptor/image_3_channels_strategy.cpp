@@ -3,23 +3,21 @@
 namespace gpd {
 namespace descriptor {
 
-std::vector<std::unique_ptr<cv::Mat>> Image3ChannelsStrategy::createImages(
-    const candidate::HandSet &hand_set,
-    const util::PointList &nn_points) const {
+void Image3ChannelsStrategy::createImages(
+    const candidate::HandSet &hand_set, const util::PointList &nn_points,
+    const std::vector<util::OcclusionVolume> &shadows, net::ImageTensor &images,
+    int offset) const {
   const std::vector<std::unique_ptr<candidate::Hand>> &hands =
       hand_set.getHands();
-  std::vector<std::unique_ptr<cv::Mat>> images(hands.size());
 
   for (int i = 0; i < hands.size(); i++) {
     if (hand_set.getIsValid()(i)) {
-      images[i] = std::make_unique<cv::Mat>(
-          image_params_.size_, image_params_.size_,
-          CV_8UC(image_params_.num_channels_), cv::Scalar(0.0));
-      createImage(nn_points, *hands[i], *images[i]);
+      cv::Mat image = getImageBuffer(images, offset);
+      createImage(nn_points, *hands[i], image);
+      images.setImage(offset, image);
+      offset++;
     }
   }
-
-  return images;
 }
 
 void Image3ChannelsStrategy::createImage(const util::PointList &point_list,
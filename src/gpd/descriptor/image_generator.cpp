@@ -19,82 +19,203 @@ void ImageGenerator::createImages(
     const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
     std::vector<std::unique_ptr<cv::Mat>> &images_out,
     std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const {
-  double t0 = omp_get_wtime();
+  net::ImageTensor images(net::ImageTensor::Layout::eNHWC,
+                          net::ImageTensor::Precision::eU8);
+  createImages(cloud_cam, hand_set_list, images, hands_out);
+
+  for (int i = 0; i < images.size(); i++) {
+    images_out.push_back(std::make_unique<cv::Mat>(images.getImage(i)));
+  }
+}
+
+void ImageGenerator::createImages(
+    const util::Cloud &cloud_cam,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    net::ImageTensor &images_out,
+    std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const {
+  createImages(cloud_cam, createScene(cloud_cam), hand_set_list, images_out,
+               hands_out);
+}
+
+void ImageGenerator::createImages(
+    const util::Cloud &cloud_cam, const Scene &scene,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    net::ImageTensor &images_out,
+    std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const {
+  createImages(cloud_cam, scene, hand_set_list, images_out);
 
+  // Take the grasps that correspond to the images out of their hand sets.
+  hands_out.reserve(hands_out.size() + images_out.size());
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    for (int j = 0; j < hand_set_list[i]->getHands().size(); j++) {
+      if (hand_set_list[i]->getIsValid()(j)) {
+        hands_out.push_back(std::move(hand_set_list[i]->getHands()[j]));
+      }
+    }
+  }
+}
+
+void ImageGenerator::createImages(
+    const util::Cloud &cloud_cam,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    net::ImageTensor &images_out) const {
+  createImages(cloud_cam, createScene(cloud_cam), hand_set_list, images_out);
+}
+
+ImageGenerator::Scene ImageGenerator::createScene(
+    const util::Cloud &cloud_cam) const {
+  Scene scene;
   Eigen::Matrix3Xd points =
       cloud_cam.getCloudProcessed()->getMatrixXfMap().cast<double>().block(
           0, 0, 3, cloud_cam.getCloudProcessed()->points.size());
-  util::PointList point_list(points, cloud_cam.getNormals(),
-                             cloud_cam.getCameraSource(),
-                             cloud_cam.getViewPoints());
+  scene.point_list =
+      util::PointList(points, cloud_cam.getNormals(),
+                      cloud_cam.getCameraSource(), cloud_cam.getViewPoints());
 
   // Segment the support/table plane to speed up shadow computation.
   if (remove_plane_) {
-    removePlane(cloud_cam, point_list);
+    removePlane(cloud_cam, scene.point_list);
+  }
+
+  // Calculate the occluded voxels of the scene once for all hand sets.
+  if (image_strategy_->usesShadows()) {
+    scene.shadows = calculateShadows(scene.point_list);
   }
 
-  // Prepare kd-tree for neighborhood searches in the point cloud.
-  pcl::KdTreeFLANN<pcl::PointXYZRGBA> kdtree;
-  kdtree.setInputCloud(cloud_cam.getCloudProcessed());
+  return scene;
+}
+
+void ImageGenerator::createImages(
+    const util::Cloud &cloud_cam, const Scene &scene,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    net::ImageTensor &images_out) const {
+  double t0 = omp_get_wtime();
+  const util::PointList &point_list = scene.point_list;
+
+  // Use the cloud's kd-tree for neighborhood searches in the point cloud.
+  const util::KdTreeRGB &kdtree = *cloud_cam.getSearchTree();
   std::vector<int> nn_indices;
   std::vector<float> nn_dists;
 
   // Set the radius for the neighborhood search to the largest image dimension.
-  Eigen::Vector3d image_dims;
-  image_dims << image_params_.depth_, image_params_.height_ / 2.0,
-      image_params_.outer_diameter_;
-  double radius = image_dims.maxCoeff();
+  const double radius = image_params_.getSearchRadius();
 
-  // 1. Find points within image dimensions.
+  // 1. Find points within image dimensions. Reuse the neighborhood cached by
+  // the hand search if it is large enough, otherwise search the kd-tree.
   std::vector<util::PointList> nn_points_list;
   nn_points_list.resize(hand_set_list.size());
 
   double t_slice = omp_get_wtime();
+  int num_searched = 0;
+  int num_cached = 0;
 
 #ifdef _OPENMP  // parallelization using OpenMP
-#pragma omp parallel for private(nn_indices, nn_dists) num_threads(num_threads_)
+#pragma omp parallel for private(nn_indices, nn_dists) \
+    reduction(+ : num_searched, num_cached) num_threads(num_threads_)
 #endif
   for (int i = 0; i < hand_set_list.size(); i++) {
+    // Hand sets without valid grasps do not have images.
+    if (!hand_set_list[i]->getIsValid().any()) {
+      continue;
+    }
+
+    const std::shared_ptr<const util::Neighborhood> &neighborhood =
+        hand_set_list[i]->getNeighborhood();
+    if (neighborhood && neighborhood->getRadius() >= radius) {
+      const int num_nn = neighborhood->countWithin(radius);
+      if (num_nn > 0) {
+        nn_points_list[i] =
+            point_list.slice(neighborhood->getIndices(), num_nn);
+      }
+      num_cached++;
+      continue;
+    }
+
     pcl::PointXYZRGBA sample_pcl;
     sample_pcl.getVector3fMap() = hand_set_list[i]->getSample().cast<float>();
+    num_searched++;
 
     if (kdtree.radiusSearch(sample_pcl, radius, nn_indices, nn_dists) > 0) {
       nn_points_list[i] = point_list.slice(nn_indices);
     }
   }
-  printf("neighborhoods search time: %3.4f\n", omp_get_wtime() - t_slice);
+  printf("neighborhoods (searched: %d, cached: %d) time: %3.4f\n",
+         num_searched, num_cached, omp_get_wtime() - t_slice);
 
-  createImageList(hand_set_list, nn_points_list, images_out, hands_out);
-  printf("Created %zu images in %3.4fs\n", images_out.size(),
+  // 2. Create the images.
+  createImageList(hand_set_list, nn_points_list, scene.shadows, images_out);
+  printf("Created %d images in %3.4fs\n", images_out.size(),
          omp_get_wtime() - t0);
 }
 
-void ImageGenerator::createImageList(
-    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
-    const std::vector<util::PointList> &nn_points_list,
-    std::vector<std::unique_ptr<cv::Mat>> &images_out,
-    std::vector<std::unique_ptr<candidate::Hand>> &hands_out) const {
-  double t0_images = omp_get_wtime();
+std::vector<util::OcclusionVolume> ImageGenerator::calculateShadows(
+    const util::PointList &point_list) const {
+  double t0 = omp_get_wtime();
+  const int num_cams = point_list.getCamSource().rows();
+  const double length = image_strategy_->getShadowLength();
+  std::vector<util::OcclusionVolume> shadows(
+      num_cams, util::OcclusionVolume(candidate::HandSet::SHADOW_VOXEL_SIZE));
 
-  int m = hand_set_list[0]->getHands().size();
-  int n = hand_set_list.size() * m;
-  std::vector<std::vector<std::unique_ptr<cv::Mat>>> images_list(n);
+  for (int i = 0; i < num_cams; i++) {
+    // Find the points seen by this camera.
+    std::vector<int> indices;
+    for (int j = 0; j < point_list.size(); j++) {
+      if (point_list.getCamSource()(i, j) >= 1) {
+        indices.push_back(j);
+      }
+    }
+    const Eigen::Matrix3Xd points =
+        util::EigenUtils::sliceMatrix(point_list.getPoints(), indices);
+    const Eigen::Vector3d view_point = point_list.getViewPoints().col(i);
+
+    // Each thread casts the shadows of a block of points into its own volume.
+    const int num_blocks = std::max(1, num_threads_);
+    std::vector<util::OcclusionVolume> blocks(
+        num_blocks, util::OcclusionVolume(shadows[i].getVoxelSize()));
 
 #ifdef _OPENMP  // parallelization using OpenMP
 #pragma omp parallel for num_threads(num_threads_)
 #endif
+    for (int j = 0; j < num_blocks; j++) {
+      const int start = (long)points.cols() * j / num_blocks;
+      const int end = (long)points.cols() * (j + 1) / num_blocks;
+      blocks[j].castShadows(points.middleCols(start, end - start), view_point,
+                            length);
+    }
+
+    for (int j = 0; j < num_blocks; j++) {
+      shadows[i].merge(blocks[j]);
+    }
+  }
+
+  printf("Calculated scene shadows (%d cameras) in %3.4fs\n", num_cams,
+         omp_get_wtime() - t0);
+
+  return shadows;
+}
+
+void ImageGenerator::createImageList(
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    const std::vector<util::PointList> &nn_points_list,
+    const std::vector<util::OcclusionVolume> &shadows,
+    net::ImageTensor &images_out) const {
+  // Find the slot of the first image of each hand set in the tensor.
+  std::vector<int> offsets(hand_set_list.size() + 1, 0);
   for (int i = 0; i < hand_set_list.size(); i++) {
-    images_list[i] =
-        image_strategy_->createImages(*hand_set_list[i], nn_points_list[i]);
+    offsets[i + 1] = offsets[i] + hand_set_list[i]->getIsValid().count();
   }
+  images_out.resize(offsets.back(), image_params_.size_, image_params_.size_,
+                    image_params_.num_channels_);
 
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_threads_)
+#endif
   for (int i = 0; i < hand_set_list.size(); i++) {
-    for (int j = 0; j < hand_set_list[i]->getHands().size(); j++) {
-      if (hand_set_list[i]->getIsValid()(j)) {
-        images_out.push_back(std::move(images_list[i][j]));
-        hands_out.push_back(std::move(hand_set_list[i]->getHands()[j]));
-      }
+    if (offsets[i + 1] == offsets[i]) {
+      continue;
     }
+    image_strategy_->createImages(*hand_set_list[i], nn_points_list[i],
+                                  shadows, images_out, offsets[i]);
   }
 }
 
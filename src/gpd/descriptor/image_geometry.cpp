@@ -1,5 +1,7 @@
 #include <gpd/descriptor/image_geometry.h>
 
+#include <algorithm>
+
 namespace gpd {
 namespace descriptor {
 
@@ -28,6 +30,10 @@ ImageGeometry::ImageGeometry(const std::string &filepath) {
   num_channels_ = config_file.getValueOfKey<int>("image_num_channels", 15);
 }
 
+double ImageGeometry::getSearchRadius() const {
+  return std::max(std::max(depth_, height_ / 2.0), outer_diameter_);
+}
+
 std::ostream &operator<<(std::ostream &stream,
                          const ImageGeometry &image_geometry) {
   stream << "============ GRASP IMAGE GEOMETRY ===============\n";
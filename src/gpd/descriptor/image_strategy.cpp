@@ -5,9 +5,19 @@
 #include <gpd/descriptor/image_1_channels_strategy.h>
 #include <gpd/descriptor/image_3_channels_strategy.h>
 
+#include <cfloat>
+#include <limits>
+
 namespace gpd {
 namespace descriptor {
 
+const int ImageStrategy::NUM_PROJECTIONS = 3;
+
+// The coordinates of the unit image that are used as the image row, the image
+// column and the depth in each projection.
+const int ImageStrategy::PROJECTION_AXES[3][3] = {
+    {0, 1, 2}, {2, 1, 0}, {2, 0, 1}};
+
 std::unique_ptr<ImageStrategy> ImageStrategy::makeImageStrategy(
     const ImageGeometry &image_params, int num_threads, int num_orientations,
     bool is_plotting) {
@@ -29,6 +39,20 @@ std::unique_ptr<ImageStrategy> ImageStrategy::makeImageStrategy(
   return strategy;
 }
 
+cv::Mat ImageStrategy::getImageBuffer(net::ImageTensor &images,
+                                      int index) const {
+  cv::Mat image = images.wrapImage(index);
+
+  if (image.empty()) {
+    thread_local cv::Mat buffer;
+    buffer.create(image_params_.size_, image_params_.size_,
+                  CV_8UC(image_params_.num_channels_));
+    image = buffer;
+  }
+
+  return image;
+}
+
 Matrix3XdPair ImageStrategy::transformToUnitImage(
     const util::PointList &point_list, const candidate::Hand &hand) const {
   // 1. Transform points and normals in neighborhood into the hand frame.
@@ -190,46 +214,145 @@ cv::Mat ImageStrategy::createDepthImage(
   return image;
 }
 
-cv::Mat ImageStrategy::createShadowImage(
-    const Eigen::Matrix3Xd &points, const Eigen::VectorXi &cell_indices) const {
-  // Calculate average depth image.
-  cv::Mat image(image_params_.size_, image_params_.size_, CV_32FC1,
-                cv::Scalar(0.0));
-  cv::Mat nonzero(image_params_.size_, image_params_.size_, CV_8UC1,
-                  cv::Scalar(0));
-  float counts[image_params_.size_ * image_params_.size_] = {0};
+void ImageStrategy::createProjectionsImage(const Eigen::Matrix3Xd &points,
+                                           const Eigen::Matrix3Xd &normals,
+                                           const Eigen::Matrix3Xd &shadow,
+                                           cv::Mat &image) const {
+  const int size = image_params_.size_;
+  const int num_pixels = size * size;
+  const int num_channels = image_params_.num_channels_;
+  const int channels_per_projection = num_channels / NUM_PROJECTIONS;
+  const bool has_shadow = channels_per_projection > 4;
+  const double cellsize = 1.0 / (double)size;
+
+  // Find the pixel occupied by the i-th column of <mat> in a projection.
+  auto findPixel = [&](const Eigen::Matrix3Xd &mat, int i, int projection) {
+    const int *axes = PROJECTION_AXES[projection];
+    const int vertical =
+        std::min((int)floor(mat(axes[0], i) / cellsize), size - 1);
+    const int horizontal =
+        std::min((int)floor(mat(axes[1], i) / cellsize), size - 1);
+    return (size - 1 - vertical) * size + horizontal;
+  };
+
+  // The interleaved float image (pixel-major, channels of all projections
+  // next to each other) and the number of points (first half) and shadow
+  // points (second half) in each pixel of each projection.
+  thread_local std::vector<float> raster;
+  thread_local std::vector<float> counts;
+  raster.assign(num_pixels * num_channels, 0.0f);
+  counts.assign(2 * NUM_PROJECTIONS * num_pixels, 0.0f);
+
+  // 1. Rasterize the normals and the average depth of the points.
+  for (int i = 0; i < points.cols(); i++) {
+    const float n[3] = {(float)fabs(normals(0, i)), (float)fabs(normals(1, i)),
+                        (float)fabs(normals(2, i))};
+
+    for (int j = 0; j < NUM_PROJECTIONS; j++) {
+      const int pixel = findPixel(points, i, j);
+      float *v = &raster[pixel * num_channels + j * channels_per_projection];
+      if (v[0] == 0 && v[1] == 0 && v[2] == 0) {
+        v[0] = n[0];
+        v[1] = n[1];
+        v[2] = n[2];
+      } else {
+        const double scale =
+            1.0 / sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (int k = 0; k < 3; k++) {
+          v[k] += (n[k] - v[k]) * scale;
+        }
+      }
+
+      float &count = counts[j * num_pixels + pixel];
+      count += 1.0;
+      v[3] += (points(PROJECTION_AXES[j][2], i) - v[3]) * (1.0 / count);
+    }
+  }
 
-  for (int i = 0; i < cell_indices.rows(); i++) {
-    const int &idx = cell_indices[i];
-    int row = image.rows - 1 - idx / image.cols;
-    int col = idx % image.cols;
-    counts[idx] += 1.0;
-    image.at<float>(row, col) +=
-        (points(2, i) - image.at<float>(row, col)) * (1.0 / counts[idx]);
-    nonzero.at<uchar>(row, col) = 1;
+  // 2. Rasterize the average depth of the shadow points.
+  if (has_shadow) {
+    for (int i = 0; i < shadow.cols(); i++) {
+      for (int j = 0; j < NUM_PROJECTIONS; j++) {
+        const int pixel = findPixel(shadow, i, j);
+        float &v =
+            raster[pixel * num_channels + j * channels_per_projection + 4];
+        float &count = counts[(NUM_PROJECTIONS + j) * num_pixels + pixel];
+        count += 1.0;
+        v += (shadow(PROJECTION_AXES[j][2], i) - v) * (1.0 / count);
+      }
+    }
   }
 
-  // Reverse depth so that closest points have largest value.
-  double min, max;
-  cv::Point min_loc, max_loc;
-  cv::minMaxLoc(image, &min, &max, &min_loc, &max_loc, nonzero);
-  cv::Mat max_img(image_params_.size_, image_params_.size_, CV_32FC1,
-                  cv::Scalar(0.0));
-  max_img.setTo(max, nonzero);
-  image = max_img - image;
+  // 3. Reverse the depth so that the closest points have the largest value.
+  for (int j = 0; j < NUM_PROJECTIONS; j++) {
+    const float *points_count = &counts[j * num_pixels];
+    const float *shadow_count = &counts[(NUM_PROJECTIONS + j) * num_pixels];
+    float max_shadow = -std::numeric_limits<float>::max();
+    if (has_shadow) {
+      for (int k = 0; k < num_pixels; k++) {
+        if (shadow_count[k] > 0) {
+          max_shadow = std::max(
+              max_shadow,
+              raster[k * num_channels + j * channels_per_projection + 4]);
+        }
+      }
+    }
 
-  // Dilate the image to fill in holes.
+    for (int k = 0; k < num_pixels; k++) {
+      float *v = &raster[k * num_channels + j * channels_per_projection];
+      if (points_count[k] > 0) {
+        v[3] = 1.0 - v[3];
+      }
+      if (has_shadow && shadow_count[k] > 0) {
+        v[4] = max_shadow - v[4];
+      }
+    }
+  }
+
+  // 4. Dilate all channels at once to fill in holes.
+  cv::Mat raster_image(size, size, CV_32FC(num_channels), raster.data());
   cv::Mat dilation_element =
       cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-  dilate(image, image, dilation_element);
-
-  // Normalize the image to the range [0,1].
-  cv::normalize(image, image, 0.0, 1.0, cv::NORM_MINMAX, CV_32FC1);
+  cv::dilate(raster_image, raster_image, dilation_element);
+
+  // 5. Normalize each channel to the range [0,1]. The three normals channels
+  // of a projection are normalized together.
+  std::vector<float> min_values(num_channels,
+                                std::numeric_limits<float>::max());
+  std::vector<float> max_values(num_channels,
+                                -std::numeric_limits<float>::max());
+  for (int k = 0; k < num_pixels; k++) {
+    const float *v = &raster[k * num_channels];
+    for (int c = 0; c < num_channels; c++) {
+      min_values[c] = std::min(min_values[c], v[c]);
+      max_values[c] = std::max(max_values[c], v[c]);
+    }
+  }
+  for (int j = 0; j < NUM_PROJECTIONS; j++) {
+    float *min_normals = &min_values[j * channels_per_projection];
+    float *max_normals = &max_values[j * channels_per_projection];
+    std::fill(min_normals, min_normals + 3,
+              *std::min_element(min_normals, min_normals + 3));
+    std::fill(max_normals, max_normals + 3,
+              *std::max_element(max_normals, max_normals + 3));
+  }
 
-  // Convert float image to uchar image, required by Caffe.
-  image.convertTo(image, CV_8U, 255.0);
+  std::vector<double> scales(num_channels);
+  std::vector<double> shifts(num_channels);
+  for (int c = 0; c < num_channels; c++) {
+    const double range = max_values[c] - min_values[c];
+    scales[c] = (range > DBL_EPSILON) ? 1.0 / range : 0.0;
+    shifts[c] = -min_values[c] * scales[c];
+  }
 
-  return image;
+  // 6. Convert the float image to an uchar image, required by Caffe.
+  image.create(size, size, CV_8UC(num_channels));
+  uchar *out = image.ptr<uchar>();
+  for (int k = 0; k < num_pixels * num_channels; k++) {
+    const int c = k % num_channels;
+    const float value = raster[k] * scales[c] + shifts[c];
+    out[k] = cv::saturate_cast<uchar>(value * 255.0f);
+  }
 }
 
 Eigen::VectorXi ImageStrategy::floorVector(const Eigen::VectorXd &a) const {
@@ -30,12 +30,22 @@ GraspDetector::GraspDetector(const candidate::CandidatesGenerator::Parameters& g
          params_.plot_selected_grasps_ ? "true" : "false");
   printf("==============================================\n");
 
+  // Read grasp image parameters.
+  std::string image_geometry_filename = "/home/tad/1_ASCENT/COMPANY/iREX_2019/gpd/cfg/image_geometry_15channels.cfg";
+  descriptor::ImageGeometry image_geom(image_geometry_filename);
+
+  // Cache the point neighborhoods found by the hand search for the image
+  // generation.
+  candidate::HandSearch::Parameters hand_search_params_cached =
+      hand_search_params;
+  hand_search_params_cached.nn_radius_images_ = image_geom.getSearchRadius();
   candidates_generator_ = std::make_unique<candidate::CandidatesGenerator>(
-      generator_params, hand_search_params);
+      generator_params, hand_search_params_cached);
 
   printf("============ CLOUD PREPROCESSING =============\n");
   printf("voxelize: %s\n", generator_params.voxelize_ ? "true" : "false");
   printf("voxel_size: %.3f\n", generator_params.voxel_size_);
+  printf("voxelize_method: %d\n", generator_params.voxelize_method_);
   printf("remove_outliers: %s\n",
          generator_params.remove_statistical_outliers_ ? "true" : "false");
   printStdVector(generator_params.workspace_, "workspace");
@@ -49,6 +59,8 @@ GraspDetector::GraspDetector(const candidate::CandidatesGenerator::Parameters& g
   printf("num_samples: %d\n", hand_search_params.num_samples_);
   printf("num_threads: %d\n", hand_search_params.num_threads_);
   printf("nn_radius: %3.2f\n", hand_search_params.nn_radius_frames_);
+  printf("nn_radius_images: %3.2f\n",
+         hand_search_params_cached.nn_radius_images_);
   printStdVector(hand_search_params.hand_axes_, "hand axes");
   printf("num_orientations: %d\n", hand_search_params.num_orientations_);
   printf("num_finger_placements: %d\n",
@@ -63,9 +75,7 @@ GraspDetector::GraspDetector(const candidate::CandidatesGenerator::Parameters& g
   //  Eigen::Matrix3Xd view_points(3,1);
   //  view_points << camera_position[0], camera_position[1], camera_position[2];
 
-  // Read grasp image parameters.
-  std::string image_geometry_filename = "/home/tad/1_ASCENT/COMPANY/iREX_2019/gpd/cfg/image_geometry_15channels.cfg";
-  descriptor::ImageGeometry image_geom(image_geometry_filename);
+  // Print grasp image parameters.
   std::cout << image_geom;
 
   // Read classification parameters and create classifier.
@@ -73,11 +83,14 @@ GraspDetector::GraspDetector(const candidate::CandidatesGenerator::Parameters& g
   std::string weights_file = "/home/tad/1_ASCENT/COMPANY/iREX_2019/gpd/models/lenet/15channels/params/";
   if (!model_file.empty() || !weights_file.empty()) {
     int device = 0;
-    int batch_size = 1;
+    int batch_size = 8;
     classifier_ = net::Classifier::create(
         model_file, weights_file, static_cast<net::Classifier::Device>(device),
-        batch_size);
+        batch_size, hand_search_params.num_threads_);
+    image_tensor_ = net::ImageTensor(classifier_->getInputLayout(),
+                                     classifier_->getInputPrecision());
     params_.min_score_ = 0;
+    params_.cascade_min_score_ = 0;
     printf("============ CLASSIFIER ======================\n");
     printf("model_file: %s\n", model_file.c_str());
     printf("weights_file: %s\n", weights_file.c_str());
@@ -120,6 +133,11 @@ GraspDetector::GraspDetector(const candidate::CandidatesGenerator::Parameters& g
 
   // Read grasp selection parameters.
   params_.num_selected_ = 100;
+  params_.topk_batch_size_ = 0;
+  params_.topk_bound_margin_ = 0.0;
+  params_.pipeline_chunk_size_ = 0;
+  params_.anytime_batch_size_ = 64;
+  params_.tracking_max_change_ = 0.5;
 
   // Create plotter.
   plotter_ = std::make_unique<util::Plot>(hand_search_params.hand_axes_.size(),
@@ -142,6 +160,15 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
   candidate::HandGeometry hand_geom(hand_geometry_filename);
   std::cout << hand_geom;
 
+  // Read grasp image parameters.
+  std::string image_geometry_filename =
+      config_file.getValueOfKeyAsString("image_geometry_filename", "");
+  if (image_geometry_filename == "0") {
+    image_geometry_filename = config_filename;
+  }
+  descriptor::ImageGeometry image_geom(image_geometry_filename);
+  std::cout << image_geom;
+
   // Read plotting parameters.
   params_.plot_normals_ = config_file.getValueOfKey<bool>("plot_normals", false);
   params_.plot_samples_ = config_file.getValueOfKey<bool>("plot_samples", true);
@@ -184,6 +211,10 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
       config_file.getValueOfKey<bool>("voxelize", true);
   generator_params.voxel_size_ =
       config_file.getValueOfKey<double>("voxel_size", 0.003);
+  generator_params.voxelize_method_ =
+      config_file.getValueOfKey<int>("voxelize_method", 1);
+  generator_params.incremental_preprocessing_ =
+      config_file.getValueOfKey<bool>("incremental_preprocessing", false);
   generator_params.normals_radius_ =
       config_file.getValueOfKey<double>("normals_radius", 0.03);
   generator_params.refine_normals_k_ =
@@ -213,12 +244,16 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
       config_file.getValueOfKey<double>("friction_coeff", 20.0);
   hand_search_params.min_viable_ =
       config_file.getValueOfKey<int>("min_viable", 6);
+  hand_search_params.nn_radius_images_ = image_geom.getSearchRadius();
   candidates_generator_ = std::make_unique<candidate::CandidatesGenerator>(
       generator_params, hand_search_params);
 
   printf("============ CLOUD PREPROCESSING =============\n");
   printf("voxelize: %s\n", generator_params.voxelize_ ? "true" : "false");
   printf("voxel_size: %.3f\n", generator_params.voxel_size_);
+  printf("voxelize_method: %d\n", generator_params.voxelize_method_);
+  printf("incremental_preprocessing: %s\n",
+         generator_params.incremental_preprocessing_ ? "true" : "false");
   printf("remove_outliers: %s\n",
          generator_params.remove_statistical_outliers_ ? "true" : "false");
   printStdVector(generator_params.workspace_, "workspace");
@@ -232,6 +267,7 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
   printf("num_samples: %d\n", hand_search_params.num_samples_);
   printf("num_threads: %d\n", hand_search_params.num_threads_);
   printf("nn_radius: %3.2f\n", hand_search_params.nn_radius_frames_);
+  printf("nn_radius_images: %3.2f\n", hand_search_params.nn_radius_images_);
   printStdVector(hand_search_params.hand_axes_, "hand axes");
   printf("num_orientations: %d\n", hand_search_params.num_orientations_);
   printf("num_finger_placements: %d\n",
@@ -246,15 +282,6 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
   //  Eigen::Matrix3Xd view_points(3,1);
   //  view_points << camera_position[0], camera_position[1], camera_position[2];
 
-  // Read grasp image parameters.
-  std::string image_geometry_filename =
-      config_file.getValueOfKeyAsString("image_geometry_filename", "");
-  if (image_geometry_filename == "0") {
-    image_geometry_filename = config_filename;
-  }
-  descriptor::ImageGeometry image_geom(image_geometry_filename);
-  std::cout << image_geom;
-
   // Read classification parameters and create classifier.
   std::string model_file = config_file.getValueOfKeyAsString("model_file", "");
   std::string weights_file =
@@ -264,13 +291,39 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
     int batch_size = config_file.getValueOfKey<int>("batch_size", 1);
     classifier_ = net::Classifier::create(
         model_file, weights_file, static_cast<net::Classifier::Device>(device),
-        batch_size);
+        batch_size, hand_search_params.num_threads_);
+    image_tensor_ = net::ImageTensor(classifier_->getInputLayout(),
+                                     classifier_->getInputPrecision());
     params_.min_score_ = config_file.getValueOfKey<int>("min_score", 0);
     printf("============ CLASSIFIER ======================\n");
     printf("model_file: %s\n", model_file.c_str());
     printf("weights_file: %s\n", weights_file.c_str());
     printf("batch_size: %d\n", batch_size);
     printf("==============================================\n");
+
+    // Read the parameters of the score cache.
+    int score_cache_size =
+        config_file.getValueOfKey<int>("score_cache_size", 0);
+    if (score_cache_size > 0) {
+      double position_resolution = config_file.getValueOfKey<double>(
+          "score_cache_position_resolution", 0.001);
+      double orientation_resolution = config_file.getValueOfKey<double>(
+          "score_cache_orientation_resolution", 0.01);
+      if (position_resolution <= 0.0 || orientation_resolution <= 0.0) {
+        printf("ERROR: The score cache resolutions must be positive! The score "
+               "cache is disabled.\n");
+      } else {
+        score_cache_ = std::make_unique<ScoreCache>(
+            score_cache_size, position_resolution, orientation_resolution);
+        printf("============ SCORE CACHE =====================\n");
+        printf("score_cache_size: %d\n", score_cache_size);
+        printf("score_cache_position_resolution: %3.4f\n",
+               position_resolution);
+        printf("score_cache_orientation_resolution: %3.4f\n",
+               orientation_resolution);
+        printf("==============================================\n");
+      }
+    }
   }
 
   // Read additional grasp image creation parameters.
@@ -283,6 +336,49 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
       image_geom, hand_search_params.num_threads_,
       hand_search_params.num_orientations_, false, remove_plane);
 
+  // Read the parameters of the first stage of the cascade and create its image
+  // generator and classifier.
+  std::string cascade_model_file =
+      config_file.getValueOfKeyAsString("cascade_model_file", "");
+  std::string cascade_weights_file =
+      config_file.getValueOfKeyAsString("cascade_weights_file", "");
+  params_.cascade_min_score_ =
+      config_file.getValueOfKey<double>("cascade_min_score", 0.0);
+  if (classifier_ &&
+      (!cascade_model_file.empty() || !cascade_weights_file.empty())) {
+    std::string cascade_image_geometry_filename =
+        config_file.getValueOfKeyAsString("cascade_image_geometry_filename",
+                                          "");
+    // The default image geometry does not match the first-stage network, so
+    // the cascade would silently score all candidates zero without this file.
+    if (!std::ifstream(cascade_image_geometry_filename).good()) {
+      printf("ERROR: The cascade needs an image geometry file (see "
+             "cascade_image_geometry_filename)! The cascade is disabled.\n");
+    } else {
+      descriptor::ImageGeometry cascade_image_geom(
+          cascade_image_geometry_filename);
+      int device = config_file.getValueOfKey<int>("device", 0);
+      int batch_size = config_file.getValueOfKey<int>("batch_size", 1);
+      cascade_classifier_ = net::Classifier::create(
+          cascade_model_file, cascade_weights_file,
+          static_cast<net::Classifier::Device>(device), batch_size,
+          hand_search_params.num_threads_);
+      cascade_image_tensor_ =
+          net::ImageTensor(cascade_classifier_->getInputLayout(),
+                           cascade_classifier_->getInputPrecision());
+      cascade_image_generator_ = std::make_unique<descriptor::ImageGenerator>(
+          cascade_image_geom, hand_search_params.num_threads_,
+          hand_search_params.num_orientations_, false, remove_plane);
+      printf("============ CASCADE =========================\n");
+      printf("cascade_image_geometry_filename: %s\n",
+             cascade_image_geometry_filename.c_str());
+      printf("cascade_model_file: %s\n", cascade_model_file.c_str());
+      printf("cascade_weights_file: %s\n", cascade_weights_file.c_str());
+      printf("cascade_min_score: %3.4f\n", params_.cascade_min_score_);
+      printf("==============================================\n");
+    }
+  }
+
   // Read grasp filtering parameters based on robot workspace and gripper width.
   params_.workspace_grasps_ = config_file.getValueOfKeyAsStdVectorDouble(
       "workspace_grasps", "-1 1 -1 1 -1 1");
@@ -312,6 +408,56 @@ GraspDetector::GraspDetector(const std::string &config_filename) {
 
   // Read grasp selection parameters.
   params_.num_selected_ = config_file.getValueOfKey<int>("num_selected", 100);
+  params_.topk_batch_size_ =
+      config_file.getValueOfKey<int>("topk_batch_size", 0);
+  params_.topk_bound_margin_ =
+      config_file.getValueOfKey<double>("topk_bound_margin", 0.0);
+  if (params_.topk_batch_size_ > 0) {
+    printf("============ TOP-K SELECTION =================\n");
+    printf("topk_batch_size: %d\n", params_.topk_batch_size_);
+    printf("topk_bound_margin: %3.4f\n", params_.topk_bound_margin_);
+    if (!cascade_classifier_) {
+      printf("No upper bounds without the cascade: no candidates are "
+             "skipped.\n");
+    }
+    if (score_cache_) {
+      printf("The score cache is not used in the top-k selection.\n");
+    }
+    printf("==============================================\n");
+  }
+
+  // Read pipelining parameters.
+  params_.pipeline_chunk_size_ =
+      config_file.getValueOfKey<int>("pipeline_chunk_size", 0);
+  if (params_.pipeline_chunk_size_ > 0) {
+    printf("============ PIPELINE ========================\n");
+    printf("pipeline_chunk_size: %d\n", params_.pipeline_chunk_size_);
+    if (cascade_classifier_ || score_cache_) {
+      printf("The cascade and the score cache are not used in the pipeline.\n");
+    }
+    printf("==============================================\n");
+  }
+
+  // Read deadline-bounded detection parameters.
+  params_.anytime_batch_size_ =
+      config_file.getValueOfKey<int>("anytime_batch_size", 64);
+
+  // Read tracking parameters.
+  double tracking_voxel_size =
+      config_file.getValueOfKey<double>("tracking_voxel_size", 0.0);
+  params_.tracking_max_change_ =
+      config_file.getValueOfKey<double>("tracking_max_change", 0.5);
+  if (tracking_voxel_size > 0.0) {
+    double tracking_change_radius =
+        config_file.getValueOfKey<double>("tracking_change_radius", 0.03);
+    tracker_ = std::make_unique<GraspTracker>(tracking_voxel_size,
+                                              tracking_change_radius);
+    printf("============ TRACKING ========================\n");
+    printf("tracking_voxel_size: %3.4f\n", tracking_voxel_size);
+    printf("tracking_change_radius: %3.4f\n", tracking_change_radius);
+    printf("tracking_max_change: %3.4f\n", params_.tracking_max_change_);
+    printf("==============================================\n");
+  }
 
   // Create plotter.
   plotter_ = std::make_unique<util::Plot>(hand_search_params.hand_axes_.size(),
@@ -348,67 +494,111 @@ std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::detectGrasps(
     plotter_->plotNormals(cloud);
   }
 
-  // 1. Generate grasp candidates.
-  double t0_candidates = omp_get_wtime();
-  std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list =
-      candidates_generator_->generateGraspCandidateSets(cloud);
-  printf("Generated %zu hand sets.\n", hand_set_list.size());
-  if (hand_set_list.size() == 0) {
-    return hands_out;
-  }
-  double t_candidates = omp_get_wtime() - t0_candidates;
-  if (params_.plot_candidates_) {
-    plotter_->plotFingers3D(hand_set_list, cloud.getCloudOriginal(),
-                            "Grasp candidates", hand_geom);
-  }
+  // Build the spatial index that is shared by all stages below (no-op if the
+  // preprocessing has already built it).
+  double t0_index = omp_get_wtime();
+  cloud.getSearchTree();
+  double t_index = omp_get_wtime() - t0_index;
 
-  // 2. Filter the candidates.
-  double t0_filter = omp_get_wtime();
-  std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list_filtered =
-      filterGraspsWorkspace(hand_set_list, params_.workspace_grasps_);
-  if (hand_set_list_filtered.size() == 0) {
-    return hands_out;
-  }
-  if (params_.plot_filtered_candidates_) {
-    plotter_->plotFingers3D(hand_set_list_filtered, cloud.getCloudOriginal(),
-                            "Filtered Grasps (Aperture, Workspace)", hand_geom);
-  }
-  if (params_.filter_approach_direction_) {
-    hand_set_list_filtered =
-        filterGraspsDirection(hand_set_list_filtered, params_.direction_, params_.thresh_rad_);
+  std::vector<std::unique_ptr<candidate::Hand>> hands;
+  double t_candidates = 0.0;
+  double t_filter = 0.0;
+  double t_cascade = 0.0;
+  double t_images = 0.0;
+  double t_classify = 0.0;
+  double t_pipeline = 0.0;
+  double t_first_score = 0.0;
+  int num_candidates = 0;
+  int num_rejected = 0;
+  int num_classified = 0;
+  int num_scored = 0;
+  int num_skipped = 0;
+
+  if (params_.pipeline_chunk_size_ > 0) {
+    // 1.-5. Stream chunks of samples through candidate generation, filtering,
+    // image creation and classification.
+    double t0_pipeline = omp_get_wtime();
+    hands = streamGraspCandidates(cloud, t_first_score);
+    t_pipeline = omp_get_wtime() - t0_pipeline;
+    t_first_score -= t0_pipeline;
+    num_classified = hands.size();
+    if (hands.size() == 0) {
+      return hands_out;
+    }
+  } else {
+    // 1. Generate grasp candidates.
+    double t0_candidates = omp_get_wtime();
+    std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list =
+        candidates_generator_->generateGraspCandidateSets(cloud);
+    printf("Generated %zu hand sets.\n", hand_set_list.size());
+    if (hand_set_list.size() == 0) {
+      return hands_out;
+    }
+    t_candidates = omp_get_wtime() - t0_candidates;
+    if (params_.plot_candidates_) {
+      plotter_->plotFingers3D(hand_set_list, cloud.getCloudOriginal(),
+                              "Grasp candidates", hand_geom);
+    }
+
+    // 2. Filter the candidates.
+    double t0_filter = omp_get_wtime();
+    std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list_filtered =
+        filterGraspsWorkspace(hand_set_list, params_.workspace_grasps_);
+    if (hand_set_list_filtered.size() == 0) {
+      return hands_out;
+    }
     if (params_.plot_filtered_candidates_) {
-      plotter_->plotFingers3D(hand_set_list_filtered, cloud.getCloudOriginal(),
-                              "Filtered Grasps (Approach)", hand_geom);
+      plotter_->plotFingers3D(hand_set_list_filtered,
+                              cloud.getCloudOriginal(),
+                              "Filtered Grasps (Aperture, Workspace)",
+                              hand_geom);
+    }
+    if (params_.filter_approach_direction_) {
+      hand_set_list_filtered = filterGraspsDirection(
+          hand_set_list_filtered, params_.direction_, params_.thresh_rad_);
+      if (params_.plot_filtered_candidates_) {
+        plotter_->plotFingers3D(hand_set_list_filtered,
+                                cloud.getCloudOriginal(),
+                                "Filtered Grasps (Approach)", hand_geom);
+      }
+    }
+    t_filter = omp_get_wtime() - t0_filter;
+    if (hand_set_list_filtered.size() == 0) {
+      return hands_out;
     }
-  }
-  double t_filter = omp_get_wtime() - t0_filter;
-  if (hand_set_list_filtered.size() == 0) {
-    return hands_out;
-  }
 
-  // 3. Create grasp descriptors (images).
-  double t0_images = omp_get_wtime();
-  std::vector<std::unique_ptr<candidate::Hand>> hands;
-  std::vector<std::unique_ptr<cv::Mat>> images;
-  image_generator_->createImages(cloud, hand_set_list_filtered, images, hands);
-  double t_images = omp_get_wtime() - t0_images;
+    // 3. Reject obvious negatives with the first stage of the cascade.
+    if (cascade_classifier_) {
+      double t0_cascade = omp_get_wtime();
+      hand_set_list_filtered = rejectGraspCandidates(
+          cloud, hand_set_list_filtered, num_candidates, num_rejected);
+      t_cascade = omp_get_wtime() - t0_cascade;
+      if (hand_set_list_filtered.size() == 0) {
+        return hands_out;
+      }
+    }
 
-  // 4. Classify the grasp candidates.
-  double t0_classify = omp_get_wtime();
-  std::vector<float> scores = classifier_->classifyImages(images);
-  for (int i = 0; i < hands.size(); i++) {
-    hands[i]->setScore(scores[i]);
+    // 4. Create grasp descriptors (images) in the classifier's input layout and
+    // 5. classify the grasp candidates.
+    if (params_.topk_batch_size_ > 0) {
+      num_classified =
+          selectGraspCandidates(cloud, hand_set_list_filtered, hands,
+                                num_skipped, t_images, t_classify);
+    } else {
+      num_classified = scoreGraspCandidates(cloud, hand_set_list_filtered,
+                                            hands, t_images, t_classify);
+    }
   }
-  double t_classify = omp_get_wtime() - t0_classify;
+  num_scored = hands.size();
 
-  // 5. Select the <num_selected> highest scoring grasps.
+  // 6. Select the <num_selected> highest scoring grasps.
   hands = selectGrasps(hands);
   if (params_.plot_valid_grasps_) {
     plotter_->plotFingers3D(hands, cloud.getCloudOriginal(), "Valid Grasps",
                             hand_geom);
   }
 
-  // 6. Cluster the grasps.
+  // 7. Cluster the grasps.
   double t0_cluster = omp_get_wtime();
   std::vector<std::unique_ptr<candidate::Hand>> clusters;
   if (params_.cluster_grasps_) {
@@ -430,7 +620,7 @@ std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::detectGrasps(
   }
   double t_cluster = omp_get_wtime() - t0_cluster;
 
-  // 7. Sort grasps by their score.
+  // 8. Sort grasps by their score.
   std::sort(clusters.begin(), clusters.end(), isScoreGreater);
   printf("======== Selected grasps ========\n");
   for (int i = 0; i < clusters.size(); i++) {
@@ -440,9 +630,29 @@ std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::detectGrasps(
   double t_total = omp_get_wtime() - t0_total;
 
   printf("======== RUNTIMES ========\n");
-  printf(" 1. Candidate generation: %3.4fs\n", t_candidates);
-  printf(" 2. Descriptor extraction: %3.4fs\n", t_images);
-  printf(" 3. Classification: %3.4fs\n", t_classify);
+  printf(" 0. Spatial index: %3.4fs\n", t_index);
+  if (params_.pipeline_chunk_size_ > 0) {
+    printf(" 1.-3. Pipeline: %3.4fs (%d candidates, first scores after "
+           "%3.4fs)\n",
+           t_pipeline, num_classified, t_first_score);
+  } else {
+    printf(" 1. Candidate generation: %3.4fs\n", t_candidates);
+    if (cascade_classifier_) {
+      printf(" 1a. Cascade (first stage): %3.4fs, rejected %d of %d\n",
+             t_cascade, num_rejected, num_candidates);
+    }
+    printf(" 2. Descriptor extraction: %3.4fs\n", t_images);
+    printf(" 3. Classification: %3.4fs (%d candidates)\n", t_classify,
+           num_classified);
+    if (params_.topk_batch_size_ > 0) {
+      printf(" 3a. Top-k selection: skipped %d candidates\n", num_skipped);
+    } else if (score_cache_) {
+      printf(" 3a. Score cache: %d of %d candidates cached (%ld hits, %ld "
+             "misses in total)\n",
+             num_scored - num_classified, num_scored,
+             score_cache_->getNumHits(), score_cache_->getNumMisses());
+    }
+  }
   // printf(" Filtering: %3.4fs\n", t_filter);
   // printf(" Clustering: %3.4fs\n", t_cluster);
   printf("==========\n");
@@ -456,6 +666,239 @@ std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::detectGrasps(
   return clusters;
 }
 
+std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::detectGrasps(
+    const util::Cloud &cloud, double deadline, double &budget_used) {
+  double t0_total = omp_get_wtime();
+  const double t_end = t0_total + deadline;
+  std::vector<std::unique_ptr<candidate::Hand>> hands;
+  budget_used = 0.0;
+
+  // Check if the point cloud is empty.
+  if (cloud.getCloudOriginal()->size() == 0) {
+    printf("ERROR: Point cloud is empty!");
+    return hands;
+  }
+  cloud.getSearchTree();
+
+  // Process the samples in a random (but fixed) order, so that the grasps found
+  // before the deadline are spread over the whole scene.
+  const Eigen::Matrix3Xd samples = candidates_generator_->getSamples(cloud);
+  const int num_samples = samples.cols();
+  if (num_samples == 0) {
+    printf("ERROR: No samples or no indices!\n");
+    return hands;
+  }
+  std::vector<int> order(num_samples);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(0));
+
+  // Do not start any batch if the deadline has already passed.
+  if (omp_get_wtime() >= t_end) {
+    printf("Deadline passed before the first batch: no samples processed.\n");
+    return hands;
+  }
+
+  // Prepare the point cloud data that is shared by all batches.
+  const descriptor::ImageGenerator::Scene scene =
+      image_generator_->createScene(cloud);
+  descriptor::ImageGenerator::Scene cascade_scene;
+  if (cascade_classifier_) {
+    cascade_scene = cascade_image_generator_->createScene(cloud);
+  }
+
+  const int batch_size = std::max(1, params_.anytime_batch_size_);
+  Eigen::Matrix3Xd batch(3, batch_size);
+  TopKSelector selector(params_.num_selected_);
+  double t_batch = 0.0;  // duration of the slowest batch so far
+  double t_images = 0.0;
+  double t_classify = 0.0;
+  int num_processed = 0;
+  int num_batches = 0;
+
+  while (num_processed < num_samples) {
+    double t0_batch = omp_get_wtime();
+    if (t0_batch + t_batch >= t_end) {
+      break;
+    }
+
+    // 1. Take the next batch of samples.
+    const int n = std::min(batch_size, num_samples - num_processed);
+    batch.resize(3, n);
+    for (int i = 0; i < n; i++) {
+      batch.col(i) = samples.col(order[num_processed + i]);
+    }
+    num_processed += n;
+    num_batches++;
+
+    // 2.-5. Search, filter and score the grasp candidates.
+    std::vector<std::unique_ptr<candidate::Hand>> hands_batch =
+        scoreSamples(cloud, batch, t_images, t_classify, &scene,
+                     &cascade_scene);
+
+    // 6. Keep only the <num_selected> highest scoring grasps.
+    for (int i = 0; i < hands_batch.size(); i++) {
+      selector.push(std::move(hands_batch[i]));
+    }
+
+    t_batch = std::max(t_batch, omp_get_wtime() - t0_batch);
+  }
+  budget_used = (double)num_processed / (double)num_samples;
+
+  // 7. Cluster the grasps and sort them by their score.
+  hands = selector.extract();
+  std::vector<std::unique_ptr<candidate::Hand>> clusters =
+      clusterGrasps(hands);
+  double t_total = omp_get_wtime() - t0_total;
+
+  printf("======== ANYTIME DETECTION ========\n");
+  printf("Processed %d of %d samples (%3.1f%%) in %d batches.\n",
+         num_processed, num_samples, 100.0 * budget_used, num_batches);
+  printf("Selected %zu grasps in %3.4fs (deadline: %3.4fs).\n",
+         clusters.size(), t_total, deadline);
+  printf(" Descriptor extraction: %3.4fs, classification: %3.4fs\n",
+         t_images, t_classify);
+
+  return clusters;
+}
+
+std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::trackGrasps(
+    const util::Cloud &cloud) {
+  if (!tracker_) {
+    printf("ERROR: Tracking is disabled (see tracking_voxel_size)!\n");
+    return detectGrasps(cloud);
+  }
+
+  double t0_total = omp_get_wtime();
+  tracker_->update(cloud);
+
+  // Detect grasps from scratch in the first cloud or if the scene has changed
+  // too much.
+  if (!tracker_->hasPreviousFrame() ||
+      tracker_->getChangedFraction() > params_.tracking_max_change_) {
+    std::vector<std::unique_ptr<candidate::Hand>> hands = detectGrasps(cloud);
+    tracker_->setGrasps(hands);
+    return hands;
+  }
+  cloud.getSearchTree();
+
+  // 1. Re-check the previous grasps on the new cloud. In unchanged regions,
+  // grasps that are still collision-free and contain points in their closing
+  // region keep their score, whether or not they are antipodal. In changed
+  // regions, the hand search is repeated at their samples.
+  std::vector<std::unique_ptr<candidate::Hand>> previous =
+      tracker_->copyGrasps();
+  Eigen::Array<bool, 1, Eigen::Dynamic> is_valid;
+  candidates_generator_->reevaluateHypotheses(cloud, previous, is_valid);
+  TopKSelector selector(params_.num_selected_);
+  std::vector<int> resampled;
+  int num_kept = 0;
+
+  for (int i = 0; i < previous.size(); i++) {
+    if (tracker_->isChanged(previous[i]->getSample())) {
+      resampled.push_back(i);
+    } else if (is_valid(i)) {
+      selector.push(std::move(previous[i]));
+      num_kept++;
+    }
+  }
+
+  // 2. Sample only the changed regions of the new cloud.
+  const Eigen::Matrix3Xd samples_all =
+      candidates_generator_->getSamples(cloud);
+  const Eigen::Matrix3Xd samples_changed =
+      tracker_->selectChanged(samples_all);
+  Eigen::Matrix3Xd samples(3, samples_changed.cols() + resampled.size());
+  samples.leftCols(samples_changed.cols()) = samples_changed;
+  for (int i = 0; i < resampled.size(); i++) {
+    samples.col(samples_changed.cols() + i) =
+        previous[resampled[i]]->getSample();
+  }
+
+  // 3.-5. Search, filter and score the grasp candidates at these samples.
+  double t_images = 0.0;
+  double t_classify = 0.0;
+  if (samples.cols() > 0) {
+    std::vector<std::unique_ptr<candidate::Hand>> hands =
+        scoreSamples(cloud, samples, t_images, t_classify);
+    for (int i = 0; i < hands.size(); i++) {
+      selector.push(std::move(hands[i]));
+    }
+  }
+
+  // 6. Select, cluster and sort the grasps, and keep them for the next cloud.
+  std::vector<std::unique_ptr<candidate::Hand>> hands = selector.extract();
+  std::vector<std::unique_ptr<candidate::Hand>> clusters =
+      clusterGrasps(hands);
+  tracker_->setGrasps(clusters);
+  double t_total = omp_get_wtime() - t0_total;
+
+  printf("======== TRACKING ========\n");
+  printf("Kept %d of %zu previous grasps, searched %d of %d samples.\n",
+         num_kept, previous.size(), (int)samples.cols(),
+         (int)samples_all.cols());
+  printf(" Descriptor extraction: %3.4fs, classification: %3.4fs\n",
+         t_images, t_classify);
+  printf(" TOTAL: %3.4fs\n", t_total);
+
+  return clusters;
+}
+
+std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::scoreSamples(
+    const util::Cloud &cloud, const Eigen::Matrix3Xd &samples,
+    double &t_images, double &t_classify,
+    const descriptor::ImageGenerator::Scene *scene,
+    const descriptor::ImageGenerator::Scene *cascade_scene) {
+  std::vector<std::unique_ptr<candidate::Hand>> hands_out;
+
+  // 1. Generate grasp candidates.
+  std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list =
+      candidates_generator_->generateGraspCandidateSets(cloud, samples);
+
+  // 2. Filter the candidates.
+  hand_set_list =
+      filterGraspsWorkspace(hand_set_list, params_.workspace_grasps_);
+  if (params_.filter_approach_direction_) {
+    hand_set_list = filterGraspsDirection(hand_set_list, params_.direction_,
+                                          params_.thresh_rad_);
+  }
+
+  // 3. Reject obvious negatives with the first stage of the cascade.
+  if (cascade_classifier_ && hand_set_list.size() > 0) {
+    int num_candidates, num_rejected;
+    hand_set_list = rejectGraspCandidates(
+        cloud, hand_set_list, num_candidates, num_rejected, cascade_scene);
+  }
+
+  // 4.-5. Create the grasp images and classify the candidates.
+  if (hand_set_list.size() > 0) {
+    double t_images_samples, t_classify_samples;
+    scoreGraspCandidates(cloud, hand_set_list, hands_out, t_images_samples,
+                         t_classify_samples, scene);
+    t_images += t_images_samples;
+    t_classify += t_classify_samples;
+  }
+
+  return hands_out;
+}
+
+std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::clusterGrasps(
+    std::vector<std::unique_ptr<candidate::Hand>> &hands) {
+  std::vector<std::unique_ptr<candidate::Hand>> clusters;
+  if (params_.cluster_grasps_ && hands.size() > 0) {
+    clusters = clustering_->findClusters(hands);
+    if (clusters.size() <= 3) {
+      for (int i = 0; i < hands.size(); i++) {
+        clusters.push_back(std::move(hands[i]));
+      }
+    }
+  } else {
+    clusters = std::move(hands);
+  }
+
+  std::sort(clusters.begin(), clusters.end(), isScoreGreater);
+  return clusters;
+}
+
 void GraspDetector::preprocessPointCloud(util::Cloud &cloud) {
   candidates_generator_->preprocessPointCloud(cloud);
 }
@@ -531,6 +974,367 @@ GraspDetector::generateGraspCandidates(const util::Cloud &cloud) {
   return candidates_generator_->generateGraspCandidateSets(cloud);
 }
 
+std::vector<std::unique_ptr<candidate::HandSet>>
+GraspDetector::rejectGraspCandidates(
+    const util::Cloud &cloud,
+    std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    int &num_candidates, int &num_rejected,
+    const descriptor::ImageGenerator::Scene *scene) {
+  // 1. Create the first-stage images. The grasps stay in their hand sets.
+  if (scene) {
+    cascade_image_generator_->createImages(cloud, *scene, hand_set_list,
+                                           cascade_image_tensor_);
+  } else {
+    cascade_image_generator_->createImages(cloud, hand_set_list,
+                                           cascade_image_tensor_);
+  }
+
+  // 2. Classify the grasp candidates with the first stage.
+  std::vector<float> scores =
+      cascade_classifier_->classifyImages(cascade_image_tensor_);
+
+  // 3. Reject the grasps with a score below <cascade_min_score>. The scores
+  // are in the order of the valid grasps.
+  std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list_out;
+  num_candidates = 0;
+  num_rejected = 0;
+
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    Eigen::Array<bool, 1, Eigen::Dynamic> is_valid =
+        hand_set_list[i]->getIsValid();
+
+    for (int j = 0; j < is_valid.size(); j++) {
+      if (is_valid(j)) {
+        if (scores[num_candidates] < params_.cascade_min_score_) {
+          is_valid(j) = false;
+          num_rejected++;
+        } else {
+          hand_set_list[i]->getHands()[j]->setScore(scores[num_candidates]);
+        }
+        num_candidates++;
+      }
+    }
+
+    if (is_valid.any()) {
+      hand_set_list_out.push_back(std::move(hand_set_list[i]));
+      hand_set_list_out[hand_set_list_out.size() - 1]->setIsValid(is_valid);
+    }
+  }
+
+  printf("Cascade rejected %d of %d grasp candidates.\n", num_rejected,
+         num_candidates);
+
+  return hand_set_list_out;
+}
+
+int GraspDetector::scoreGraspCandidates(
+    const util::Cloud &cloud,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    std::vector<std::unique_ptr<candidate::Hand>> &hands_out,
+    double &t_images, double &t_classify,
+    const descriptor::ImageGenerator::Scene *scene) {
+  if (!score_cache_) {
+    double t0_images = omp_get_wtime();
+    if (scene) {
+      image_generator_->createImages(cloud, *scene, hand_set_list,
+                                     image_tensor_, hands_out);
+    } else {
+      image_generator_->createImages(cloud, hand_set_list, image_tensor_,
+                                     hands_out);
+    }
+    t_images = omp_get_wtime() - t0_images;
+
+    double t0_classify = omp_get_wtime();
+    std::vector<float> scores = classifier_->classifyImages(image_tensor_);
+    for (int i = 0; i < hands_out.size(); i++) {
+      hands_out[i]->setScore(scores[i]);
+    }
+    t_classify = omp_get_wtime() - t0_classify;
+    return scores.size();
+  }
+
+  // 1. Look up the candidates in the cache. Only the misses stay valid, so
+  // that images are only created for them.
+  double t0_images = omp_get_wtime();
+  const uint64_t cloud_hash = ScoreCache::hashCloud(cloud);
+  std::vector<Eigen::Array<bool, 1, Eigen::Dynamic>> is_valid_list(
+      hand_set_list.size());
+  std::vector<uint64_t> keys;
+
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    const std::vector<std::unique_ptr<candidate::Hand>> &hands =
+        hand_set_list[i]->getHands();
+    is_valid_list[i] = hand_set_list[i]->getIsValid();
+    Eigen::Array<bool, 1, Eigen::Dynamic> is_miss = is_valid_list[i];
+
+    for (int j = 0; j < hands.size(); j++) {
+      if (is_valid_list[i](j)) {
+        const uint64_t key = score_cache_->computeKey(*hands[j], cloud_hash);
+        float score;
+        if (score_cache_->find(key, score)) {
+          hands[j]->setScore(score);
+          is_miss(j) = false;
+        } else {
+          keys.push_back(key);
+        }
+      }
+    }
+
+    hand_set_list[i]->setIsValid(is_miss);
+  }
+
+  // 2. Create the images of the misses.
+  if (keys.size() > 0) {
+    if (scene) {
+      image_generator_->createImages(cloud, *scene, hand_set_list,
+                                     image_tensor_);
+    } else {
+      image_generator_->createImages(cloud, hand_set_list, image_tensor_);
+    }
+  }
+  t_images = omp_get_wtime() - t0_images;
+
+  // 3. Classify the misses and add their scores to the cache.
+  double t0_classify = omp_get_wtime();
+  std::vector<float> scores;
+  if (keys.size() > 0) {
+    scores = classifier_->classifyImages(image_tensor_);
+  }
+  int k = 0;
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    const std::vector<std::unique_ptr<candidate::Hand>> &hands =
+        hand_set_list[i]->getHands();
+    const Eigen::Array<bool, 1, Eigen::Dynamic> &is_miss =
+        hand_set_list[i]->getIsValid();
+
+    for (int j = 0; j < hands.size(); j++) {
+      if (is_miss(j)) {
+        hands[j]->setScore(scores[k]);
+        score_cache_->insert(keys[k], scores[k]);
+        k++;
+      }
+    }
+
+    // 4. Restore the valid candidates and take them out of their set.
+    hand_set_list[i]->setIsValid(is_valid_list[i]);
+    for (int j = 0; j < hands.size(); j++) {
+      if (is_valid_list[i](j)) {
+        hands_out.push_back(std::move(hand_set_list[i]->getHands()[j]));
+      }
+    }
+  }
+  t_classify = omp_get_wtime() - t0_classify;
+
+  return scores.size();
+}
+
+int GraspDetector::selectGraspCandidates(
+    const util::Cloud &cloud,
+    const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
+    std::vector<std::unique_ptr<candidate::Hand>> &hands_out,
+    int &num_skipped, double &t_images, double &t_classify) {
+  // Without the cascade, there is no bound on the scores.
+  const bool has_bounds = (cascade_classifier_ != nullptr);
+  auto bound = [&](const std::pair<int, int> &c) {
+    return has_bounds
+               ? hand_set_list[c.first]->getHands()[c.second]->getScore() +
+                     params_.topk_bound_margin_
+               : std::numeric_limits<double>::infinity();
+  };
+
+  // 1. Order the candidates (hand set, hand) by their upper bound.
+  std::vector<std::pair<int, int>> candidates;
+  std::vector<Eigen::Array<bool, 1, Eigen::Dynamic>> is_valid_list(
+      hand_set_list.size());
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    is_valid_list[i] = hand_set_list[i]->getIsValid();
+    for (int j = 0; j < is_valid_list[i].size(); j++) {
+      if (is_valid_list[i](j)) {
+        candidates.push_back(std::make_pair(i, j));
+      }
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&](const std::pair<int, int> &a,
+                       const std::pair<int, int> &b) {
+                     return bound(a) > bound(b);
+                   });
+
+  const descriptor::ImageGenerator::Scene scene =
+      image_generator_->createScene(cloud);
+  TopKSelector selector(params_.num_selected_);
+  std::vector<std::pair<int, int>> batch;
+  int num_classified = 0;
+  num_skipped = 0;
+  t_images = 0.0;
+  t_classify = 0.0;
+
+  for (int start = 0; start < candidates.size();
+       start += params_.topk_batch_size_) {
+    // The bounds of the remaining candidates are at most this one.
+    if (!selector.canEnter(bound(candidates[start]))) {
+      num_skipped += candidates.size() - start;
+      break;
+    }
+
+    // 2. Only the candidates of the batch that can still be selected stay
+    // valid, so that images are only created for them.
+    const int end = std::min((int)candidates.size(),
+                             start + params_.topk_batch_size_);
+    for (int i = 0; i < hand_set_list.size(); i++) {
+      hand_set_list[i]->setIsValid(
+          Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(
+              is_valid_list[i].size(), false));
+    }
+    batch.clear();
+    for (int k = start; k < end; k++) {
+      if (selector.canEnter(bound(candidates[k]))) {
+        batch.push_back(candidates[k]);
+        Eigen::Array<bool, 1, Eigen::Dynamic> is_valid =
+            hand_set_list[candidates[k].first]->getIsValid();
+        is_valid(candidates[k].second) = true;
+        hand_set_list[candidates[k].first]->setIsValid(is_valid);
+      } else {
+        num_skipped++;
+      }
+    }
+
+    // 3. Create the images and classify them. The images are in the order of
+    // the valid candidates in <hand_set_list>.
+    double t0_images = omp_get_wtime();
+    image_generator_->createImages(cloud, scene, hand_set_list, image_tensor_);
+    t_images += omp_get_wtime() - t0_images;
+
+    double t0_classify = omp_get_wtime();
+    std::vector<float> scores = classifier_->classifyImages(image_tensor_);
+    t_classify += omp_get_wtime() - t0_classify;
+    num_classified += scores.size();
+
+    // 4. Update the selection.
+    std::sort(batch.begin(), batch.end());
+    for (int k = 0; k < batch.size(); k++) {
+      std::unique_ptr<candidate::Hand> &hand =
+          hand_set_list[batch[k].first]->getHands()[batch[k].second];
+      hand->setScore(scores[k]);
+      selector.push(std::move(hand));
+    }
+  }
+
+  for (int i = 0; i < hand_set_list.size(); i++) {
+    hand_set_list[i]->setIsValid(is_valid_list[i]);
+  }
+  hands_out = selector.extract();
+  printf("Top-k selection classified %d and skipped %d of %zu candidates.\n",
+         num_classified, num_skipped, candidates.size());
+
+  return num_classified;
+}
+
+std::vector<std::unique_ptr<candidate::Hand>>
+GraspDetector::streamGraspCandidates(const util::Cloud &cloud,
+                                     double &t_first_score) {
+  std::vector<std::unique_ptr<candidate::Hand>> hands_out;
+  t_first_score = 0.0;
+
+  const Eigen::Matrix3Xd samples = candidates_generator_->getSamples(cloud);
+  const int chunk_size = params_.pipeline_chunk_size_;
+  const int num_chunks = (samples.cols() + chunk_size - 1) / chunk_size;
+  if (num_chunks == 0) {
+    printf("ERROR: No samples or no indices!\n");
+    return hands_out;
+  }
+
+  // The points and shadows of the scene are shared by all chunks.
+  const descriptor::ImageGenerator::Scene scene =
+      image_generator_->createScene(cloud);
+
+  // A chunk occupies a slot from its candidate generation until its
+  // classification. The number of slots bounds the chunks in flight and the
+  // memory for their images.
+  const int num_threads = getHandSearchParameters().num_threads_;
+  const int num_slots = std::min(num_chunks, 2 * num_threads);
+  std::vector<net::ImageTensor> image_tensors(
+      num_slots, net::ImageTensor(classifier_->getInputLayout(),
+                                  classifier_->getInputPrecision()));
+  std::vector<std::vector<std::unique_ptr<candidate::Hand>>> chunk_hands(
+      num_chunks);
+  // Dependency tokens of the slots and of the classifier. A classifier that
+  // is not reentrant classifies one chunk at a time.
+  std::vector<char> slots(num_slots);
+  char classifier_token;
+  const bool is_reentrant = classifier_->isReentrant();
+
+  // The tasks run on one team of threads. Parallel regions inside the stages
+  // are nested and run on the thread of their task.
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel num_threads(num_threads)
+#pragma omp single
+#endif
+  for (int k = 0; k < num_chunks; k++) {
+    char *slot = &slots[k % num_slots];
+    char *classifier_dep = is_reentrant ? slot : &classifier_token;
+    net::ImageTensor *images = &image_tensors[k % num_slots];
+    std::vector<std::unique_ptr<candidate::Hand>> *hands = &chunk_hands[k];
+
+    // Generate and filter the candidates of chunk k, and create their images.
+#ifdef _OPENMP
+#pragma omp task depend(inout : slot[0]) firstprivate(k, images, hands)
+#endif
+    {
+      const int start = k * chunk_size;
+      const int n = std::min(chunk_size, (int)samples.cols() - start);
+      std::vector<std::unique_ptr<candidate::HandSet>> hand_set_list =
+          candidates_generator_->generateGraspCandidateSets(
+              cloud, samples.middleCols(start, n));
+      hand_set_list =
+          filterGraspsWorkspace(hand_set_list, params_.workspace_grasps_);
+      if (params_.filter_approach_direction_) {
+        hand_set_list = filterGraspsDirection(
+            hand_set_list, params_.direction_, params_.thresh_rad_);
+      }
+      image_generator_->createImages(cloud, scene, hand_set_list, *images);
+      for (int i = 0; i < hand_set_list.size(); i++) {
+        for (int j = 0; j < hand_set_list[i]->getHands().size(); j++) {
+          if (hand_set_list[i]->getIsValid()(j)) {
+            hands->push_back(std::move(hand_set_list[i]->getHands()[j]));
+          }
+        }
+      }
+    }
+
+    // Classify chunk k. This frees the slot for chunk k + <num_slots>.
+#ifdef _OPENMP
+#pragma omp task depend(inout : slot[0], classifier_dep[0]) \
+    firstprivate(images, hands)
+#endif
+    {
+      if (hands->size() > 0) {
+        std::vector<float> scores = classifier_->classifyImages(*images);
+        for (int i = 0; i < hands->size(); i++) {
+          (*hands)[i]->setScore(scores[i]);
+        }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        if (t_first_score == 0.0) {
+          t_first_score = omp_get_wtime();
+        }
+      }
+    }
+  }
+
+  // Collect the candidates in the order of the samples.
+  for (int k = 0; k < num_chunks; k++) {
+    hands_out.insert(hands_out.end(),
+                     std::make_move_iterator(chunk_hands[k].begin()),
+                     std::make_move_iterator(chunk_hands[k].end()));
+  }
+  printf("Scored %zu grasp candidates in %d chunks.\n", hands_out.size(),
+         num_chunks);
+
+  return hands_out;
+}
+
 std::vector<std::unique_ptr<candidate::Hand>> GraspDetector::selectGrasps(
     std::vector<std::unique_ptr<candidate::Hand>> &hands) const {
   printf("Selecting the %d highest scoring grasps ...\n", params_.num_selected_);
@@ -660,19 +1464,15 @@ GraspDetector::pruneGraspCandidates(
     const util::Cloud &cloud,
     const std::vector<std::unique_ptr<candidate::HandSet>> &hand_set_list,
     double min_score) {
-  // 1. Create grasp descriptors (images).
+  // 1. Create grasp descriptors (images) and classify the grasp candidates.
   std::vector<std::unique_ptr<candidate::Hand>> hands;
-  std::vector<std::unique_ptr<cv::Mat>> images;
-  image_generator_->createImages(cloud, hand_set_list, images, hands);
-
-  // 2. Classify the grasp candidates.
-  std::vector<float> scores = classifier_->classifyImages(images);
+  double t_images, t_classify;
+  scoreGraspCandidates(cloud, hand_set_list, hands, t_images, t_classify);
   std::vector<std::unique_ptr<candidate::Hand>> hands_out;
 
-  // 3. Only keep grasps with a score larger than <min_score>.
+  // 2. Only keep grasps with a score larger than <min_score>.
   for (int i = 0; i < hands.size(); i++) {
-    if (scores[i] > min_score) {
-      hands[i]->setScore(scores[i]);
+    if (hands[i]->getScore() > min_score) {
       hands_out.push_back(std::move(hands[i]));
     }
   }
@@ -0,0 +1,192 @@
+#include <gpd/grasp_tracker.h>
+
+#include <cmath>
+
+namespace gpd {
+
+namespace {
+
+const int KEY_BITS = 21;
+const int KEY_OFFSET = 1 << (KEY_BITS - 1);
+const uint64_t KEY_MASK = (1ULL << KEY_BITS) - 1;
+
+}  // namespace
+
+GraspTracker::GraspTracker(double voxel_size, double change_radius)
+    : voxel_size_(voxel_size),
+      change_radius_(std::ceil(change_radius / voxel_size)),
+      num_frames_(0),
+      changed_fraction_(1.0) {}
+
+void GraspTracker::update(const util::Cloud &cloud) {
+  // 1. Find the occupied voxels of the new cloud.
+  const util::PointCloudRGB::Ptr &points = cloud.getCloudProcessed();
+  std::vector<Eigen::Vector3i> occupied;
+  std::unordered_set<uint64_t> occupied_keys;
+  occupied_keys.reserve(points->size());
+
+  for (int i = 0; i < points->size(); i++) {
+    const Eigen::Vector3i voxel =
+        toVoxel(points->points[i].getVector3fMap().cast<double>());
+    if (occupied_keys.insert(toKey(voxel)).second) {
+      occupied.push_back(voxel);
+    }
+  }
+
+  // 2. Find the voxels that changed. If the preprocessing has marked the
+  // changed points (see util::VoxelMap), use their voxels. Otherwise, find
+  // the voxels that appeared, ignoring moves into an adjacent voxel. In both
+  // cases, add the voxels that became free.
+  const Eigen::Array<bool, 1, Eigen::Dynamic> &changed_mask =
+      cloud.getChangedMask();
+  std::vector<Eigen::Vector3i> changed;
+  changed_.clear();
+  if (num_frames_ > 0 && changed_mask.size() == points->size()) {
+    for (int i = 0; i < points->size(); i++) {
+      if (changed_mask(i)) {
+        const Eigen::Vector3i voxel =
+            toVoxel(points->points[i].getVector3fMap().cast<double>());
+        if (changed_.insert(toKey(voxel)).second) {
+          changed.push_back(voxel);
+        }
+      }
+    }
+  } else if (num_frames_ > 0) {
+    for (int i = 0; i < occupied.size(); i++) {
+      if (!containsNear(occupied_keys_, occupied[i], 1)) {
+        changed_.insert(toKey(occupied[i]));
+        changed.push_back(occupied[i]);
+      }
+    }
+  }
+  if (num_frames_ > 0) {
+    for (int i = 0; i < occupied_.size(); i++) {
+      if (!containsNear(occupied_keys, occupied_[i], 1) &&
+          changed_.insert(toKey(occupied_[i])).second) {
+        changed.push_back(occupied_[i]);
+      }
+    }
+  }
+
+  // 3. Find the voxels within <change_radius> of a changed voxel, so that
+  // isChanged() is a single lookup.
+  changed_near_ = dilate(changed, change_radius_);
+
+  changed_fraction_ =
+      (num_frames_ > 0 && occupied.size() > 0)
+          ? std::min(1.0, (double)changed_.size() / (double)occupied.size())
+          : 1.0;
+
+  occupied_ = std::move(occupied);
+  occupied_keys_ = std::move(occupied_keys);
+  num_frames_++;
+
+  printf("Tracker: %zu of %zu voxels changed (%3.1f%%).\n", changed_.size(),
+         occupied_.size(), 100.0 * changed_fraction_);
+}
+
+bool GraspTracker::isChanged(const Eigen::Vector3d &point) const {
+  return !hasPreviousFrame() ||
+         changed_near_.count(toKey(toVoxel(point))) > 0;
+}
+
+Eigen::Matrix3Xd GraspTracker::selectChanged(
+    const Eigen::Matrix3Xd &samples) const {
+  std::vector<int> indices;
+  for (int i = 0; i < samples.cols(); i++) {
+    if (isChanged(samples.col(i))) {
+      indices.push_back(i);
+    }
+  }
+
+  Eigen::Matrix3Xd samples_out(3, indices.size());
+  for (int i = 0; i < indices.size(); i++) {
+    samples_out.col(i) = samples.col(indices[i]);
+  }
+  return samples_out;
+}
+
+void GraspTracker::setGrasps(
+    const std::vector<std::unique_ptr<candidate::Hand>> &hands) {
+  grasps_.clear();
+  for (int i = 0; i < hands.size(); i++) {
+    grasps_.push_back(std::make_unique<candidate::Hand>(*hands[i]));
+  }
+}
+
+std::vector<std::unique_ptr<candidate::Hand>> GraspTracker::copyGrasps()
+    const {
+  std::vector<std::unique_ptr<candidate::Hand>> hands;
+  for (int i = 0; i < grasps_.size(); i++) {
+    hands.push_back(std::make_unique<candidate::Hand>(*grasps_[i]));
+  }
+  return hands;
+}
+
+void GraspTracker::reset() {
+  num_frames_ = 0;
+  changed_fraction_ = 1.0;
+  occupied_.clear();
+  occupied_keys_.clear();
+  changed_.clear();
+  changed_near_.clear();
+  grasps_.clear();
+}
+
+uint64_t GraspTracker::toKey(const Eigen::Vector3i &voxel) {
+  return ((uint64_t)((voxel(0) + KEY_OFFSET) & KEY_MASK) << (2 * KEY_BITS)) |
+         ((uint64_t)((voxel(1) + KEY_OFFSET) & KEY_MASK) << KEY_BITS) |
+         (uint64_t)((voxel(2) + KEY_OFFSET) & KEY_MASK);
+}
+
+Eigen::Vector3i GraspTracker::toVoxel(const Eigen::Vector3d &point) const {
+  return (point / voxel_size_).array().floor().cast<int>();
+}
+
+bool GraspTracker::containsNear(const std::unordered_set<uint64_t> &voxels,
+                                const Eigen::Vector3i &voxel, int radius) {
+  if (voxels.empty()) {
+    return false;
+  }
+
+  for (int x = -radius; x <= radius; x++) {
+    for (int y = -radius; y <= radius; y++) {
+      for (int z = -radius; z <= radius; z++) {
+        if (voxels.count(toKey(voxel + Eigen::Vector3i(x, y, z))) > 0) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+std::unordered_set<uint64_t> GraspTracker::dilate(
+    const std::vector<Eigen::Vector3i> &voxels, int radius) {
+  // The cube is the product of three lines, so the voxels are dilated along
+  // one axis at a time.
+  std::vector<Eigen::Vector3i> dilated = voxels;
+  std::unordered_set<uint64_t> keys;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const std::vector<Eigen::Vector3i> input = std::move(dilated);
+    dilated.clear();
+    keys.clear();
+    keys.reserve(input.size() * (2 * radius + 1));
+
+    for (int i = 0; i < input.size(); i++) {
+      Eigen::Vector3i voxel = input[i];
+      for (int d = -radius; d <= radius; d++) {
+        voxel(axis) = input[i](axis) + d;
+        if (keys.insert(toKey(voxel)).second) {
+          dilated.push_back(voxel);
+        }
+      }
+    }
+  }
+
+  return keys;
+}
+
+}  // namespace gpd
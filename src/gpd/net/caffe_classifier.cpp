@@ -22,53 +22,41 @@ CaffeClassifier::CaffeClassifier(const std::string &model_file,
   input_layer_ = boost::static_pointer_cast<caffe::MemoryDataLayer<float>>(
       net_->layer_by_name("data"));
   input_layer_->set_batch_size(batch_size);
+  batch_size_ = batch_size;
+  labels_.resize(batch_size, 0.0f);
 }
 
-std::vector<float> CaffeClassifier::classifyImages(
-    const std::vector<std::unique_ptr<cv::Mat>> &image_list) {
-  int batch_size = input_layer_->batch_size();
-  int num_iterations = (int)ceil(image_list.size() / (double)batch_size);
+std::vector<float> CaffeClassifier::classifyImages(const ImageTensor &images) {
+  int num_iterations = (int)ceil(images.size() / (double)batch_size_);
   float loss = 0.0;
-  std::cout << "# images: " << image_list.size()
+  std::cout << "# images: " << images.size()
             << ", # iterations: " << num_iterations
-            << ", batch size: " << batch_size << "\n";
+            << ", batch size: " << batch_size_ << "\n";
 
-  std::vector<float> predictions;
+  std::vector<float> predictions(images.size());
 
   // Process the images in batches.
   for (int i = 0; i < num_iterations; i++) {
-    std::vector<cv::Mat> sub_image_list;
+    const int start = i * batch_size_;
+    const int n = std::min(batch_size_, images.size() - start);
 
-    if (i < num_iterations - 1) {
-      for (int j = 0; j < batch_size; j++) {
-        sub_image_list.push_back(*image_list[i * batch_size + j]);
-      }
-    } else {
-      for (int j = 0; j < image_list.size() - i * batch_size; j++) {
-        sub_image_list.push_back(*image_list[i * batch_size + j]);
-      }
-      for (int j = sub_image_list.size(); j < batch_size; j++) {
-        cv::Mat empty_mat(input_layer_->height(), input_layer_->width(),
-                          CV_8UC(input_layer_->channels()), cv::Scalar(0.0));
-        sub_image_list.push_back(empty_mat);
-      }
+    // The last batch can be smaller. Instead of padding it, the network is
+    // reshaped to its real size.
+    if (n != input_layer_->batch_size()) {
+      input_layer_->set_batch_size(n);
     }
 
-    std::vector<int> label_list;
-    label_list.resize(sub_image_list.size());
-
-    for (int j = 0; j < label_list.size(); j++) {
-      label_list[j] = 0;
-    }
+    // The images are already stored in the network's layout (NCHW, FP32),
+    // so the data layer's output refers to the memory of the tensor and no
+    // pixels are copied here.
+    input_layer_->Reset(const_cast<float *>(images.getFloatData(start)),
+                        labels_.data(), n);
 
     // Classify the batch.
-    input_layer_->AddMatVector(sub_image_list, label_list);
-    std::vector<caffe::Blob<float> *> results = net_->Forward(&loss);
-    std::vector<float> out(results[0]->cpu_data(),
-                           results[0]->cpu_data() + results[0]->count());
-
-    for (int l = 0; l < results[0]->count() / results[0]->channels(); l++) {
-      predictions.push_back(out[2 * l + 1] - out[2 * l]);
+    const std::vector<caffe::Blob<float> *> &results = net_->Forward(&loss);
+    const float *out = results[0]->cpu_data();
+    for (int j = 0; j < n; j++) {
+      predictions[start + j] = out[2 * j + 1] - out[2 * j];
     }
   }
 
@@ -46,20 +46,38 @@ namespace net {
 std::shared_ptr<Classifier> Classifier::create(const std::string &model_file,
                                                const std::string &weights_file,
                                                Classifier::Device device,
-                                               int batch_size) {
+                                               int batch_size,
+                                               int num_threads) {
 #if defined(USE_OPENVINO)
   return std::make_shared<OpenVinoClassifier>(model_file, weights_file, device,
-                                              batch_size);
+                                              batch_size, num_threads);
 #elif defined(USE_CAFFE)
   return std::make_shared<CaffeClassifier>(model_file, weights_file, device,
                                            batch_size);
 #elif defined(USE_OPENCV)
-  return std::make_shared<OpenCvClassifier>(model_file, weights_file, device);
+  return std::make_shared<OpenCvClassifier>(model_file, weights_file, device,
+                                            batch_size);
 #else
   return std::make_shared<EigenClassifier>(model_file, weights_file, device,
-                                           batch_size);
+                                           batch_size, num_threads);
 #endif
 }
 
+std::vector<float> Classifier::classifyImages(
+    const std::vector<std::unique_ptr<cv::Mat>> &image_list) {
+  if (image_list.empty()) {
+    return std::vector<float>(0);
+  }
+
+  ImageTensor images(getInputLayout(), getInputPrecision());
+  images.resize(image_list.size(), image_list[0]->rows, image_list[0]->cols,
+                image_list[0]->channels());
+  for (int i = 0; i < image_list.size(); i++) {
+    images.setImage(i, *image_list[i]);
+  }
+
+  return classifyImages(images);
+}
+
 }  // namespace net
 }  // namespace gpd
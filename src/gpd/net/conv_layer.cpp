@@ -3,6 +3,8 @@
 namespace gpd {
 namespace net {
 
+const int ConvLayer::TILE_SIZE = 256;
+
 ConvLayer::ConvLayer(int width, int height, int depth, int num_filters,
                      int spatial_extent, int stride, int padding)
     : w1(width),
@@ -21,38 +23,205 @@ ConvLayer::ConvLayer(int width, int height, int depth, int num_filters,
   // matrix W_row has size: num_filters x patial_extent*spatial_extent*d1
   W_row_r = num_filters;
   W_row_c = spatial_extent * spatial_extent * d1;
+
+  fuse(false, 1, 1);
 }
 
 Eigen::MatrixXf ConvLayer::forward(const std::vector<float> &x) const {
-  // Convert input image to matrix where each column is an image patch.
-  std::vector<float> x_col_vec;
-  x_col_vec.resize(X_col_r * X_col_c);
-  imageToColumns(&x[0], d1, h1, w1, d2, f, f, s, s, &x_col_vec[0]);
-  Eigen::MatrixXf X_col =
-      ConvLayer::RowMajorMatrixMap(x_col_vec.data(), X_col_r, X_col_c);
-
-  // Convert weights vector to matrix where each row is a kernel.
-  Eigen::MatrixXf W_row =
-      ConvLayer::RowMajorMatrixMap(weights_.data(), W_row_r, W_row_c);
-
-  // Convert biases array to Eigen vector.
-  Eigen::VectorXf b =
-      Eigen::Map<const Eigen::VectorXf>(biases_.data(), biases_.size());
-
-  // Calculate the convolution by calculating the dot product of W_row and
-  // X_col.
-  Eigen::MatrixXf H = forward(W_row, b, X_col);
+  std::vector<float> buffer;
+  RowMajorMatrix H(W_row_r, getOutputSize());
+  forward(x.data(), 1, x.size(), h1 * w1, buffer, H.data());
   return H;
 }
 
-Eigen::MatrixXf ConvLayer::forward(const Eigen::MatrixXf &W,
-                                   const Eigen::VectorXf &b,
-                                   const Eigen::MatrixXf &X) const {
-  Eigen::MatrixXf B = b.replicate(1, X.cols());
+void ConvLayer::fuse(bool relu, int pool_size, int pool_stride) {
+  relu_ = relu;
+  pool_size_ = pool_size;
+  pool_stride_ = pool_stride;
+  w3 = (w2 - pool_size) / pool_stride + 1;
+  h3 = (h2 - pool_size) / pool_stride + 1;
 
-  // Calculate the forward pass.
-  Eigen::MatrixXf H = W * X + B;  // np.dot(W_row, X_col)
-  return H;
+  // Choose the number of output rows per tile so that the convolution of a
+  // tile has at most TILE_SIZE outputs (but at least one output row).
+  tile_rows_ = (TILE_SIZE / w2 - pool_size) / pool_stride + 1;
+  tile_rows_ = std::max(1, std::min(tile_rows_, h3));
+}
+
+void ConvLayer::forward(const float *x, int num_images, int image_stride,
+                        int channel_stride, std::vector<float> &buffer,
+                        float *y) const {
+  // The image patches of a tile are followed by the convolution of the tile.
+  const int tile_size = getTileSize();
+  buffer.resize((size_t)getBufferSize());
+  float *columns = buffer.data();
+  float *tile = columns + (size_t)X_col_r * tile_size;
+
+  // The weights vector is a matrix where each row is a kernel.
+  RowMajorMatrixMap W_row(weights_, W_row_r, W_row_c);
+
+  for (int i = 0; i < num_images; i++) {
+    const float *image = x + (size_t)i * image_stride;
+
+    for (int row = 0; row < h3; row += tile_rows_) {
+      // Convert the image rows of the tile to a matrix where each column is an
+      // image patch.
+      const int rows = std::min(tile_rows_, h3 - row);
+      const int conv_row = row * pool_stride_;
+      const int conv_rows = getConvRows(rows);
+      const int num_cols = conv_rows * w2;
+      imageToColumns(image + conv_row * s * w1, d1, (conv_rows - 1) * s + f,
+                     w1, channel_stride, f, f, s, s, num_cols, columns);
+
+      // Calculate the convolution of the tile by calculating the dot product
+      // of W_row and X_col.
+      RowMajorMatrixMap X_col(columns, X_col_r, num_cols);
+      Eigen::Map<RowMajorMatrix> H(tile, W_row_r, num_cols);
+      H.noalias() = W_row * X_col;  // np.dot(W_row, X_col)
+
+      poolTile(tile, num_cols, row, rows, i, num_images, y);
+    }
+  }
+}
+
+void ConvLayer::forwardQuantized(const uint8_t *x, int num_images,
+                                 int image_stride, int channel_stride,
+                                 std::vector<int16_t> &patches,
+                                 std::vector<float> &buffer, float *y) const {
+  // The widened image is followed by the patches of a tile.
+  patches.resize((size_t)getQuantizedBufferSize());
+  int16_t *image = patches.data();
+  int16_t *tile_patches = image + d1 * h1 * w1;
+  buffer.resize((size_t)W_row_r * getTileSize());
+
+  for (int i = 0; i < num_images; i++) {
+    quantizeImage(x + (size_t)i * image_stride, channel_stride, 1.0f, image);
+
+    for (int row = 0; row < h3; row += tile_rows_) {
+      const int rows = std::min(tile_rows_, h3 - row);
+      const int conv_rows = getConvRows(rows);
+      imageToPatches(image, row * pool_stride_, conv_rows, tile_patches);
+      multiplyPatches(tile_patches, conv_rows * w2, buffer.data());
+      poolTile(buffer.data(), conv_rows * w2, row, rows, i, num_images, y);
+    }
+  }
+}
+
+void ConvLayer::forwardQuantized(const float *x, int num_images,
+                                 int image_stride, int channel_stride,
+                                 std::vector<int16_t> &patches,
+                                 std::vector<float> &buffer, float *y) const {
+  // The quantized image is followed by the patches of a tile.
+  patches.resize((size_t)getQuantizedBufferSize());
+  int16_t *image = patches.data();
+  int16_t *tile_patches = image + d1 * h1 * w1;
+  buffer.resize((size_t)W_row_r * getTileSize());
+
+  for (int i = 0; i < num_images; i++) {
+    quantizeImage(x + (size_t)i * image_stride, channel_stride,
+                  1.0f / input_scale_, image);
+
+    for (int row = 0; row < h3; row += tile_rows_) {
+      const int rows = std::min(tile_rows_, h3 - row);
+      const int conv_rows = getConvRows(rows);
+      imageToPatches(image, row * pool_stride_, conv_rows, tile_patches);
+      multiplyPatches(tile_patches, conv_rows * w2, buffer.data());
+      poolTile(buffer.data(), conv_rows * w2, row, rows, i, num_images, y);
+    }
+  }
+}
+
+void ConvLayer::poolTile(const float *tile, int tile_size, int row, int rows,
+                         int image, int num_images, float *y) const {
+  const int size_out = w3 * h3;
+
+  for (int i = 0; i < W_row_r; i++) {
+    const float *src = tile + (size_t)i * tile_size;
+    float *dst = y + ((size_t)i * num_images + image) * size_out + row * w3;
+
+    // The maximum is taken before adding the bias and applying the ReLU,
+    // because both are monotonic and the same for the whole channel.
+    for (int r = 0; r < rows; r++) {
+      for (int c = 0; c < w3; c++) {
+        const float *block = src + r * pool_stride_ * w2 + c * pool_stride_;
+        float max = block[0];
+        for (int kr = 0; kr < pool_size_; kr++) {
+          for (int kc = 0; kc < pool_size_; kc++) {
+            max = std::max(max, block[kr * w2 + kc]);
+          }
+        }
+        max += biases_[i];
+        dst[r * w3 + c] = (relu_ && max < 0.0f) ? 0.0f : max;
+      }
+    }
+  }
+}
+
+void ConvLayer::quantize(float input_scale) {
+  // Each row of W_row is a kernel.
+  quantizeRows(weights_, W_row_r, W_row_c, W_row_c, 1, input_scale);
+}
+
+template <typename T>
+void ConvLayer::quantizeImage(const T *data_im, int channel_stride,
+                              float inv_scale, int16_t *image) const {
+  const int size = h1 * w1;
+
+  for (int channel = 0; channel < d1; channel++) {
+    const T *src = data_im + (size_t)channel * channel_stride;
+    for (int i = 0; i < size; i++) {
+      image[i] = quantizeValue(src[i], inv_scale);
+    }
+    image += size;
+  }
+}
+
+void ConvLayer::imageToPatches(const int16_t *image, int row, int rows,
+                               int16_t *patches) const {
+  const int channel_size = h1 * w1;
+
+  for (int r = row; r < row + rows; r++) {
+    for (int col = 0; col < w2; col++) {
+      const int16_t *block = image + r * s * w1 + col * s;
+      for (int channel = 0; channel < d1; channel++) {
+        const int16_t *src = block + channel * channel_size;
+        for (int kernel_row = 0; kernel_row < f; kernel_row++) {
+          patches = std::copy(src, src + f, patches);
+          src += w1;
+        }
+      }
+    }
+  }
+}
+
+void ConvLayer::multiplyPatches(const int16_t *patches, int num_patches,
+                                float *tile) const {
+  const int patch_size = X_col_r;
+  const int16_t *weights = quantized_weights_.data();
+
+  // Scale of the integer dot product of each filter.
+  std::vector<float> scales(W_row_r);
+  for (int i = 0; i < W_row_r; i++) {
+    scales[i] = weight_scales_[i] * input_scale_;
+  }
+
+  // Each patch is multiplied with four filters at once.
+  const int num_blocks = W_row_r / 4 * 4;
+  int32_t dots[4];
+
+  for (int j = 0; j < num_patches; j++) {
+    const int16_t *patch = patches + (size_t)j * patch_size;
+    for (int i = 0; i < num_blocks; i += 4) {
+      dotProducts4(patch, weights + (size_t)i * patch_size, patch_size, dots);
+      for (int k = 0; k < 4; k++) {
+        tile[(size_t)(i + k) * num_patches + j] = dots[k] * scales[i + k];
+      }
+    }
+    for (int i = num_blocks; i < W_row_r; i++) {
+      const int32_t dot =
+          dotProduct(patch, weights + (size_t)i * patch_size, patch_size);
+      tile[(size_t)i * num_patches + j] = dot * scales[i];
+    }
+  }
 }
 
 bool ConvLayer::is_a_ge_zero_and_a_lt_b(int a, int b) const {
@@ -61,14 +230,15 @@ bool ConvLayer::is_a_ge_zero_and_a_lt_b(int a, int b) const {
 
 void ConvLayer::imageToColumns(const float *data_im, const int channels,
                                const int height, const int width,
-                               const int num_kernels, const int kernel_h,
+                               const int channel_stride, const int kernel_h,
                                const int kernel_w, const int stride_h,
-                               const int stride_w, float *data_col) const {
+                               const int stride_w, const int col_stride,
+                               float *data_col) const {
   const int output_h = (height - kernel_h) / stride_h + 1;
   const int output_w = (width - kernel_w) / stride_w + 1;
-  const int channel_size = height * width;
+  const int row_gap = col_stride - output_h * output_w;
 
-  for (int channel = channels; channel--; data_im += channel_size) {
+  for (int channel = channels; channel--; data_im += channel_stride) {
     for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
       for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
         int input_row = kernel_row;
@@ -92,6 +262,7 @@ void ConvLayer::imageToColumns(const float *data_im, const int channels,
           }
           input_row += stride_h;
         }
+        data_col += row_gap;
       }
     }
   }
@@ -4,8 +4,8 @@ namespace gpd {
 namespace net {
 
 Eigen::MatrixXf DenseLayer::forward(const std::vector<float> &x) const {
-  Eigen::Map<const Eigen::MatrixXf> W(weights_.data(), num_units_, x.size());
-  Eigen::Map<const Eigen::VectorXf> b(biases_.data(), biases_.size());
+  Eigen::Map<const Eigen::MatrixXf> W(weights_, num_units_, x.size());
+  Eigen::Map<const Eigen::VectorXf> b(biases_, num_biases_);
   Eigen::Map<const Eigen::VectorXf> X(x.data(), x.size());
 
   // Calculate the forward pass.
@@ -14,5 +14,62 @@ Eigen::MatrixXf DenseLayer::forward(const std::vector<float> &x) const {
   return H;
 }
 
+void DenseLayer::forward(const Eigen::Ref<const Eigen::MatrixXf> &X,
+                         Eigen::Ref<Eigen::MatrixXf> H) const {
+  Eigen::Map<const Eigen::MatrixXf> W(weights_, num_units_, X.rows());
+  Eigen::Map<const Eigen::VectorXf> b(biases_, num_biases_);
+
+  // Calculate the forward pass for all images with one matrix product.
+  H.noalias() = W * X;
+  H.colwise() += b;
+}
+
+void DenseLayer::forwardQuantized(const Eigen::Ref<const Eigen::MatrixXf> &X,
+                                  std::vector<int16_t> &inputs,
+                                  Eigen::Ref<Eigen::MatrixXf> H) const {
+  const int num_inputs = X.rows();
+  const int num_images = X.cols();
+  inputs.resize((size_t)num_inputs * num_images);
+
+  const float inv_scale = 1.0f / input_scale_;
+  for (int n = 0; n < num_images; n++) {
+    int16_t *dst = &inputs[(size_t)n * num_inputs];
+    for (int i = 0; i < num_inputs; i++) {
+      dst[i] = quantizeValue(X(i, n), inv_scale);
+    }
+  }
+
+  // Four rows of weights are multiplied with the input of each image while
+  // they are in the cache.
+  const int num_blocks = num_units_ / 4 * 4;
+  int32_t dots[4];
+
+  for (int u = 0; u < num_blocks; u += 4) {
+    const int16_t *w = &quantized_weights_[(size_t)u * num_inputs];
+    for (int n = 0; n < num_images; n++) {
+      dotProducts4(&inputs[(size_t)n * num_inputs], w, num_inputs, dots);
+      for (int k = 0; k < 4; k++) {
+        H(u + k, n) = dots[k] * weight_scales_[u + k] * input_scale_ +
+                      biases_[u + k];
+      }
+    }
+  }
+  for (int u = num_blocks; u < num_units_; u++) {
+    const int16_t *w = &quantized_weights_[(size_t)u * num_inputs];
+    for (int n = 0; n < num_images; n++) {
+      const int32_t dot =
+          dotProduct(&inputs[(size_t)n * num_inputs], w, num_inputs);
+      H(u, n) = dot * weight_scales_[u] * input_scale_ + biases_[u];
+    }
+  }
+}
+
+void DenseLayer::quantize(float input_scale) {
+  // The weights vector is a column-major (num_units) x (num_inputs) matrix.
+  const int num_inputs = num_weights_ / num_units_;
+  quantizeRows(weights_, num_units_, num_inputs, 1, num_units_,
+               input_scale);
+}
+
 }  // namespace net
 }  // namespace gpd
@@ -3,188 +3,687 @@
 namespace gpd {
 namespace net {
 
+const int EigenClassifier::DEFAULT_BATCH_SIZE = 8;
+const std::string EigenClassifier::DEFAULT_NETWORK_FILE = "network.cfg";
+
 EigenClassifier::EigenClassifier(const std::string &model_file,
                                  const std::string &weights_file,
-                                 Classifier::Device device, int batch_size)
-    : num_threads_(4) {
+                                 Classifier::Device device, int batch_size,
+                                 int num_threads)
+    : batch_size_(batch_size > 0 ? batch_size : DEFAULT_BATCH_SIZE),
+      num_threads_(std::max(1, num_threads)) {
   double start = omp_get_wtime();
+  is_quantized_ = false;
 
-  const int image_size = 60;
-  const int num_channels = 15;
-  const int num_filters = 20;
-  const int spatial_extent = 5;
-  const int stride = 1;
-  const int padding = 0;
-
-  // Construct the network.
-  conv1_ =
-      std::make_unique<ConvLayer>(image_size, image_size, num_channels,
-                                  num_filters, spatial_extent, stride, padding);
-  conv2_ = std::make_unique<ConvLayer>(28, 28, 20, 50, 5, 1, 0);
-  dense1_ = std::make_unique<DenseLayer>(500);
-  dense2_ = std::make_unique<DenseLayer>(2);
-
-  // Set weights and biases.
+  // Construct the network from its description.
   const std::string &params_dir = weights_file;
-  std::vector<float> w_vec =
-      readBinaryFileIntoVector(params_dir + "conv1_weights.bin");
-  std::vector<float> b_vec =
-      readBinaryFileIntoVector(params_dir + "conv1_biases.bin");
-  conv1_->setWeightsAndBiases(w_vec, b_vec);
+  const std::string network_file =
+      model_file.empty() ? params_dir + DEFAULT_NETWORK_FILE : model_file;
+  is_valid_ = buildNetwork(network_file, params_dir);
+
+  // Allocate the scratch memory of each thread once.
+  workspaces_.resize(num_threads_);
+  for (int i = 0; i < num_threads_; i++) {
+    initWorkspace(workspaces_[i]);
+  }
 
-  w_vec = readBinaryFileIntoVector(params_dir + "conv2_weights.bin");
-  b_vec = readBinaryFileIntoVector(params_dir + "conv2_biases.bin");
-  conv2_->setWeightsAndBiases(w_vec, b_vec);
+  std::cout << "NET SETUP runtime: " << omp_get_wtime() - start << std::endl;
+}
 
-  std::vector<float> w_dense1 =
-      readBinaryFileIntoVector(params_dir + "ip1_weights.bin");
-  std::vector<float> b_dense1 =
-      readBinaryFileIntoVector(params_dir + "ip1_biases.bin");
-  dense1_->setWeightsAndBiases(w_dense1, b_dense1);
+bool EigenClassifier::buildNetwork(const std::string &filename,
+                                   const std::string &params_dir) {
+  std::vector<std::string> names;
+  std::vector<std::string> descriptions;
+  std::string precision = "fp32";
+  std::string bundle_file;
+
+  util::ConfigFile config_file(filename);
+  if (config_file.ExtractKeys()) {
+    image_size_ = config_file.getValueOfKey<int>("image_size", 60);
+    num_channels_ = config_file.getValueOfKey<int>("image_num_channels", 15);
+    precision = config_file.getValueOfKeyAsString("precision", "fp32");
+    bundle_file = config_file.getValueOfKeyAsString("weights_bundle", "");
+    std::stringstream layers(config_file.getValueOfKeyAsString("layers", ""));
+    std::string name;
+    while (layers >> name) {
+      names.push_back(name);
+      descriptions.push_back(config_file.getValueOfKeyAsString(name, ""));
+    }
+  } else {
+    std::cout << "WARNING: Using default LeNet topology for 15 channels.\n";
+    image_size_ = 60;
+    num_channels_ = 15;
+    names = {"conv1", "pool1", "conv2", "pool2", "ip1", "relu1", "ip2"};
+    descriptions = {"conv 20 5 1", "pool 2 2", "conv 50 5 1", "pool 2 2",
+                    "dense 500",   "relu",     "dense 2"};
+  }
 
-  std::vector<float> w_dense2 =
-      readBinaryFileIntoVector(params_dir + "ip2_weights.bin");
-  std::vector<float> b_dense2 =
-      readBinaryFileIntoVector(params_dir + "ip2_biases.bin");
+  // Map the weight bundle instead of reading the .bin files.
+  if (!bundle_file.empty()) {
+    bundle_ = WeightBundle::open(params_dir + bundle_file);
+    if (!bundle_) {
+      return false;
+    }
+  }
 
-  dense2_->setWeightsAndBiases(w_dense2, b_dense2);
+  for (int i = 0; i < names.size(); i++) {
+    if (!addLayer(names[i], descriptions[i], params_dir)) {
+      return false;
+    }
+  }
 
-  x_conv2_.resize(20 * 28 * 28);
-  x_dense1_.resize(50 * 12 * 12);
-  x_dense2_.resize(500);
+  // The output layer needs to be a dense layer with two units.
+  if (nodes_.empty() || nodes_.back().type != LayerType::eDense ||
+      nodes_.back().channels != 2) {
+    std::cout << "ERROR: The last layer needs to be a dense layer with two "
+                 "units!\n";
+    return false;
+  }
 
-  std::cout << "NET SETUP runtime: " << omp_get_wtime() - start << std::endl;
+  fuseLayers();
+
+  // Use the INT8 parameters that have been produced offline.
+  if (precision == "int8") {
+    bool has_weights = true;
+    for (int i = 0; i < nodes_.size() && has_weights; i++) {
+      if (nodes_[i].index >= 0) {
+        has_weights = readQuantizedWeights(nodes_[i], params_dir);
+      }
+    }
+    if (!has_weights || !setQuantized(true)) {
+      std::cout << "WARNING: Using FP32 weights instead of INT8 weights.\n";
+    }
+  }
+
+  std::cout << "Network: " << image_size_ << "x" << image_size_ << "x"
+            << num_channels_;
+  int num_fused = 0;  // fused layers are joined by a '+'
+  for (int i = 0; i < nodes_.size(); i++) {
+    std::cout << (num_fused > 0 ? " + " : " -> ") << nodes_[i].name << " ("
+              << nodes_[i].width << "x" << nodes_[i].width << "x"
+              << nodes_[i].channels << ")";
+    num_fused = (num_fused > 0) ? num_fused - 1 : nodes_[i].num_fused;
+  }
+  std::cout << (is_quantized_ ? " [INT8]" : " [FP32]") << "\n";
+
+  return true;
 }
 
-std::vector<float> EigenClassifier::classifyImages(
-    const std::vector<std::unique_ptr<cv::Mat>> &image_list) {
+bool EigenClassifier::addLayer(const std::string &name,
+                               const std::string &description,
+                               const std::string &params_dir) {
+  // Shape of the input of this layer.
+  const bool is_first = nodes_.empty();
+  const int channels = is_first ? num_channels_ : nodes_.back().channels;
+  const int width = is_first ? image_size_ : nodes_.back().width;
+  const bool is_spatial = is_first || !nodes_.back().is_flat;
+
+  LayerNode node;
+  node.name = name;
+  node.index = -1;
+  node.filter_size = 0;
+  node.stride = 0;
+  node.channels = channels;
+  node.width = width;
+  node.is_flat = !is_spatial;
+  node.num_fused = 0;
+
+  std::stringstream ss(description);
+  std::string type;
+  ss >> type;
+
+  if (type == "conv") {
+    int num_filters = 0, spatial_extent = 0, stride = 1;
+    ss >> num_filters >> spatial_extent >> stride;
+    if (!is_spatial || num_filters <= 0 || spatial_extent <= 0 ||
+        stride <= 0 || spatial_extent > width) {
+      std::cout << "ERROR: Invalid conv layer: " << name << "!\n";
+      return false;
+    }
+    std::unique_ptr<ConvLayer> layer = std::make_unique<ConvLayer>(
+        width, width, channels, num_filters, spatial_extent, stride, 0);
+    node.type = LayerType::eConv;
+    node.shape = {num_filters, channels, spatial_extent, spatial_extent};
+    if (!readWeights(node, params_dir, *layer)) {
+      return false;
+    }
+    node.index = conv_layers_.size();
+    node.channels = num_filters;
+    node.width = layer->getOutputWidth();
+    conv_layers_.push_back(std::move(layer));
+  } else if (type == "pool") {
+    ss >> node.filter_size >> node.stride;
+    if (!is_spatial || node.filter_size <= 0 || node.stride <= 0 ||
+        node.filter_size > width) {
+      std::cout << "ERROR: Invalid pool layer: " << name << "!\n";
+      return false;
+    }
+    node.type = LayerType::ePool;
+    node.width = (width - node.filter_size) / node.stride + 1;
+  } else if (type == "dense") {
+    int num_units = 0;
+    ss >> num_units;
+    if (num_units <= 0) {
+      std::cout << "ERROR: Invalid dense layer: " << name << "!\n";
+      return false;
+    }
+    std::unique_ptr<DenseLayer> layer = std::make_unique<DenseLayer>(num_units);
+    node.type = LayerType::eDense;
+    node.shape = {channels * width * width, num_units};
+    if (!readWeights(node, params_dir, *layer)) {
+      return false;
+    }
+    node.index = dense_layers_.size();
+    node.channels = num_units;
+    node.width = 1;
+    node.is_flat = true;
+    dense_layers_.push_back(std::move(layer));
+  } else if (type == "relu") {
+    node.type = LayerType::eRelu;
+  } else {
+    std::cout << "ERROR: Unknown type of layer " << name << ": " << type
+              << "!\n";
+    return false;
+  }
+
+  nodes_.push_back(node);
+  return true;
+}
+
+void EigenClassifier::fuseLayers() {
+  for (int i = 0; i < nodes_.size(); i++) {
+    LayerNode &node = nodes_[i];
+    if (node.type != LayerType::eConv) {
+      continue;
+    }
+
+    bool relu = false;
+    int pool_size = 1;
+    int pool_stride = 1;
+    for (int j = i + 1; j < nodes_.size(); j++) {
+      const LayerNode &next = nodes_[j];
+      if (next.type == LayerType::eRelu && !next.is_flat) {
+        relu = true;
+      } else if (next.type == LayerType::ePool && pool_size == 1) {
+        pool_size = next.filter_size;
+        pool_stride = next.stride;
+      } else {
+        break;
+      }
+      node.num_fused++;
+    }
+
+    conv_layers_[node.index]->fuse(relu, pool_size, pool_stride);
+    i += node.num_fused;
+  }
+}
+
+std::vector<float> EigenClassifier::classifyImages(const ImageTensor &images) {
   std::vector<float> predictions;
-  predictions.resize(image_list.size());
+  predictions.resize(images.size());
+
+  if (!is_valid_) {
+    std::cout << "ERROR: The network is not valid!\n";
+    return predictions;
+  }
+  if (images.getChannels() != num_channels_ ||
+      images.getRows() != image_size_ || images.getCols() != image_size_) {
+    std::cout << "ERROR: The images (" << images.getRows() << "x"
+              << images.getCols() << "x" << images.getChannels()
+              << ") do not match the network input (" << image_size_ << "x"
+              << image_size_ << "x" << num_channels_ << ")!\n";
+    return predictions;
+  }
+  if (images.getPrecision() != getInputPrecision()) {
+    std::cout << "ERROR: The precision of the images does not match the "
+                 "network input!\n";
+    return predictions;
+  }
+
+#ifdef _OPENMP
+  // Called from inside a parallel region (e.g., from a task of the pipelined
+  // detection): the images are classified on the calling thread, with a
+  // workspace of this call so that concurrent calls do not share memory.
+  if (omp_in_parallel()) {
+    Workspace workspace;
+    initWorkspace(workspace);
+    for (int start = 0; start < images.size(); start += batch_size_) {
+      const int n = std::min(batch_size_, images.size() - start);
+      forward(images, start, n, workspace, &predictions[start]);
+    }
+    return predictions;
+  }
+#endif
+
+  // Split the images into batches so that each thread gets at least one batch
+  // if possible.
+  const int batch_size = std::max(
+      1, std::min(batch_size_,
+                  (images.size() + num_threads_ - 1) / num_threads_));
+  const int num_batches = (images.size() + batch_size - 1) / batch_size;
 
 #ifdef _OPENMP  // parallelization using OpenMP
 #pragma omp parallel for num_threads(num_threads_)
 #endif
-  for (int i = 0; i < image_list.size(); i++) {
-    if (image_list[i]->isContinuous()) {
-      std::vector<float> x = imageToArray(*image_list[i]);
-
-      std::vector<float> predictions_i = forward(x);
-      //      std::cout << i << " -- positive score: " << yi[1] << ", negative
-      //      score: " << yi[0] << "\n";
-      predictions[i] = predictions_i[1] - predictions_i[0];
-    }
+  for (int i = 0; i < num_batches; i++) {
+#ifdef _OPENMP
+    Workspace &workspace = workspaces_[omp_get_thread_num()];
+#else
+    Workspace &workspace = workspaces_[0];
+#endif
+    const int start = i * batch_size;
+    const int n = std::min(batch_size, images.size() - start);
+    forward(images, start, n, workspace, &predictions[start]);
   }
 
   return predictions;
 }
 
-std::vector<float> EigenClassifier::forward(const std::vector<float> &x) {
-  //  double start = omp_get_wtime();
+bool EigenClassifier::quantize(const ImageTensor &images) {
+  if (!is_valid_ || images.getPrecision() != ImageTensor::Precision::eFP32 ||
+      images.getChannels() != num_channels_ ||
+      images.getRows() != image_size_ || images.getCols() != image_size_) {
+    std::cout << "ERROR: Cannot quantize the network with these images!\n";
+    return false;
+  }
 
-  // 1st conv layer
-  Eigen::MatrixXf H1 = conv1_->forward(x);
+  // Find the range of the input of each layer with the FP32 network.
+  const bool was_quantized = is_quantized_;
+  is_quantized_ = false;
+  std::vector<float> input_ranges(nodes_.size(), 0.0f);
+  std::vector<float> scores(batch_size_);
+  for (int start = 0; start < images.size(); start += batch_size_) {
+    const int n = std::min(batch_size_, images.size() - start);
+    forward(images, start, n, workspaces_[0], scores.data(), &input_ranges);
+  }
 
-  // 1st max pool layer
-  Eigen::MatrixXf P1 = poolForward(H1, 2, 2);
+  // The first layer takes the uchar images as they are.
+  for (int i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].index >= 0) {
+      const float range = (i == 0) ? 127.0f : input_ranges[i];
+      getLayer(nodes_[i]).quantize(range > 0.0f ? range / 127.0f : 1.0f);
+    }
+  }
 
-  // 2nd conv layer
-  double conv2_start = omp_get_wtime();
-  Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> P1r(P1);
-  //  std::vector<float> x_conv2;
-  x_conv2_.assign(P1r.data(), P1r.data() + P1r.size());
-  Eigen::MatrixXf H2 = conv2_->forward(x_conv2_);
-  //  std::cout << "CONV2 runtime: " << omp_get_wtime() - conv2_start <<
-  //  std::endl;
+  if (!setQuantized(true)) {
+    is_quantized_ = was_quantized;
+    return false;
+  }
 
-  // 2nd max pool layer
-  Eigen::MatrixXf P2 = poolForward(H2, 2, 2);
+  return true;
+}
 
-  // Flatten the output of the 2nd max pool layer.
-  Eigen::Map<Eigen::VectorXf> f1(P2.data(), P2.size());
+bool EigenClassifier::setQuantized(bool is_quantized) {
+  if (!is_quantized) {
+    is_quantized_ = false;
+    return true;
+  }
 
-  // 1st inner product layer
-  //  double dense1_start = omp_get_wtime();
-  Eigen::VectorXf::Map(&x_dense1_[0], f1.size()) = f1;
-  Eigen::MatrixXf H3 = dense1_->forward(x_dense1_);
-  //  std::cout << "DENSE1 runtime: " << omp_get_wtime() - dense1_start <<
-  //  std::endl;
+  // The uchar images can only be passed to a conv layer.
+  if (nodes_.empty() || nodes_[0].type != LayerType::eConv) {
+    std::cout << "ERROR: The INT8 network needs to start with a conv layer!\n";
+    return false;
+  }
 
-  // RELU layer
-  H3 = H3.cwiseMax(0);
+  for (int i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].index >= 0 && !getLayer(nodes_[i]).isQuantized()) {
+      std::cout << "ERROR: Layer " << nodes_[i].name
+                << " has no INT8 weights!\n";
+      return false;
+    }
+  }
+
+  is_quantized_ = true;
+  return true;
+}
 
-  // 2nd inner product layer (output layer)
-  Eigen::Map<Eigen::VectorXf> f2(H3.data(), H3.size());
-  Eigen::VectorXf::Map(&x_dense2_[0], f2.size()) = f2;
-  Eigen::MatrixXf Y = dense2_->forward(x_dense2_);
+bool EigenClassifier::saveQuantizedWeights(
+    const std::string &params_dir) const {
+  for (int i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].index < 0) {
+      continue;
+    }
 
-  //  std::cout << "FORWARD PASS runtime: " << omp_get_wtime() - start <<
-  //  std::endl;
-  //  int n = Eigen::nbThreads();
-  //  std::cout << "# CPU threads: " << n << std::endl;
+    const Layer &layer = getLayer(nodes_[i]);
+    if (!layer.isQuantized()) {
+      std::cout << "ERROR: Layer " << nodes_[i].name
+                << " has no INT8 weights!\n";
+      return false;
+    }
 
-  std::vector<float> y;
-  y.assign(Y.data(), Y.data() + Y.size());
-  return y;
+    // The input scale is stored in front of the scales of the weights.
+    std::vector<float> scales;
+    scales.push_back(layer.getInputScale());
+    scales.insert(scales.end(), layer.getWeightScales().begin(),
+                  layer.getWeightScales().end());
+
+    const std::string prefix = params_dir + nodes_[i].name;
+    if (!writeVectorIntoBinaryFile(prefix + "_weights_int8.bin",
+                                   layer.getQuantizedWeights()) ||
+        !writeVectorIntoBinaryFile(prefix + "_scales.bin", scales)) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
-std::vector<float> EigenClassifier::imageToArray(const cv::Mat &img) const {
-  std::vector<float> x;
-  x.resize(img.channels() * img.rows * img.cols);
-  int k = 0;
+bool EigenClassifier::saveWeightBundle(const std::string &filename) const {
+  if (!is_valid_) {
+    std::cout << "ERROR: The network is not valid!\n";
+    return false;
+  }
 
-  for (int channel = 0; channel < img.channels(); channel++) {
-    for (int row = 0; row < img.rows; row++) {
-      const uchar *ptr = img.ptr(row);
+  // The INT8 parameters are copied so that they can be written as is.
+  std::vector<WeightBundle::Tensor> tensors;
+  std::vector<std::vector<int8_t>> quantized_weights(nodes_.size());
+  std::vector<std::vector<float>> scales(nodes_.size());
 
-      for (int col = 0; col < img.cols; col++) {
-        const uchar *uc_pixel = ptr;
-        x[k] = uc_pixel[channel];
-        ptr += 15;
-        k++;
-      }
+  for (int i = 0; i < nodes_.size(); i++) {
+    const LayerNode &node = nodes_[i];
+    if (node.index < 0) {
+      continue;
+    }
+
+    const Layer &layer = getLayer(node);
+    tensors.push_back({node.name + "_weights", WeightBundle::DataType::eFP32,
+                       node.shape, layer.getWeights(),
+                       layer.getNumWeights() * sizeof(float)});
+    tensors.push_back({node.name + "_biases", WeightBundle::DataType::eFP32,
+                       {layer.getNumBiases()}, layer.getBiases(),
+                       layer.getNumBiases() * sizeof(float)});
+
+    if (layer.isQuantized()) {
+      // The input scale is stored in front of the scales of the weights.
+      quantized_weights[i] = layer.getQuantizedWeights();
+      scales[i].push_back(layer.getInputScale());
+      scales[i].insert(scales[i].end(), layer.getWeightScales().begin(),
+                       layer.getWeightScales().end());
+      const int rows = node.shape[0];
+      const int cols = quantized_weights[i].size() / rows;
+      tensors.push_back({node.name + "_weights_int8",
+                         WeightBundle::DataType::eINT8,
+                         {rows, cols},
+                         quantized_weights[i].data(),
+                         quantized_weights[i].size()});
+      tensors.push_back({node.name + "_scales", WeightBundle::DataType::eFP32,
+                         {(int)scales[i].size()}, scales[i].data(),
+                         scales[i].size() * sizeof(float)});
     }
   }
 
-  return x;
+  return WeightBundle::write(filename, tensors);
 }
 
-Eigen::MatrixXf EigenClassifier::poolForward(const Eigen::MatrixXf &X,
-                                             int filter_size,
-                                             int stride) const {
-  int depth = X.rows();
-  int width_in = sqrt(X.cols());
-  int width_out = (width_in - filter_size) / stride + 1;
+bool EigenClassifier::readWeights(const LayerNode &node,
+                                  const std::string &params_dir,
+                                  Layer &layer) {
+  const int num_biases = (node.type == LayerType::eConv) ? node.shape[0]
+                                                           : node.shape[1];
+
+  if (bundle_) {
+    const WeightBundle::Tensor *weights = bundle_->find(node.name + "_weights");
+    const WeightBundle::Tensor *biases = bundle_->find(node.name + "_biases");
+    if (!weights || !biases || weights->shape != node.shape ||
+        weights->dtype != WeightBundle::DataType::eFP32 ||
+        biases->size() != num_biases ||
+        biases->dtype != WeightBundle::DataType::eFP32) {
+      std::cout << "ERROR: Weights of layer " << node.name
+                << " do not match its shape!\n";
+      return false;
+    }
+    layer.setWeightsAndBiases(weights->floats(), weights->size(),
+                              biases->floats(), biases->size());
+    return true;
+  }
 
-  int block_size = filter_size * filter_size;
+  size_t num_weights = 1;
+  for (int i = 0; i < node.shape.size(); i++) {
+    num_weights *= node.shape[i];
+  }
+
+  std::vector<float> w_vec =
+      readBinaryFileIntoVector(params_dir + node.name + "_weights.bin");
+  std::vector<float> b_vec =
+      readBinaryFileIntoVector(params_dir + node.name + "_biases.bin");
+  if (w_vec.size() != num_weights || b_vec.size() != num_biases) {
+    std::cout << "ERROR: Weights of layer " << node.name
+              << " do not match its shape!\n";
+    return false;
+  }
+  layer.setWeightsAndBiases(w_vec, b_vec);
+  return true;
+}
+
+bool EigenClassifier::readQuantizedWeights(const LayerNode &node,
+                                           const std::string &params_dir) {
+  std::vector<int8_t> weights;
+  std::vector<float> scales;
+  if (bundle_) {
+    const WeightBundle::Tensor *w = bundle_->find(node.name + "_weights_int8");
+    const WeightBundle::Tensor *s = bundle_->find(node.name + "_scales");
+    if (w && w->dtype == WeightBundle::DataType::eINT8 && s &&
+        s->dtype == WeightBundle::DataType::eFP32) {
+      const int8_t *w_data = static_cast<const int8_t *>(w->data);
+      weights.assign(w_data, w_data + w->size());
+      scales.assign(s->floats(), s->floats() + s->size());
+    }
+  } else {
+    const std::string prefix = params_dir + node.name;
+    weights = readBinaryFileIntoVector<int8_t>(prefix + "_weights_int8.bin");
+    scales = readBinaryFileIntoVector(prefix + "_scales.bin");
+  }
+
+  // The scales file holds the input scale and one scale per output channel.
+  // The weights have to match the shape of the layer, like the FP32 weights.
+  if (scales.size() != node.channels + 1 ||
+      weights.size() != (size_t)getLayer(node).getNumWeights()) {
+    std::cout << "ERROR: INT8 weights of layer " << node.name
+              << " do not match its shape!\n";
+    return false;
+  }
 
-  Eigen::MatrixXf M(depth, width_out * width_out);
+  getLayer(node).setQuantizedWeights(
+      weights, std::vector<float>(scales.begin() + 1, scales.end()),
+      scales[0]);
+  return true;
+}
+
+Layer &EigenClassifier::getLayer(const LayerNode &node) const {
+  if (node.type == LayerType::eConv) {
+    return *conv_layers_[node.index];
+  }
+  return *dense_layers_[node.index];
+}
 
-  for (int i = 0; i < X.rows(); i++) {
-    int row_in = 0;
-    int col_in = 0;
+void EigenClassifier::initWorkspace(Workspace &workspace) const {
+  // Find the largest intermediate results of the spatial and dense layers.
+  // Only the outputs of the last layer of each group of fused layers are
+  // stored.
+  const size_t n = batch_size_;
+  size_t columns_size = 0;
+  size_t planes_size = 0;
+  size_t quantized_size = 0;
+  int units_size = 0;
+  for (int i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].type == LayerType::eConv) {
+      const ConvLayer &layer = *conv_layers_[nodes_[i].index];
+      columns_size = std::max(columns_size, (size_t)layer.getBufferSize());
+      quantized_size =
+          std::max(quantized_size, (size_t)layer.getQuantizedBufferSize());
+      i += nodes_[i].num_fused;
+    }
+    const LayerNode &node = nodes_[i];
+    const int output_size = node.channels * node.width * node.width;
+    if (!node.is_flat) {
+      planes_size = std::max(planes_size, (size_t)output_size);
+    }
+    // The output of a spatial layer is flattened for a dense layer.
+    units_size = std::max(units_size, output_size);
+  }
 
-    for (int j = 0; j < width_out * width_out; j++) {
-      int start = row_in * width_in + col_in;
+  workspace.columns.resize(columns_size);
+  workspace.quantized.resize(std::max(quantized_size, n * units_size));
+  for (int i = 0; i < 2; i++) {
+    workspace.planes[i].resize(n * planes_size);
+    workspace.units[i].resize(units_size, n);
+  }
+}
 
-      Eigen::VectorXf block(filter_size * filter_size);
-      block << X(i, start), X(i, start + 1), X(i, start + width_in),
-          X(i, start + width_in + 1);
-      M(i, j) = block.maxCoeff();
+void EigenClassifier::forward(const ImageTensor &images, int start,
+                              int num_images, Workspace &workspace,
+                              float *scores,
+                              std::vector<float> *input_ranges) const {
+  // The input is in NCHW order. Spatial layers output their channels one
+  // after another, and, in each channel, the images are next to each other.
+  // The INT8 network reads the uchar images in its first (conv) layer.
+  const float *x = is_quantized_ ? nullptr : images.getFloatData(start);
+  int image_stride = images.getImageSize();
+  int channel_stride = image_size_ * image_size_;
+  int channels = num_channels_;
+  int width = image_size_;
+  bool is_channel_major = false;  // if the images are next to each other
+  int planes_out = 0;  // index of the next output buffer of spatial layers
+  int units_in = -1;   // index of the input buffer of dense layers
+
+  for (int i = 0; i < nodes_.size(); i++) {
+    const LayerNode &node = nodes_[i];
+    const int size_out = node.width * node.width;
+    float *y = workspace.planes[planes_out].data();
+
+    if (input_ranges && node.type == LayerType::eConv) {
+      // The planes of the input of a conv layer are next to each other.
+      const size_t size_in = (size_t)num_images * channels * width * width;
+      (*input_ranges)[i] = std::max(
+          (*input_ranges)[i], Eigen::Map<const Eigen::ArrayXf>(x, size_in)
+                                  .abs()
+                                  .maxCoeff());
+    }
 
-      col_in += stride;
-      if (col_in == width_in) {
-        row_in += stride;
-        col_in = 0;
+    if (node.type == LayerType::eConv) {
+      // The conv layer also calculates the layers that are fused into it.
+      const ConvLayer &layer = *conv_layers_[node.index];
+      if (is_quantized_ && i == 0) {
+        layer.forwardQuantized(images.getByteData(start), num_images,
+                               image_stride, channel_stride,
+                               workspace.quantized, workspace.columns, y);
+      } else if (is_quantized_) {
+        layer.forwardQuantized(x, num_images, image_stride, channel_stride,
+                               workspace.quantized, workspace.columns, y);
+      } else {
+        layer.forward(x, num_images, image_stride, channel_stride,
+                      workspace.columns, y);
+      }
+      image_stride = layer.getOutputSize();
+      channel_stride = num_images * layer.getOutputSize();
+      is_channel_major = true;
+      i += node.num_fused;
+    } else if (node.type == LayerType::ePool) {
+      // Pooling works on each plane, so the order of the planes is kept.
+      poolForward(x, channels * num_images, width, node.filter_size,
+                  node.stride, y);
+      if (is_channel_major) {
+        image_stride = size_out;
+        channel_stride = num_images * size_out;
+      } else {
+        image_stride = channels * size_out;
+        channel_stride = size_out;
       }
+    } else if (node.type == LayerType::eRelu && !node.is_flat) {
+      for (int n = 0; n < num_images; n++) {
+        for (int c = 0; c < channels; c++) {
+          const size_t offset = n * image_stride + c * channel_stride;
+          Eigen::Map<const Eigen::ArrayXf> src(x + offset, size_out);
+          Eigen::Map<Eigen::ArrayXf> dst(y + offset, size_out);
+          dst = src.max(0);
+        }
+      }
+    } else if (node.type == LayerType::eRelu) {
+      workspace.units[units_in].topLeftCorner(channels, num_images) =
+          workspace.units[units_in]
+              .topLeftCorner(channels, num_images)
+              .cwiseMax(0);
+    } else {
+      if (units_in < 0) {
+        // Flatten the output of the last spatial layer. Each column is the
+        // input of one image, with the channels of each pixel next to each
+        // other.
+        units_in = 0;
+        const int size_in = width * width;
+        Eigen::MatrixXf &X = workspace.units[units_in];
+        for (int n = 0; n < num_images; n++) {
+          for (int c = 0; c < channels; c++) {
+            const float *src = x + n * image_stride + c * channel_stride;
+            for (int j = 0; j < size_in; j++) {
+              X(j * channels + c, n) = src[j];
+            }
+          }
+        }
+        channels *= size_in;
+      }
+      const int units_out = 1 - units_in;
+      const auto X =
+          workspace.units[units_in].topLeftCorner(channels, num_images);
+      auto H = workspace.units[units_out].topLeftCorner(node.channels,
+                                                        num_images);
+      if (input_ranges) {
+        (*input_ranges)[i] =
+            std::max((*input_ranges)[i], X.cwiseAbs().maxCoeff());
+      }
+      if (is_quantized_) {
+        dense_layers_[node.index]->forwardQuantized(X, workspace.quantized,
+                                                    H);
+      } else {
+        dense_layers_[node.index]->forward(X, H);
+      }
+      units_in = units_out;
     }
+
+    if (!node.is_flat) {
+      x = y;
+      planes_out = 1 - planes_out;
+    }
+    channels = nodes_[i].channels;
+    width = nodes_[i].width;
   }
 
-  return M;
+  // The last layer is a dense layer with two units.
+  const Eigen::MatrixXf &Y = workspace.units[units_in];
+  for (int n = 0; n < num_images; n++) {
+    scores[n] = Y(1, n) - Y(0, n);
+  }
 }
 
-std::vector<float> EigenClassifier::readBinaryFileIntoVector(
+void EigenClassifier::poolForward(const float *x, int num_planes,
+                                  int width_in, int filter_size, int stride,
+                                  float *y) const {
+  const int width_out = (width_in - filter_size) / stride + 1;
+  const int size_in = width_in * width_in;
+  const int size_out = width_out * width_out;
+
+  for (int i = 0; i < num_planes; i++) {
+    const float *plane_in = x + (size_t)i * size_in;
+    float *plane_out = y + (size_t)i * size_out;
+
+    for (int row = 0; row < width_out; row++) {
+      for (int col = 0; col < width_out; col++) {
+        const float *block = plane_in + row * stride * width_in + col * stride;
+        float max = block[0];
+        for (int r = 0; r < filter_size; r++) {
+          for (int c = 0; c < filter_size; c++) {
+            max = std::max(max, block[r * width_in + c]);
+          }
+        }
+        plane_out[row * width_out + col] = max;
+      }
+    }
+  }
+}
+
+template <typename T>
+std::vector<T> EigenClassifier::readBinaryFileIntoVector(
     const std::string &location) {
-  std::vector<float> vals;
+  std::vector<T> vals;
 
   std::ifstream file(location.c_str(), std::ios::binary | std::ios::in);
   if (!file.is_open()) {
@@ -193,15 +692,33 @@ std::vector<float> EigenClassifier::readBinaryFileIntoVector(
     return vals;
   }
 
-  float x;
-  while (file.read(reinterpret_cast<char *>(&x), sizeof(float))) {
-    vals.push_back(x);
-  }
+  // Read the whole file at once.
+  file.seekg(0, std::ios::end);
+  const std::streamoff num_bytes = file.tellg();
+  file.seekg(0, std::ios::beg);
+  vals.resize(num_bytes / sizeof(T));
+  file.read(reinterpret_cast<char *>(vals.data()), vals.size() * sizeof(T));
 
   file.close();
 
   return vals;
 }
 
+template <typename T>
+bool EigenClassifier::writeVectorIntoBinaryFile(
+    const std::string &location, const std::vector<T> &vals) const {
+  std::ofstream file(location.c_str(), std::ios::binary | std::ios::out);
+  if (!file.is_open()) {
+    std::cout << "ERROR: Cannot open file: " << location << "!\n";
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char *>(vals.data()),
+             vals.size() * sizeof(T));
+  file.close();
+
+  return true;
+}
+
 }  // namespace net
 }  // namespace gpd
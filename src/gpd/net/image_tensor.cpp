@@ -0,0 +1,206 @@
+#include <gpd/net/image_tensor.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gpd {
+namespace net {
+
+namespace {
+
+const int BLOCK_PIXELS = 16;  ///< pixels converted at once with SSE2
+
+/**
+ * \brief Copy the channels of interleaved pixels into planes.
+ * \param src the interleaved pixels
+ * \param num_pixels the number of pixels
+ * \param channels the number of channels of each pixel
+ * \param plane_size the number of elements between two planes in <dst>
+ * \param[out] dst the first element of the first plane
+ */
+template <typename T>
+void deinterleaveScalar(const uchar *src, int num_pixels, int channels,
+                        int plane_size, T *dst) {
+  for (int i = 0; i < num_pixels; i++) {
+    T *dst_pixel = dst + i;
+    for (int ch = 0; ch < channels; ch++) {
+      dst_pixel[ch * plane_size] = src[ch];
+    }
+    src += channels;
+  }
+}
+
+#ifdef __SSE2__
+/**
+ * \brief Transpose a 16x16 block of bytes.
+ * \param[in,out] rows the rows of the block
+ */
+inline void transposeBlock(__m128i rows[BLOCK_PIXELS]) {
+  __m128i tmp[BLOCK_PIXELS];
+
+  // Each pass interleaves row i with row i + 8. Four passes transpose the
+  // block.
+  for (int pass = 0; pass < 4; pass++) {
+    for (int i = 0; i < BLOCK_PIXELS / 2; i++) {
+      tmp[2 * i] = _mm_unpacklo_epi8(rows[i], rows[i + BLOCK_PIXELS / 2]);
+      tmp[2 * i + 1] = _mm_unpackhi_epi8(rows[i], rows[i + BLOCK_PIXELS / 2]);
+    }
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+      rows[i] = tmp[i];
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+ImageTensor::ImageTensor(Layout layout, Precision precision)
+    : layout_(layout),
+      precision_(precision),
+      num_images_(0),
+      rows_(0),
+      cols_(0),
+      channels_(0) {}
+
+void ImageTensor::resize(int num_images, int rows, int cols, int channels) {
+  num_images_ = num_images;
+  rows_ = rows;
+  cols_ = cols;
+  channels_ = channels;
+
+  const size_t num_elements = (size_t)num_images * getImageSize();
+  if (precision_ == Precision::eFP32) {
+    float_data_.resize(num_elements);
+  } else {
+    byte_data_.resize(num_elements);
+  }
+}
+
+void ImageTensor::setImage(int index, const cv::Mat &image) {
+  const size_t offset = (size_t)index * getImageSize();
+
+  if (precision_ == Precision::eFP32) {
+    packImage(image, float_data_.data() + offset);
+  } else if (image.data != byte_data_.data() + offset) {
+    packImage(image, byte_data_.data() + offset);
+  }
+}
+
+cv::Mat ImageTensor::wrapImage(int index) {
+  if (layout_ != Layout::eNHWC || precision_ != Precision::eU8) {
+    return cv::Mat();
+  }
+
+  return cv::Mat(rows_, cols_, CV_8UC(channels_),
+                 byte_data_.data() + (size_t)index * getImageSize());
+}
+
+cv::Mat ImageTensor::getImage(int index) const {
+  cv::Mat image(rows_, cols_, CV_8UC(channels_));
+
+  if (precision_ == Precision::eFP32) {
+    unpackImage(getFloatData(index), image);
+  } else {
+    unpackImage(getByteData(index), image);
+  }
+
+  return image;
+}
+
+template <typename T>
+void ImageTensor::packImage(const cv::Mat &image, T *dst) const {
+  const int row_size = cols_ * channels_;
+
+  if (layout_ == Layout::eNHWC) {
+    for (int r = 0; r < rows_; r++) {
+      const uchar *src = image.ptr<uchar>(r);
+      T *dst_row = dst + r * row_size;
+      for (int k = 0; k < row_size; k++) {
+        dst_row[k] = src[k];
+      }
+    }
+    return;
+  }
+
+  // Deinterleave the channels.
+  const int plane_size = rows_ * cols_;
+  if (image.isContinuous()) {
+    deinterleave(image.ptr<uchar>(), plane_size, channels_, plane_size, dst);
+    return;
+  }
+
+  for (int r = 0; r < rows_; r++) {
+    deinterleave(image.ptr<uchar>(r), cols_, channels_, plane_size,
+                 dst + r * cols_);
+  }
+}
+
+template <typename T>
+void ImageTensor::unpackImage(const T *src, cv::Mat &image) const {
+  const int plane_size = rows_ * cols_;
+
+  for (int r = 0; r < rows_; r++) {
+    uchar *dst = image.ptr<uchar>(r);
+    for (int c = 0; c < cols_; c++) {
+      for (int ch = 0; ch < channels_; ch++) {
+        const int idx = (layout_ == Layout::eNHWC)
+                            ? (r * cols_ + c) * channels_ + ch
+                            : ch * plane_size + r * cols_ + c;
+        dst[ch] = cv::saturate_cast<uchar>(src[idx]);
+      }
+      dst += channels_;
+    }
+  }
+}
+
+void ImageTensor::deinterleave(const uchar *src, int num_pixels, int channels,
+                               int plane_size, float *dst) {
+  int i = 0;
+
+#ifdef __SSE2__
+  // Transpose blocks of 16 pixels x 16 bytes, and widen the first <channels>
+  // rows of each transposed block to floats. The last load of a block must
+  // not read past the end of <src>.
+  if (channels <= BLOCK_PIXELS) {
+    const __m128i zero = _mm_setzero_si128();
+    const int num_bytes = num_pixels * channels;
+    __m128i rows[BLOCK_PIXELS];
+
+    for (; (i + BLOCK_PIXELS - 1) * channels + BLOCK_PIXELS <= num_bytes;
+         i += BLOCK_PIXELS) {
+      const uchar *src_block = src + i * channels;
+      for (int j = 0; j < BLOCK_PIXELS; j++) {
+        rows[j] = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src_block + j * channels));
+      }
+      transposeBlock(rows);
+
+      for (int ch = 0; ch < channels; ch++) {
+        const __m128i lo = _mm_unpacklo_epi8(rows[ch], zero);
+        const __m128i hi = _mm_unpackhi_epi8(rows[ch], zero);
+        float *dst_block = dst + ch * plane_size + i;
+        _mm_storeu_ps(dst_block,
+                      _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(dst_block + 4,
+                      _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(dst_block + 8,
+                      _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(dst_block + 12,
+                      _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+      }
+    }
+  }
+#endif
+
+  deinterleaveScalar(src + i * channels, num_pixels - i, channels, plane_size,
+                     dst + i);
+}
+
+void ImageTensor::deinterleave(const uchar *src, int num_pixels, int channels,
+                               int plane_size, uchar *dst) {
+  deinterleaveScalar(src, num_pixels, channels, plane_size, dst);
+}
+
+}  // namespace net
+}  // namespace gpd
@@ -0,0 +1,61 @@
+#include <gpd/net/opencv_classifier.h>
+
+namespace gpd {
+namespace net {
+
+OpenCvClassifier::OpenCvClassifier(const std::string &model_file,
+                                   const std::string &weights_file,
+                                   Classifier::Device device, int batch_size)
+    : batch_size_(std::max(batch_size, 1)) {
+  // Load pretrained network. The framework is deduced from the file
+  // extensions.
+  net_ = cv::dnn::readNet(model_file, weights_file);
+  if (net_.empty()) {
+    printf("ERROR: Could not load network from %s!\n", model_file.c_str());
+    return;
+  }
+
+  switch (device) {
+    case Classifier::Device::eGPU:
+      net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+      net_.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+      break;
+    case Classifier::Device::eVPU:
+      net_.setPreferableBackend(cv::dnn::DNN_BACKEND_INFERENCE_ENGINE);
+      net_.setPreferableTarget(cv::dnn::DNN_TARGET_MYRIAD);
+      break;
+    default:
+      net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+      net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+  }
+}
+
+std::vector<float> OpenCvClassifier::classifyImages(const ImageTensor &images) {
+  std::vector<float> predictions(images.size());
+  if (net_.empty()) {
+    return predictions;
+  }
+
+  // Process the images in batches. The images are already stored in the
+  // network's layout (NCHW, FP32), so each batch is wrapped into a blob
+  // without copying it.
+  for (int start = 0; start < images.size(); start += batch_size_) {
+    const int n = std::min(batch_size_, images.size() - start);
+    const int sizes[] = {n, images.getChannels(), images.getRows(),
+                         images.getCols()};
+    cv::Mat blob(4, sizes, CV_32F,
+                 const_cast<float *>(images.getFloatData(start)));
+
+    net_.setInput(blob);
+    cv::Mat out = net_.forward();
+
+    for (int j = 0; j < n; j++) {
+      predictions[start + j] = out.at<float>(j, 1) - out.at<float>(j, 0);
+    }
+  }
+
+  return predictions;
+}
+
+}  // namespace net
+}  // namespace gpd
@@ -15,7 +15,7 @@ std::map<Classifier::Device, InferenceEngine::TargetDevice>
 OpenVinoClassifier::OpenVinoClassifier(const std::string &model_file,
                                        const std::string &weights_file,
                                        Classifier::Device device,
-                                       int batch_size) {
+                                       int batch_size, int num_requests) {
   InferenceEngine::PluginDispatcher dispatcher({"../../../lib/intel64", ""});
   plugin_ = InferencePlugin(dispatcher.getSuitablePlugin(device_map_[device]));
 
@@ -31,70 +31,72 @@ OpenVinoClassifier::OpenVinoClassifier(const std::string &model_file,
   OutputsDataMap output = network_.getOutputsInfo();
   output.begin()->second->setPrecision(Precision::FP32);
 
-  infer_request_ = plugin_.LoadNetwork(network_, {}).CreateInferRequest();
-  auto output_name = output.begin()->first;
-  output_blob_ = infer_request_.GetBlob(output_name);
+  executable_network_ = plugin_.LoadNetwork(network_, {});
+  requests_.resize(std::max(num_requests, 1));
+  for (Request &request : requests_) {
+    request.infer_request = executable_network_.CreateInferRequestPtr();
+    request.input_blob = request.infer_request->GetBlob(input.begin()->first);
+    request.output_blob =
+        request.infer_request->GetBlob(output.begin()->first);
+    request.start = 0;
+    request.num_images = 0;
+  }
 }
 
 std::vector<float> OpenVinoClassifier::classifyImages(
-    const std::vector<std::unique_ptr<cv::Mat>> &image_list) {
-  std::vector<float> predictions(0);
-  InputsDataMap input_info = network_.getInputsInfo();
-
-  for (const auto &item : input_info) {
-    Blob::Ptr input = infer_request_.GetBlob(item.first);
-    SizeVector dims = input->getTensorDesc().getDims();
-    size_t channels = dims[1];
-    size_t rows = dims[2];
-    size_t cols = dims[3];
-    size_t image_size = rows * cols;
-    auto data =
-        input->buffer().as<PrecisionTrait<Precision::FP32>::value_type *>();
-    int num_iter = (int)ceil(image_list.size() / (double)getBatchSize());
-
-    for (size_t i = 0; i < num_iter; i++) {
-      int n = std::min(getBatchSize(),
-                       (int)(image_list.size() - i * getBatchSize()));
-      for (size_t b = 0; b < n; b++) {
-        int image_id = i * getBatchSize() + b;
-        for (int r = 0; r < rows; r++) {
-          for (int c = 0; c < cols; c++) {
-            for (int ch = 0; ch < channels; ch++) {
-              int src_idx[3] = {r, c, ch};
-              int dst_idx =
-                  b * image_size * channels + ch * image_size + r * cols + c;
-              data[dst_idx] = image_list[image_id]->at<uchar>(src_idx);
-            }
-          }
-        }
-        if (n < getBatchSize()) {
-          for (int b = n; b < getBatchSize(); b++) {
-            for (int r = 0; r < rows; r++) {
-              for (int c = 0; c < cols; c++) {
-                for (int ch = 0; ch < channels; ch++) {
-                  int dst_idx = b * image_size * channels + ch * image_size +
-                                r * cols + c;
-                  data[dst_idx] = 0;
-                }
-              }
-            }
-          }
-        }
-      }
-      infer_request_.Infer();
-
-      auto output_data =
-          output_blob_->buffer()
-              .as<PrecisionTrait<Precision::FP32>::value_type *>();
-      const int resultsCnt = output_blob_->size() / getBatchSize();
-
-      for (int j = 0; j < n; j++) {
-        predictions.push_back(output_data[2 * j + 1] - output_data[2 * j]);
-      }
+    const ImageTensor &images) {
+  std::vector<float> scores(images.size());
+  const int batch_size = getBatchSize();
+  const int num_batches = (images.size() + batch_size - 1) / batch_size;
+  const int num_requests = requests_.size();
+
+  // Batch i runs on request i % num_requests. Before a request is reused, its
+  // previous batch is collected, so up to <num_requests> batches are in
+  // flight while the next one is copied.
+  for (int i = 0; i < num_batches; i++) {
+    Request &request = requests_[i % num_requests];
+    if (i >= num_requests) {
+      finishBatch(request, scores);
     }
+    startBatch(images, i * batch_size, request);
+  }
+
+  for (int i = std::max(num_batches - num_requests, 0); i < num_batches; i++) {
+    finishBatch(requests_[i % num_requests], scores);
   }
 
-  return predictions;
+  return scores;
+}
+
+void OpenVinoClassifier::startBatch(const ImageTensor &images, int start,
+                                    Request &request) {
+  request.start = start;
+  request.num_images = std::min(getBatchSize(), images.size() - start);
+
+  // The network expects NCHW floats. The slots behind the last image of a
+  // short batch keep stale data; their scores are ignored.
+  float *data = request.input_blob->buffer()
+                    .as<PrecisionTrait<Precision::FP32>::value_type *>();
+  const int plane_size = images.getRows() * images.getCols();
+  for (int j = 0; j < request.num_images; j++) {
+    ImageTensor::deinterleave(images.getByteData(start + j), plane_size,
+                              images.getChannels(), plane_size,
+                              data + (size_t)j * images.getImageSize());
+  }
+
+  request.infer_request->StartAsync();
+}
+
+void OpenVinoClassifier::finishBatch(Request &request,
+                                     std::vector<float> &scores) {
+  request.infer_request->Wait(IInferRequest::WaitMode::RESULT_READY);
+
+  const float *output_data =
+      request.output_blob->buffer()
+          .as<PrecisionTrait<Precision::FP32>::value_type *>();
+  for (int j = 0; j < request.num_images; j++) {
+    scores[request.start + j] = output_data[2 * j + 1] - output_data[2 * j];
+  }
 }
 
 int OpenVinoClassifier::getBatchSize() const { return network_.getBatchSize(); }
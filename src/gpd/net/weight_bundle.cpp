@@ -0,0 +1,260 @@
+#include <gpd/net/weight_bundle.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace gpd {
+namespace net {
+
+namespace {
+
+const char MAGIC[8] = {'G', 'P', 'D', 'B', 'N', 'D', 'L', '\0'};
+
+/** Header at the start of a bundle (64 bytes). */
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_tensors;
+  uint64_t file_size;
+  uint64_t table_checksum;  // checksum of the tensor table
+  char reserved[32];
+};
+
+/** Entry of the tensor table that follows the header (128 bytes). */
+struct TensorEntry {
+  char name[64];
+  uint32_t dtype;
+  uint32_t num_dims;
+  int32_t dims[4];
+  uint64_t offset;  // offset of the data from the start of the file
+  uint64_t num_bytes;
+  uint64_t checksum;  // checksum of the data
+  char reserved[16];
+};
+
+static_assert(sizeof(FileHeader) == 64, "unexpected bundle header size");
+static_assert(sizeof(TensorEntry) == 128, "unexpected tensor entry size");
+
+size_t getElementSize(WeightBundle::DataType dtype) {
+  return (dtype == WeightBundle::DataType::eFP32) ? sizeof(float)
+                                                  : sizeof(int8_t);
+}
+
+}  // namespace
+
+const uint32_t WeightBundle::VERSION = 1;
+const int WeightBundle::ALIGNMENT = 64;
+const int WeightBundle::MAX_DIMS = 4;
+
+size_t WeightBundle::Tensor::size() const {
+  size_t size = 1;
+  for (int i = 0; i < shape.size(); i++) {
+    size *= shape[i];
+  }
+  return size;
+}
+
+WeightBundle::~WeightBundle() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+std::shared_ptr<const WeightBundle> WeightBundle::open(
+    const std::string &filename) {
+  // Bundles that are open in this process, by filename.
+  static std::mutex mutex;
+  static std::map<std::string, std::weak_ptr<const WeightBundle>> bundles;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const WeightBundle> bundle = bundles[filename].lock();
+  if (bundle) {
+    return bundle;
+  }
+
+  std::shared_ptr<WeightBundle> new_bundle(new WeightBundle);
+  if (!new_bundle->map(filename)) {
+    return nullptr;
+  }
+  bundles[filename] = new_bundle;
+  return new_bundle;
+}
+
+bool WeightBundle::map(const std::string &filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "ERROR: Cannot open file: " << filename << "!\n";
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+    std::cout << "ERROR: " << filename << " is not a weight bundle!\n";
+    ::close(fd);
+    return false;
+  }
+
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    std::cout << "ERROR: Cannot map file: " << filename << "!\n";
+    return false;
+  }
+  data_ = data;
+  size_ = st.st_size;
+
+  // Check the header and the tensor table.
+  const char *bytes = static_cast<const char *>(data_);
+  const FileHeader *header = reinterpret_cast<const FileHeader *>(bytes);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header->file_size != size_) {
+    std::cout << "ERROR: " << filename << " is not a weight bundle!\n";
+    return false;
+  }
+  if (header->version != VERSION) {
+    std::cout << "ERROR: " << filename << " has version " << header->version
+              << ", expected version " << VERSION << "!\n";
+    return false;
+  }
+  const size_t table_size = (size_t)header->num_tensors * sizeof(TensorEntry);
+  if (sizeof(FileHeader) + table_size > size_ ||
+      checksum(bytes + sizeof(FileHeader), table_size) !=
+          header->table_checksum) {
+    std::cout << "ERROR: The tensor table of " << filename
+              << " is corrupted!\n";
+    return false;
+  }
+
+  const TensorEntry *entries =
+      reinterpret_cast<const TensorEntry *>(bytes + sizeof(FileHeader));
+  tensors_.resize(header->num_tensors);
+  for (int i = 0; i < tensors_.size(); i++) {
+    const TensorEntry &entry = entries[i];
+    Tensor &tensor = tensors_[i];
+    tensor.name.assign(entry.name, strnlen(entry.name, sizeof(entry.name)));
+    tensor.dtype = static_cast<DataType>(entry.dtype);
+    tensor.shape.assign(entry.dims,
+                        entry.dims + std::min(entry.num_dims, 4u));
+    tensor.data = bytes + entry.offset;
+    tensor.num_bytes = entry.num_bytes;
+
+    const bool is_valid =
+        entry.dtype <= static_cast<uint32_t>(DataType::eINT8) &&
+        entry.num_dims <= MAX_DIMS && entry.offset % ALIGNMENT == 0 &&
+        entry.offset <= size_ && entry.num_bytes <= size_ - entry.offset &&
+        tensor.size() * getElementSize(tensor.dtype) == entry.num_bytes;
+    if (!is_valid ||
+        checksum(tensor.data, tensor.num_bytes) != entry.checksum) {
+      std::cout << "ERROR: Tensor " << tensor.name << " in " << filename
+                << " is corrupted!\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool WeightBundle::write(const std::string &filename,
+                         const std::vector<Tensor> &tensors) {
+  // Find the offset of the data of each tensor.
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.num_tensors = tensors.size();
+
+  std::vector<TensorEntry> entries(tensors.size());
+  uint64_t offset = sizeof(FileHeader) + tensors.size() * sizeof(TensorEntry);
+  for (int i = 0; i < tensors.size(); i++) {
+    const Tensor &tensor = tensors[i];
+    if (tensor.name.size() >= sizeof(entries[i].name) ||
+        tensor.shape.size() > MAX_DIMS ||
+        tensor.size() * getElementSize(tensor.dtype) != tensor.num_bytes) {
+      std::cout << "ERROR: Cannot write tensor " << tensor.name
+                << " into a weight bundle!\n";
+      return false;
+    }
+
+    TensorEntry &entry = entries[i];
+    std::memset(&entry, 0, sizeof(entry));
+    std::strncpy(entry.name, tensor.name.c_str(), sizeof(entry.name) - 1);
+    entry.dtype = static_cast<uint32_t>(tensor.dtype);
+    entry.num_dims = tensor.shape.size();
+    std::copy(tensor.shape.begin(), tensor.shape.end(), entry.dims);
+    offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    entry.offset = offset;
+    entry.num_bytes = tensor.num_bytes;
+    entry.checksum = checksum(tensor.data, tensor.num_bytes);
+    offset += tensor.num_bytes;
+  }
+  header.file_size = offset;
+  header.table_checksum =
+      checksum(entries.data(), entries.size() * sizeof(TensorEntry));
+
+  const std::string tmp_filename = filename + ".tmp";
+  std::ofstream file(tmp_filename.c_str(), std::ios::binary | std::ios::out);
+  if (!file.is_open()) {
+    std::cout << "ERROR: Cannot open file: " << tmp_filename << "!\n";
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entries.data()),
+             entries.size() * sizeof(TensorEntry));
+  const char padding[64] = {0};
+  for (int i = 0; i < tensors.size(); i++) {
+    file.write(padding, entries[i].offset - file.tellp());
+    file.write(static_cast<const char *>(tensors[i].data),
+               tensors[i].num_bytes);
+  }
+  file.close();
+
+  if (!file || std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    std::cout << "ERROR: Cannot write file: " << filename << "!\n";
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+const WeightBundle::Tensor *WeightBundle::find(const std::string &name) const {
+  for (int i = 0; i < tensors_.size(); i++) {
+    if (tensors_[i].name == name) {
+      return &tensors_[i];
+    }
+  }
+  return nullptr;
+}
+
+uint64_t WeightBundle::checksum(const void *data, size_t num_bytes) {
+  const uint64_t prime = 1099511628211ULL;
+  uint64_t hash = 14695981039346656037ULL;
+
+  // Hash eight bytes at a time, then the remaining bytes.
+  const char *bytes = static_cast<const char *>(data);
+  const size_t num_words = num_bytes / sizeof(uint64_t);
+  for (size_t i = 0; i < num_words; i++) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (size_t i = num_words * sizeof(uint64_t); i < num_bytes; i++) {
+    hash = (hash ^ static_cast<unsigned char>(bytes[i])) * prime;
+  }
+
+  return hash;
+}
+
+}  // namespace net
+}  // namespace gpd
@@ -0,0 +1,134 @@
+#include <gpd/score_cache.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace gpd {
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+/**
+ * \brief Add a 64-bit word to a FNV-1a hash.
+ * \param hash the hash
+ * \param word the word
+ * \return the new hash
+ */
+inline uint64_t combine(uint64_t hash, uint64_t word) {
+  return (hash ^ word) * FNV_PRIME;
+}
+
+/**
+ * \brief Add the bits of a double to a FNV-1a hash.
+ * \param hash the hash
+ * \param value the value
+ * \return the new hash
+ */
+inline uint64_t combine(uint64_t hash, double value) {
+  uint64_t word;
+  std::memcpy(&word, &value, sizeof(word));
+  return combine(hash, word);
+}
+
+/**
+ * \brief Round a value to a multiple of a resolution.
+ * \param value the value
+ * \param resolution the resolution
+ * \return the index of the multiple
+ */
+inline uint64_t quantize(double value, double resolution) {
+  return (uint64_t)std::llround(value / resolution);
+}
+
+}  // namespace
+
+ScoreCache::ScoreCache(int capacity, double position_resolution,
+                       double orientation_resolution)
+    : capacity_(capacity),
+      position_resolution_(position_resolution),
+      orientation_resolution_(orientation_resolution),
+      num_hits_(0),
+      num_misses_(0) {
+  index_.reserve(capacity);
+}
+
+uint64_t ScoreCache::hashCloud(const util::Cloud &cloud) {
+  const util::PointCloudRGB &points = *cloud.getCloudProcessed();
+  uint64_t hash = combine(FNV_OFFSET, (uint64_t)points.size());
+
+  for (size_t i = 0; i < points.size(); i++) {
+    uint32_t xyz[3];
+    std::memcpy(xyz, points[i].data, sizeof(xyz));
+    hash = combine(hash, ((uint64_t)xyz[0] << 32) | xyz[1]);
+    hash = combine(hash, (uint64_t)xyz[2]);
+  }
+
+  const Eigen::Matrix3Xd &view_points = cloud.getViewPoints();
+  for (int i = 0; i < view_points.size(); i++) {
+    hash = combine(hash, view_points.data()[i]);
+  }
+
+  return hash;
+}
+
+uint64_t ScoreCache::computeKey(const candidate::Hand &hand,
+                                uint64_t cloud_hash) const {
+  // The grasp image is determined by the sample, the hand frame, and the
+  // position of the closing region in that frame.
+  uint64_t key = cloud_hash;
+  for (int i = 0; i < 3; i++) {
+    key = combine(key, quantize(hand.getSample()(i), position_resolution_));
+  }
+  for (int i = 0; i < 9; i++) {
+    key = combine(key,
+                  quantize(hand.getFrame().data()[i], orientation_resolution_));
+  }
+  key = combine(key, quantize(hand.getBottom(), position_resolution_));
+  key = combine(key, quantize(hand.getCenter(), position_resolution_));
+
+  return key;
+}
+
+bool ScoreCache::find(uint64_t key, float &score) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    num_misses_++;
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+  score = it->second->second;
+  num_hits_++;
+  return true;
+}
+
+void ScoreCache::insert(uint64_t key, float score) {
+  if (capacity_ <= 0) {
+    return;
+  }
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = score;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+
+  if (entries_.size() >= capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, score);
+  index_[key] = entries_.begin();
+}
+
+void ScoreCache::clear() {
+  entries_.clear();
+  index_.clear();
+  num_hits_ = 0;
+  num_misses_ = 0;
+}
+
+}  // namespace gpd
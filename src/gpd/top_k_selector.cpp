@@ -0,0 +1,29 @@
+#include <gpd/top_k_selector.h>
+
+namespace gpd {
+
+bool TopKSelector::push(std::unique_ptr<candidate::Hand> hand) {
+  if (!canEnter(hand->getScore())) {
+    return false;
+  }
+
+  if (heap_.size() == k_) {
+    std::pop_heap(heap_.begin(), heap_.end(), isScoreGreater);
+    heap_.back() = std::move(hand);
+  } else {
+    heap_.push_back(std::move(hand));
+  }
+  std::push_heap(heap_.begin(), heap_.end(), isScoreGreater);
+
+  return true;
+}
+
+std::vector<std::unique_ptr<candidate::Hand>> TopKSelector::extract() {
+  // Sorting a heap with the heap order puts the highest score first.
+  std::sort_heap(heap_.begin(), heap_.end(), isScoreGreater);
+  std::vector<std::unique_ptr<candidate::Hand>> hands_out = std::move(heap_);
+  heap_.clear();
+  return hands_out;
+}
+
+}  // namespace gpd
@@ -159,6 +159,8 @@ void Cloud::removeNans() {
     eifilter.setInputCloud(cloud_processed_);
     eifilter.setIndices(inliers);
     eifilter.filter(*cloud_processed_);
+    search_tree_.reset();
+    changed_mask_.resize(0);
     printf("Cloud after removing NANs: %zu\n", cloud_processed_->size());
   }
 }
@@ -169,6 +171,8 @@ void Cloud::removeStatisticalOutliers() {
   sor.setMeanK(50);
   sor.setStddevMulThresh(1.0);
   sor.filter(*cloud_processed_);
+  search_tree_.reset();
+  changed_mask_.resize(0);
   printf("Cloud after removing statistical outliers: %zu\n",
          cloud_processed_->size());
 }
@@ -176,10 +180,8 @@ void Cloud::removeStatisticalOutliers() {
 void Cloud::refineNormals(int k) {
   std::vector<std::vector<int>> k_indices;
   std::vector<std::vector<float>> k_sqr_distances;
-  pcl::search::KdTree<pcl::PointXYZRGBA> search;
-  search.setInputCloud(cloud_processed_);
-  search.nearestKSearch(*cloud_processed_, std::vector<int>(), k, k_indices,
-                        k_sqr_distances);
+  getSearchTree()->nearestKSearch(*cloud_processed_, std::vector<int>(), k,
+                                  k_indices, k_sqr_distances);
 
   pcl::PointCloud<pcl::Normal> pcl_normals;
   pcl_normals.resize(normals_.cols());
@@ -264,6 +266,8 @@ void Cloud::filterWorkspace(const std::vector<double> &workspace) {
   }
   cloud_processed_ = cloud;
   camera_source_ = camera_source;
+  search_tree_.reset();
+  changed_mask_.resize(0);
 }
 
 void Cloud::filterSamples(const std::vector<double> &workspace) {
@@ -283,12 +287,15 @@ void Cloud::filterSamples(const std::vector<double> &workspace) {
   samples_ = filtered_samples;
 }
 
-void Cloud::voxelizeCloud(float cell_size) {
+void Cloud::voxelizeCloud(float cell_size, bool align_to_origin) {
   // Find the cell that each point falls into.
   pcl::PointXYZRGBA min_pt_pcl;
   pcl::PointXYZRGBA max_pt_pcl;
   pcl::getMinMax3D(*cloud_processed_, min_pt_pcl, max_pt_pcl);
-  const Eigen::Vector3f min_pt = min_pt_pcl.getVector3fMap();
+  Eigen::Vector3f min_pt = min_pt_pcl.getVector3fMap();
+  if (align_to_origin) {
+    min_pt = cell_size * (min_pt / cell_size).array().floor().matrix();
+  }
   std::set<Eigen::Vector4i, Cloud::UniqueVector4First3Comparator> bins;
   Eigen::Matrix3Xd avg_normals =
       Eigen::Matrix3Xd::Zero(3, cloud_processed_->size());
@@ -337,6 +344,8 @@ void Cloud::voxelizeCloud(float cell_size) {
   for (int i = 0; i < voxels.cols(); i++) {
     cloud_processed_->points[i].getVector3fMap() = voxels.col(i);
   }
+  search_tree_.reset();
+  changed_mask_.resize(0);
 
   camera_source_ = camera_source;
 
@@ -347,6 +356,104 @@ void Cloud::voxelizeCloud(float cell_size) {
   printf("Voxelized cloud: %zu\n", cloud_processed_->size());
 }
 
+void Cloud::voxelizeCloudParallel(float cell_size, int num_threads,
+                                  bool align_to_origin) {
+  const int n = cloud_processed_->size();
+  if (n == 0) {
+    return;
+  }
+
+  pcl::PointXYZRGBA min_pt_pcl;
+  pcl::PointXYZRGBA max_pt_pcl;
+  pcl::getMinMax3D(*cloud_processed_, min_pt_pcl, max_pt_pcl);
+  Eigen::Vector3f min_pt = min_pt_pcl.getVector3fMap();
+  if (align_to_origin) {
+    min_pt = cell_size * (min_pt / cell_size).array().floor().matrix();
+  }
+  const Eigen::Vector3i max_cell = EigenUtils::floorVector(
+      (max_pt_pcl.getVector3fMap() - min_pt) / cell_size);
+  if (max_cell.maxCoeff() >= (1 << 21)) {
+    printf("Cloud is too large for the parallel voxel grid. Using the set.\n");
+    voxelizeCloud(cell_size, align_to_origin);
+    return;
+  }
+
+  // Find the cell that each point falls into.
+  std::vector<std::pair<uint64_t, int>> keys(n);
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_threads)
+#endif
+  for (int i = 0; i < n; i++) {
+    const Eigen::Vector3f pt = cloud_processed_->at(i).getVector3fMap();
+    keys[i].first =
+        encodeMorton(EigenUtils::floorVector((pt - min_pt) / cell_size));
+    keys[i].second = i;
+  }
+
+  sortKeys(keys, num_threads);
+
+  // Each run of equal codes forms one voxel.
+  std::vector<int> starts;
+  starts.reserve(n / 2);
+  for (int i = 0; i < n; i++) {
+    if (i == 0 || keys[i].first != keys[i - 1].first) {
+      starts.push_back(i);
+    }
+  }
+  const int num_voxels = starts.size();
+  starts.push_back(n);
+
+  // Calculate the point value, the average surface normal, and the camera
+  // source for each voxel. Within a run, the points are ordered by index, so
+  // the normals are summed in the same order as in voxelizeCloud().
+  const bool has_normals = normals_.cols() > 0;
+  PointCloudRGB::Ptr cloud(new PointCloudRGB);
+  cloud->points.resize(num_voxels);
+  Eigen::Matrix3Xd normals(3, has_normals ? num_voxels : 0);
+  Eigen::MatrixXi camera_source =
+      Eigen::MatrixXi::Zero(camera_source_.rows(), num_voxels);
+
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_threads)
+#endif
+  for (int i = 0; i < num_voxels; i++) {
+    const int first = keys[starts[i]].second;
+    const Eigen::Vector3f pt = cloud_processed_->at(first).getVector3fMap();
+    const Eigen::Vector3i cell =
+        EigenUtils::floorVector((pt - min_pt) / cell_size);
+    cloud->points[i] = cloud_processed_->points[first];
+    cloud->points[i].getVector3fMap() =
+        min_pt + cell_size * cell.cast<float>();
+
+    Eigen::Vector3d normal_sum = Eigen::Vector3d::Zero();
+    for (int j = starts[i]; j < starts[i + 1]; j++) {
+      const int idx = keys[j].second;
+      for (int k = 0; k < camera_source_.rows(); k++) {
+        if (camera_source_(k, idx) == 1) {
+          camera_source(k, i) = 1;
+        }
+      }
+      if (has_normals) {
+        normal_sum += normals_.col(idx);
+      }
+    }
+    if (has_normals) {
+      normals.col(i) = normal_sum / (double)(starts[i + 1] - starts[i]);
+    }
+  }
+
+  cloud_processed_ = cloud;
+  camera_source_ = camera_source;
+  search_tree_.reset();
+  changed_mask_.resize(0);
+
+  if (has_normals) {
+    normals_ = normals;
+  }
+
+  printf("Voxelized cloud: %zu\n", cloud_processed_->size());
+}
+
 void Cloud::subsample(int num_samples) {
   if (num_samples == 0) {
     return;
@@ -476,6 +583,52 @@ void Cloud::calculateNormals(int num_threads, double radius) {
   reverseNormals();
 }
 
+void Cloud::calculateNormals(int num_threads, double radius,
+                             const std::vector<int> &indices) {
+  double t0 = omp_get_wtime();
+  if (normals_.cols() != cloud_processed_->size()) {
+    normals_ = Eigen::Matrix3Xd::Zero(3, cloud_processed_->size());
+  }
+  if (indices.size() == 0) {
+    return;
+  }
+
+  pcl::NormalEstimationOMP<pcl::PointXYZRGBA, pcl::Normal> estimator(
+      num_threads);
+  estimator.setInputCloud(cloud_processed_);
+  estimator.setSearchMethod(getSearchTree());
+  estimator.setRadiusSearch(radius);
+
+  // Calculate the surface normals of the points seen by each camera.
+  for (int i = 0; i < view_points_.cols(); i++) {
+    pcl::IndicesPtr indices_cam(new std::vector<int>);
+    for (int j = 0; j < indices.size(); j++) {
+      if (camera_source_(i, indices[j]) == 1) {
+        indices_cam->push_back(indices[j]);
+      }
+    }
+    if (indices_cam->size() == 0) {
+      continue;
+    }
+
+    PointCloudNormal normals_cloud;
+    estimator.setIndices(indices_cam);
+    estimator.setViewPoint(view_points_(0, i), view_points_(1, i),
+                           view_points_(2, i));
+    estimator.compute(normals_cloud);
+
+    for (int j = 0; j < normals_cloud.size(); j++) {
+      const pcl::Normal &normal = normals_cloud.at(j);
+      normals_.col((*indices_cam)[j]) << normal.normal_x, normal.normal_y,
+          normal.normal_z;
+    }
+  }
+
+  printf("Calculated %zu of %zu surface normals in %3.4fs.\n", indices.size(),
+         normals_.cols(), omp_get_wtime() - t0);
+  reverseNormals();
+}
+
 void Cloud::calculateNormalsOrganized() {
   if (!cloud_processed_->isOrganized()) {
     std::cout << "Error: point cloud is not organized!\n";
@@ -501,10 +654,8 @@ void Cloud::calculateNormalsOMP(int num_threads, double radius) {
   std::vector<PointCloudNormal::Ptr> normals_list(view_points_.cols());
   pcl::NormalEstimationOMP<pcl::PointXYZRGBA, pcl::Normal> estimator(
       num_threads);
-  pcl::search::KdTree<pcl::PointXYZRGBA>::Ptr tree_ptr(
-      new pcl::search::KdTree<pcl::PointXYZRGBA>);
   estimator.setInputCloud(cloud_processed_);
-  estimator.setSearchMethod(tree_ptr);
+  estimator.setSearchMethod(getSearchTree());
   estimator.setRadiusSearch(radius);
   pcl::IndicesPtr indices_ptr(new std::vector<int>);
 
@@ -619,6 +770,67 @@ std::vector<std::vector<int>> Cloud::convertCameraSourceMatrixToLists() {
   return indices;
 }
 
+uint64_t Cloud::encodeMorton(const Eigen::Vector3i &cell) {
+  uint64_t code = 0;
+  for (int i = 0; i < 3; i++) {
+    uint64_t x = (uint64_t)cell(i) & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    code |= x << i;
+  }
+  return code;
+}
+
+void Cloud::sortKeys(std::vector<std::pair<uint64_t, int>> &keys,
+                     int num_threads) {
+  const int n = keys.size();
+  const int num_chunks = std::max(1, std::min(num_threads, n / 1024));
+  std::vector<int> bounds(num_chunks + 1);
+  for (int i = 0; i <= num_chunks; i++) {
+    bounds[i] = (int)((int64_t)n * i / num_chunks);
+  }
+
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_chunks)
+#endif
+  for (int i = 0; i < num_chunks; i++) {
+    std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+  }
+
+  // Merge neighboring chunks until only one chunk is left.
+  for (int width = 1; width < num_chunks; width *= 2) {
+#ifdef _OPENMP  // parallelization using OpenMP
+#pragma omp parallel for num_threads(num_chunks)
+#endif
+    for (int i = 0; i < num_chunks - width; i += 2 * width) {
+      const int mid = bounds[i + width];
+      const int last = bounds[std::min(i + 2 * width, num_chunks)];
+      std::inplace_merge(keys.begin() + bounds[i], keys.begin() + mid,
+                         keys.begin() + last);
+    }
+  }
+}
+
+const KdTreeRGB::Ptr &Cloud::getSearchTree() const {
+#ifdef _OPENMP
+#pragma omp critical(cloud_search_tree)
+#endif
+  {
+    if (!search_tree_ || search_tree_->getInputCloud() != cloud_processed_) {
+      double t0 = omp_get_wtime();
+      search_tree_.reset(new KdTreeRGB);
+      search_tree_->setInputCloud(cloud_processed_);
+      printf("Built kd-tree for %zu points in %3.4fs.\n",
+             cloud_processed_->size(), omp_get_wtime() - t0);
+    }
+  }
+
+  return search_tree_;
+}
+
 void Cloud::setNormalsFromFile(const std::string &filename) {
   std::ifstream in;
   in.open(filename.c_str());
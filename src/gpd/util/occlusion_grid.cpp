@@ -0,0 +1,87 @@
+#include <gpd/util/occlusion_grid.h>
+
+#include <algorithm>
+
+namespace gpd {
+namespace util {
+
+OcclusionGrid::OcclusionGrid(const Eigen::Vector3d &lower,
+                             const Eigen::Vector3d &upper, double voxel_size)
+    : voxel_size_(voxel_size) {
+  min_voxel_ = (lower / voxel_size).array().floor().cast<int>();
+  const Eigen::Vector3i max_voxel =
+      (upper / voxel_size).array().floor().cast<int>();
+  size_ = (max_voxel - min_voxel_ + Eigen::Vector3i::Ones()).cwiseMax(0);
+  const int64_t num_voxels = (int64_t)size_(0) * size_(1) * size_(2);
+  bits_.assign((num_voxels + 63) / 64, 0);
+}
+
+void OcclusionGrid::castRays(const Eigen::Matrix3Xd &points,
+                             const Eigen::Vector3d &ray) {
+  const double voxel_size_inv = 1.0 / voxel_size_;
+  const Eigen::Vector3d ray_voxels = ray * voxel_size_inv;
+
+  for (int i = 0; i < points.cols(); i++) {
+    const Eigen::Vector3d start = points.col(i) * voxel_size_inv;
+    traverseVoxels(start, start + ray_voxels,
+                   [this](const Eigen::Vector3i &voxel) { mark(voxel); });
+  }
+}
+
+void OcclusionGrid::intersect(const OcclusionGrid &other) {
+  for (std::size_t i = 0; i < bits_.size(); i++) {
+    bits_[i] &= other.bits_[i];
+  }
+}
+
+void OcclusionGrid::clear() { std::fill(bits_.begin(), bits_.end(), 0); }
+
+void OcclusionGrid::mark(const Eigen::Vector3i &voxel) {
+  const int64_t idx = toIndex(voxel);
+  if (idx >= 0) {
+    bits_[idx >> 6] |= (uint64_t)1 << (idx & 63);
+  }
+}
+
+bool OcclusionGrid::isMarked(const Eigen::Vector3i &voxel) const {
+  const int64_t idx = toIndex(voxel);
+  return idx >= 0 && ((bits_[idx >> 6] >> (idx & 63)) & 1);
+}
+
+int64_t OcclusionGrid::toIndex(const Eigen::Vector3i &voxel) const {
+  const Eigen::Vector3i v = voxel - min_voxel_;
+  if ((v.array() < 0).any() || (v.array() >= size_.array()).any()) {
+    return -1;
+  }
+  return v(0) + (int64_t)size_(0) * (v(1) + (int64_t)size_(1) * v(2));
+}
+
+std::vector<Eigen::Vector3i> OcclusionGrid::getMarkedVoxels() const {
+  std::vector<Eigen::Vector3i> voxels;
+  voxels.reserve(countMarked());
+  const int64_t plane = (int64_t)size_(0) * size_(1);
+
+  for (std::size_t i = 0; i < bits_.size(); i++) {
+    uint64_t word = bits_[i];
+    while (word != 0) {
+      const int64_t idx = i * 64 + __builtin_ctzll(word);
+      word &= word - 1;
+      voxels.push_back(min_voxel_ + Eigen::Vector3i(idx % size_(0),
+                                                    (idx % plane) / size_(0),
+                                                    idx / plane));
+    }
+  }
+
+  return voxels;
+}
+
+int OcclusionGrid::countMarked() const {
+  int count = 0;
+  for (std::size_t i = 0; i < bits_.size(); i++) {
+    count += __builtin_popcountll(bits_[i]);
+  }
+  return count;
+}
+
+}  // namespace util
+}  // namespace gpd
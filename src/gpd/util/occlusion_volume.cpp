@@ -0,0 +1,85 @@
+#include <gpd/util/occlusion_volume.h>
+
+namespace gpd {
+namespace util {
+
+void OcclusionVolume::castShadows(
+    const Eigen::Ref<const Eigen::Matrix3Xd> &points,
+    const Eigen::Vector3d &view_point, double length) {
+  const double voxel_size_inv = 1.0 / voxel_size_;
+
+  for (int i = 0; i < points.cols(); i++) {
+    Eigen::Vector3d shadow_vec = points.col(i) - view_point;
+    const double norm = shadow_vec.norm();
+    if (norm == 0.0) {
+      continue;
+    }
+    shadow_vec *= length / norm;
+
+    const Eigen::Vector3d start = points.col(i) * voxel_size_inv;
+    traverseVoxels(start, start + shadow_vec * voxel_size_inv,
+                   [this](const Eigen::Vector3i &voxel) { mark(voxel); });
+  }
+}
+
+void OcclusionVolume::merge(const OcclusionVolume &other) {
+  for (const auto &entry : other.bricks_) {
+    Brick &brick = bricks_.emplace(entry.first, Brick()).first->second;
+    for (int i = 0; i < brick.size(); i++) {
+      brick[i] |= entry.second[i];
+    }
+  }
+}
+
+void OcclusionVolume::crop(OcclusionGrid &grid) const {
+  // Find the bricks that overlap with the grid (>> 3 rounds towards negative
+  // infinity).
+  const Eigen::Vector3i &min_voxel = grid.getMinVoxel();
+  const Eigen::Vector3i max_voxel =
+      min_voxel + grid.getSize() - Eigen::Vector3i::Ones();
+  const Eigen::Vector3i min_brick(min_voxel(0) >> 3, min_voxel(1) >> 3,
+                                  min_voxel(2) >> 3);
+  const Eigen::Vector3i max_brick(max_voxel(0) >> 3, max_voxel(1) >> 3,
+                                  max_voxel(2) >> 3);
+
+  Eigen::Vector3i b;
+  for (b(2) = min_brick(2); b(2) <= max_brick(2); b(2)++) {
+    for (b(1) = min_brick(1); b(1) <= max_brick(1); b(1)++) {
+      for (b(0) = min_brick(0); b(0) <= max_brick(0); b(0)++) {
+        auto it = bricks_.find(toKey(b));
+        if (it == bricks_.end()) {
+          continue;
+        }
+
+        // Copy the occluded voxels (the grid ignores voxels outside of it).
+        const Brick &brick = it->second;
+        for (int z = 0; z < 8; z++) {
+          uint64_t word = brick[z];
+          while (word != 0) {
+            const int bit = __builtin_ctzll(word);
+            word &= word - 1;
+            grid.mark(Eigen::Vector3i(8 * b(0) + (bit & 7),
+                                      8 * b(1) + (bit >> 3), 8 * b(2) + z));
+          }
+        }
+      }
+    }
+  }
+}
+
+void OcclusionVolume::mark(const Eigen::Vector3i &voxel) {
+  const Eigen::Vector3i brick(voxel(0) >> 3, voxel(1) >> 3, voxel(2) >> 3);
+  Brick &words = bricks_.emplace(toKey(brick), Brick()).first->second;
+  words[voxel(2) & 7] |= (uint64_t)1 << ((voxel(0) & 7) + 8 * (voxel(1) & 7));
+}
+
+uint64_t OcclusionVolume::toKey(const Eigen::Vector3i &brick) {
+  // 21 bits per coordinate, offset to be non-negative.
+  const uint64_t mask = (1 << 21) - 1;
+  return ((uint64_t)(brick(0) + (1 << 20)) & mask) |
+         (((uint64_t)(brick(1) + (1 << 20)) & mask) << 21) |
+         (((uint64_t)(brick(2) + (1 << 20)) & mask) << 42);
+}
+
+}  // namespace util
+}  // namespace gpd
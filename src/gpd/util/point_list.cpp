@@ -19,6 +19,20 @@ PointList PointList::slice(const std::vector<int> &indices) const {
   return PointList(points_out, normals_out, cam_source_out, view_points_);
 }
 
+PointList PointList::slice(const std::vector<int> &indices, int size) const {
+  Eigen::Matrix3Xd points_out(3, size);
+  Eigen::Matrix3Xd normals_out(3, size);
+  Eigen::MatrixXi cam_source_out(cam_source_.rows(), size);
+
+  for (int j = 0; j < size; j++) {
+    points_out.col(j) = points_.col(indices[j]);
+    normals_out.col(j) = normals_.col(indices[j]);
+    cam_source_out.col(j) = cam_source_.col(indices[j]);
+  }
+
+  return PointList(points_out, normals_out, cam_source_out, view_points_);
+}
+
 PointList PointList::transformToHandFrame(
     const Eigen::Vector3d &centroid, const Eigen::Matrix3d &rotation) const {
   //  Eigen::Matrix3Xd points_centered = points_ - centroid.replicate(1,
@@ -50,6 +64,7 @@ PointList PointList::cropByHandHeight(double height, int dim) const {
       k++;
     }
   }
+  indices.resize(k);
 
   return slice(indices);
 }
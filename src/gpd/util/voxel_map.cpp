@@ -0,0 +1,131 @@
+#include <gpd/util/voxel_map.h>
+
+namespace gpd {
+namespace util {
+
+namespace {
+
+const int KEY_BITS = 21;
+const int KEY_OFFSET = 1 << (KEY_BITS - 1);
+const uint64_t KEY_MASK = (1ULL << KEY_BITS) - 1;
+
+}  // namespace
+
+VoxelMap::VoxelMap(double voxel_size)
+    : voxel_size_(voxel_size), num_updates_(0), num_recalculated_(0) {}
+
+void VoxelMap::update(Cloud &cloud, int num_threads, double normals_radius) {
+  double t0 = omp_get_wtime();
+  const PointCloudRGB::Ptr &points = cloud.getCloudProcessed();
+  const Eigen::MatrixXi &camera_source = cloud.getCameraSource();
+  const int n = points->size();
+
+  // 1. Look up the voxels of the cloud in the map. Voxels that are new or
+  // seen by other cameras have changed. The other voxels take the normal from
+  // the map.
+  std::vector<uint64_t> keys(n);
+  std::vector<int> cameras(n, 0);
+  std::vector<int> stamps(n, num_updates_);
+  std::unordered_map<uint64_t, int> indices;
+  indices.reserve(n);
+  Eigen::Matrix3Xd normals = Eigen::Matrix3Xd::Zero(3, n);
+  std::vector<Eigen::Vector3f> changed;
+
+  for (int i = 0; i < n; i++) {
+    const Eigen::Vector3f point = points->at(i).getVector3fMap();
+    keys[i] = toKey(point);
+    indices[keys[i]] = i;
+    for (int j = 0; j < camera_source.rows(); j++) {
+      if (camera_source(j, i) == 1) {
+        cameras[i] |= 1 << j;
+      }
+    }
+
+    std::unordered_map<uint64_t, Voxel>::const_iterator it =
+        voxels_.find(keys[i]);
+    if (it != voxels_.end() && it->second.cameras == cameras[i]) {
+      normals.col(i) = it->second.normal;
+      stamps[i] = it->second.stamp;
+    } else {
+      changed.push_back(point);
+    }
+  }
+
+  // 2. Voxels of the map that are not in the cloud have disappeared.
+  for (std::unordered_map<uint64_t, Voxel>::const_iterator it =
+           voxels_.begin();
+       it != voxels_.end(); it++) {
+    if (indices.count(it->first) == 0) {
+      changed.push_back(it->second.position);
+    }
+  }
+
+  // 3. Recalculate the normals of all points whose neighborhood contains a
+  // changed voxel.
+  Eigen::Array<bool, 1, Eigen::Dynamic> is_changed =
+      Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(n, voxels_.empty());
+  if (!voxels_.empty()) {
+    const KdTreeRGB &kdtree = *cloud.getSearchTree();
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    pcl::PointXYZRGBA query;
+
+    for (int i = 0; i < changed.size(); i++) {
+      query.getVector3fMap() = changed[i];
+      if (kdtree.radiusSearch(query, normals_radius, nn_indices, nn_dists) >
+          0) {
+        for (int j = 0; j < nn_indices.size(); j++) {
+          is_changed(nn_indices[j]) = true;
+        }
+      }
+    }
+  }
+
+  std::vector<int> recalculate;
+  for (int i = 0; i < n; i++) {
+    if (is_changed(i)) {
+      recalculate.push_back(i);
+      stamps[i] = num_updates_;
+    }
+  }
+  cloud.setNormals(normals);
+  cloud.calculateNormals(num_threads, normals_radius, recalculate);
+  num_recalculated_ = recalculate.size();
+
+  // 4. The cloud becomes the new map.
+  std::unordered_map<uint64_t, Voxel> voxels;
+  voxels.reserve(n);
+  for (int i = 0; i < n; i++) {
+    Voxel &voxel = voxels[keys[i]];
+    voxel.position = points->at(i).getVector3fMap();
+    voxel.normal = cloud.getNormals().col(i);
+    voxel.cameras = cameras[i];
+    voxel.stamp = stamps[i];
+  }
+  voxels_.swap(voxels);
+  num_updates_++;
+
+  cloud.setChangedMask(is_changed);
+
+  printf("Voxel map: %zu voxels changed, recalculated %d of %d normals in "
+         "%3.4fs.\n",
+         changed.size(), num_recalculated_, n, omp_get_wtime() - t0);
+}
+
+void VoxelMap::reset() {
+  voxels_.clear();
+  num_updates_ = 0;
+  num_recalculated_ = 0;
+}
+
+uint64_t VoxelMap::toKey(const Eigen::Vector3f &point) const {
+  // The points of an aligned voxel grid lie on multiples of the voxel size.
+  const Eigen::Vector3i voxel =
+      (point.cast<double>() / voxel_size_).array().round().cast<int>();
+  return ((uint64_t)((voxel(0) + KEY_OFFSET) & KEY_MASK) << (2 * KEY_BITS)) |
+         ((uint64_t)((voxel(1) + KEY_OFFSET) & KEY_MASK) << KEY_BITS) |
+         (uint64_t)((voxel(2) + KEY_OFFSET) & KEY_MASK);
+}
+
+}  // namespace util
+}  // namespace gpd
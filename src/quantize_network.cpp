@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/hdf.hpp>
+
+#include <gpd/net/eigen_classifier.h>
+
+namespace gpd {
+namespace apps {
+namespace quantize_network {
+
+const std::string IMAGES_DS_NAME = "images";
+const std::string LABELS_DS_NAME = "labels";
+const int BLOCK_SIZE = 1000;  ///< number of images read from the file at once
+
+/**
+ * \brief Read a block of images and labels from a HDF5 database created by
+ * `DataGenerator`.
+ * \param h5io the HDF5 database
+ * \param start the index of the first image
+ * \param count the number of images
+ * \param[out] images the images
+ * \param[out] labels the labels
+ */
+void readBlock(cv::Ptr<cv::hdf::HDF5> h5io, int start, int count,
+               net::ImageTensor &images, std::vector<uchar> &labels) {
+  std::vector<int> dims = h5io->dsgetsize(IMAGES_DS_NAME);
+  const int rows = dims[1];
+  const int cols = dims[2];
+  const int channels = dims[3];
+
+  cv::Mat images_mat;
+  std::vector<int> offsets = {start, 0, 0, 0};
+  std::vector<int> counts = {count, rows, cols, channels};
+  h5io->dsread(images_mat, IMAGES_DS_NAME, offsets, counts);
+
+  cv::Mat labels_mat;
+  std::vector<int> offsets_labels = {start, 0};
+  std::vector<int> counts_labels = {count, 1};
+  h5io->dsread(labels_mat, LABELS_DS_NAME, offsets_labels, counts_labels);
+
+  images.resize(count, rows, cols, channels);
+  labels.resize(count);
+  const size_t image_size = (size_t)rows * cols * channels;
+  for (int i = 0; i < count; i++) {
+    cv::Mat image(rows, cols, CV_8UC(channels),
+                  images_mat.ptr<uchar>() + i * image_size);
+    images.setImage(i, image);
+    labels[i] = labels_mat.at<uchar>(i);
+  }
+}
+
+int DoMain(int argc, char *argv[]) {
+  // Read arguments from command line.
+  if (argc < 3) {
+    std::cout << "Error: Not enough input arguments!\n\n";
+    std::cout << "Usage: quantize_network PARAMS_DIR HDF5_FILE "
+                 "[NUM_CALIBRATION_IMAGES] [NUM_TEST_IMAGES] [NUM_THREADS]\n\n";
+    std::cout << "Quantize the network in PARAMS_DIR to INT8 using the first "
+                 "NUM_CALIBRATION_IMAGES images in HDF5_FILE (*.h5), and "
+                 "compare the FP32 and INT8 networks on the next "
+                 "NUM_TEST_IMAGES images.\n\n";
+    std::cout << "The INT8 parameters are written to PARAMS_DIR. Set "
+                 "<precision = int8> in PARAMS_DIR/network.cfg to use them.\n";
+    return (-1);
+  }
+
+  const std::string params_dir = argv[1];
+  const std::string hdf5_filename = argv[2];
+  int num_calibration = (argc >= 4) ? std::stoi(argv[3]) : 1000;
+  int num_test = (argc >= 5) ? std::stoi(argv[4]) : 10000;
+  const int num_threads = (argc >= 6) ? std::stoi(argv[5]) : 4;
+
+  net::EigenClassifier classifier("", params_dir, net::Classifier::Device::eCPU,
+                                  0, num_threads);
+  classifier.setQuantized(false);
+
+  cv::Ptr<cv::hdf::HDF5> h5io = cv::hdf::open(hdf5_filename);
+  const int num_images = h5io->dsgetsize(IMAGES_DS_NAME)[0];
+  num_calibration = std::min(num_calibration, num_images);
+  num_test = std::min(num_test, num_images - num_calibration);
+  printf("Dataset: %d images, %d for calibration, %d for testing\n",
+         num_images, num_calibration, num_test);
+  if (num_calibration <= 0 || num_test <= 0) {
+    std::cout << "Error: Not enough images in " << hdf5_filename << "!\n";
+    h5io->close();
+    return (-1);
+  }
+
+  // Quantize the network with the calibration images.
+  net::ImageTensor float_images(net::ImageTensor::Layout::eNCHW,
+                                net::ImageTensor::Precision::eFP32);
+  std::vector<uchar> labels;
+  readBlock(h5io, 0, num_calibration, float_images, labels);
+  if (!classifier.quantize(float_images)) {
+    h5io->close();
+    return (-1);
+  }
+
+  // Compare the FP32 and the INT8 network on the test images.
+  net::ImageTensor byte_images(net::ImageTensor::Layout::eNCHW,
+                               net::ImageTensor::Precision::eU8);
+  int num_correct_fp32 = 0;
+  int num_correct_int8 = 0;
+  int num_agree = 0;
+  double t_fp32 = 0.0;
+  double t_int8 = 0.0;
+
+  for (int start = num_calibration; start < num_calibration + num_test;
+       start += BLOCK_SIZE) {
+    const int count = std::min(BLOCK_SIZE, num_calibration + num_test - start);
+    readBlock(h5io, start, count, float_images, labels);
+    readBlock(h5io, start, count, byte_images, labels);
+
+    classifier.setQuantized(false);
+    double t0 = omp_get_wtime();
+    std::vector<float> scores_fp32 = classifier.classifyImages(float_images);
+    t_fp32 += omp_get_wtime() - t0;
+
+    classifier.setQuantized(true);
+    t0 = omp_get_wtime();
+    std::vector<float> scores_int8 = classifier.classifyImages(byte_images);
+    t_int8 += omp_get_wtime() - t0;
+
+    for (int i = 0; i < count; i++) {
+      const bool is_positive_fp32 = scores_fp32[i] > 0.0f;
+      const bool is_positive_int8 = scores_int8[i] > 0.0f;
+      num_correct_fp32 += (is_positive_fp32 == (labels[i] == 1));
+      num_correct_int8 += (is_positive_int8 == (labels[i] == 1));
+      num_agree += (is_positive_fp32 == is_positive_int8);
+    }
+  }
+  h5io->close();
+
+  const double accuracy_fp32 = num_correct_fp32 / (double)num_test;
+  const double accuracy_int8 = num_correct_int8 / (double)num_test;
+  printf("============ QUANTIZATION ====================\n");
+  printf("FP32 accuracy: %3.4f, %3.6fs per image\n", accuracy_fp32,
+         t_fp32 / num_test);
+  printf("INT8 accuracy: %3.4f, %3.6fs per image\n", accuracy_int8,
+         t_int8 / num_test);
+  printf("accuracy delta: %+3.4f\n", accuracy_int8 - accuracy_fp32);
+  printf("same predictions: %3.4f\n", num_agree / (double)num_test);
+  printf("speedup: %3.2fx\n", t_fp32 / t_int8);
+  printf("==============================================\n");
+
+  if (!classifier.saveQuantizedWeights(params_dir)) {
+    return (-1);
+  }
+  printf("Wrote INT8 parameters to: %s\n", params_dir.c_str());
+
+  return 0;
+}
+
+}  // namespace quantize_network
+}  // namespace apps
+}  // namespace gpd
+
+int main(int argc, char *argv[]) {
+  return gpd::apps::quantize_network::DoMain(argc, argv);
+}
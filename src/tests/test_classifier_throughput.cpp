@@ -0,0 +1,86 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include <gpd/net/classifier.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+int DoMain(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cout << "Error: Not enough input arguments!\n\n";
+    std::cout << "Usage: test_classifier_throughput MODEL_FILE WEIGHTS_FILE "
+                 "[NUM_IMAGES] [BATCH_SIZE] [MAX_REQUESTS] [CHANNELS]\n\n";
+    std::cout << "Classify NUM_IMAGES random 60x60 images with 1, 2, 4, ... "
+                 "MAX_REQUESTS infer requests (OpenVINO) or threads (Eigen), "
+                 "and report the throughput.\n";
+    return (-1);
+  }
+
+  const std::string model_file = argv[1];
+  const std::string weights_file = argv[2];
+  const int num_images = (argc >= 4) ? std::stoi(argv[3]) : 1000;
+  const int batch_size = (argc >= 5) ? std::stoi(argv[4]) : 32;
+  const int max_requests = (argc >= 6) ? std::stoi(argv[5]) : 8;
+  const int channels = (argc >= 7) ? std::stoi(argv[6]) : 15;
+  const int size = 60;
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> pixel(0, 255);
+  cv::Mat image(size, size, CV_8UC(channels));
+  std::vector<float> reference;
+
+  printf("============ CLASSIFIER THROUGHPUT ===========\n");
+  printf("images: %d, batch size: %d\n", num_images, batch_size);
+
+  int num_mismatches = 0;
+  for (int num_requests = 1; num_requests <= max_requests; num_requests *= 2) {
+    std::shared_ptr<net::Classifier> classifier = net::Classifier::create(
+        model_file, weights_file, net::Classifier::Device::eCPU, batch_size,
+        num_requests);
+
+    net::ImageTensor images(classifier->getInputLayout(),
+                            classifier->getInputPrecision());
+    images.resize(num_images, size, size, channels);
+    gen.seed(0);
+    for (int i = 0; i < num_images; i++) {
+      for (int k = 0; k < size * size * channels; k++) {
+        image.data[k] = pixel(gen);
+      }
+      images.setImage(i, image);
+    }
+
+    // Warm up the classifier before timing it.
+    classifier->classifyImages(images);
+    const double t0 = omp_get_wtime();
+    std::vector<float> scores = classifier->classifyImages(images);
+    const double t = omp_get_wtime() - t0;
+    printf("requests: %d, %3.6fs, %3.1f images/s\n", num_requests, t,
+           num_images / t);
+
+    // The scores must not depend on the number of requests.
+    if (reference.empty()) {
+      reference = scores;
+    }
+    for (int i = 0; i < num_images; i++) {
+      num_mismatches += (std::abs(scores[i] - reference[i]) > 1e-4f);
+    }
+  }
+
+  printf("mismatches: %d\n", num_mismatches);
+  printf("==============================================\n");
+
+  return (num_mismatches == 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
@@ -0,0 +1,205 @@
+#include <random>
+#include <string>
+
+#include <omp.h>
+
+#include <gpd/candidate/finger_hand.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+/**
+ * Reference implementation of the finger placement evaluation that checks
+ * each finger placement against all points (brute force).
+ */
+struct ReferenceFingerHand {
+  ReferenceFingerHand(double finger_width, double hand_outer_diameter,
+                      double hand_depth, int num_placements)
+      : finger_width_(finger_width), hand_depth_(hand_depth) {
+    Eigen::VectorXd fs_half;
+    fs_half.setLinSpaced(num_placements, 0.0,
+                         hand_outer_diameter - finger_width);
+    finger_spacing_.resize(2 * num_placements);
+    finger_spacing_
+        << (fs_half.array() - hand_outer_diameter + finger_width_).matrix(),
+        fs_half;
+    fingers_ = Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(
+        1, 2 * num_placements, false);
+    hand_ = Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(1, num_placements,
+                                                           false);
+  }
+
+  void evaluateFingers(const Eigen::Matrix3Xd &points, double bite,
+                       int idx = -1) {
+    top_ = bite;
+    bottom_ = bite - hand_depth_;
+    fingers_.setConstant(false);
+
+    std::vector<int> cropped_indices;
+    for (int i = 0; i < points.cols(); i++) {
+      if (points(0, i) < bite) {
+        if (points(0, i) < bottom_) {
+          return;
+        }
+        cropped_indices.push_back(i);
+      }
+    }
+    if (cropped_indices.size() == 0) {
+      return;
+    }
+
+    if (idx == -1) {
+      for (int i = 0; i < fingers_.size(); i++) {
+        fingers_(i) = isGapFree(points, cropped_indices, i);
+      }
+    } else {
+      fingers_(idx) = isGapFree(points, cropped_indices, idx);
+      fingers_(fingers_.size() / 2 + idx) =
+          isGapFree(points, cropped_indices, fingers_.size() / 2 + idx);
+    }
+  }
+
+  bool isGapFree(const Eigen::Matrix3Xd &points,
+                 const std::vector<int> &indices, int idx) const {
+    for (int i = 0; i < indices.size(); i++) {
+      const double &x = points(1, indices[i]);
+      if (x > finger_spacing_(idx) &&
+          x < finger_spacing_(idx) + finger_width_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void evaluateHand() {
+    const int n = fingers_.size() / 2;
+    for (int i = 0; i < n; i++) {
+      hand_(i) = (fingers_(i) == true && fingers_(n + i) == true);
+    }
+  }
+
+  int deepenHand(const Eigen::Matrix3Xd &points, double min_depth,
+                 double max_depth, double deepen_step) {
+    std::vector<int> hand_idx;
+    for (int i = 0; i < hand_.cols(); i++) {
+      if (hand_(i) == true) {
+        hand_idx.push_back(i);
+      }
+    }
+    int hand_eroded_idx = hand_idx[ceil(hand_idx.size() / 2.0) - 1];
+    int opposite_idx = fingers_.size() / 2 + hand_eroded_idx;
+
+    ReferenceFingerHand new_hand = *this;
+    ReferenceFingerHand last_new_hand = new_hand;
+    for (double depth = min_depth + deepen_step; depth <= max_depth;
+         depth += deepen_step) {
+      new_hand.evaluateFingers(points, depth, hand_eroded_idx);
+      if (!new_hand.fingers_(hand_eroded_idx) ||
+          !new_hand.fingers_(opposite_idx)) {
+        break;
+      }
+      hand_(hand_eroded_idx) = true;
+      last_new_hand = new_hand;
+    }
+
+    *this = last_new_hand;
+    hand_.setConstant(false);
+    hand_(hand_eroded_idx) = true;
+    return hand_eroded_idx;
+  }
+
+  double finger_width_;
+  double hand_depth_;
+  double top_;
+  double bottom_;
+  Eigen::VectorXd finger_spacing_;
+  Eigen::Array<bool, 1, Eigen::Dynamic> fingers_;
+  Eigen::Array<bool, 1, Eigen::Dynamic> hand_;
+};
+
+int DoMain(int argc, char *argv[]) {
+  const int num_points = (argc >= 2) ? std::stoi(argv[1]) : 500;
+  const int num_runs = (argc >= 3) ? std::stoi(argv[2]) : 10000;
+  const int num_placements = (argc >= 4) ? std::stoi(argv[3]) : 10;
+
+  // Hand geometry parameters
+  const double finger_width = 0.01;
+  const double outer_diameter = 0.12;
+  const double depth = 0.06;
+  const double init_bite = 0.01;
+  const double max_depth = 0.10;
+  const double deepen_step = 0.005;
+
+  // Random point neighborhoods in the hand frame (forward, lateral, height).
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> forward(-0.04, 0.10);
+  std::uniform_real_distribution<double> lateral(-0.10, 0.10);
+  std::uniform_real_distribution<double> height(-0.02, 0.02);
+  std::vector<Eigen::Matrix3Xd> point_sets(num_runs);
+  for (int i = 0; i < num_runs; i++) {
+    // Vary the size of the object between the fingers.
+    const double width = 0.01 + 0.1 * (i % 10) / 10.0;
+    point_sets[i].resize(3, num_points);
+    for (int j = 0; j < num_points; j++) {
+      point_sets[i].col(j) << forward(gen), lateral(gen) * width / 0.1,
+          height(gen);
+    }
+  }
+
+  double t_reference = 0.0;
+  double t_sweep = 0.0;
+  int num_mismatches = 0;
+  int num_hands = 0;
+
+  for (int i = 0; i < num_runs; i++) {
+    const Eigen::Matrix3Xd &points = point_sets[i];
+
+    double t0 = omp_get_wtime();
+    ReferenceFingerHand reference(finger_width, outer_diameter, depth,
+                                  num_placements);
+    reference.evaluateFingers(points, init_bite);
+    reference.evaluateHand();
+    if (reference.hand_.any()) {
+      reference.deepenHand(points, init_bite, max_depth, deepen_step);
+    }
+    t_reference += omp_get_wtime() - t0;
+
+    t0 = omp_get_wtime();
+    candidate::FingerHand finger_hand(finger_width, outer_diameter, depth,
+                                      num_placements);
+    finger_hand.setForwardAxis(0);
+    finger_hand.setLateralAxis(1);
+    finger_hand.evaluateFingers(points, init_bite);
+    finger_hand.evaluateHand();
+    if (finger_hand.getHand().any()) {
+      finger_hand.deepenHand(points, init_bite, max_depth, deepen_step);
+      num_hands++;
+    }
+    t_sweep += omp_get_wtime() - t0;
+
+    if ((finger_hand.getFingers() != reference.fingers_).any() ||
+        (finger_hand.getHand() != reference.hand_).any() ||
+        finger_hand.getTop() != reference.top_ ||
+        finger_hand.getBottom() != reference.bottom_) {
+      num_mismatches++;
+    }
+  }
+
+  printf("============ FINGER HAND BENCHMARK ===========\n");
+  printf("points: %d, runs: %d, placements: %d, runs with hands: %d\n",
+         num_points, num_runs, num_placements, num_hands);
+  printf("brute force: %3.6fs per run\n", t_reference / num_runs);
+  printf("sweep line:  %3.6fs per run\n", t_sweep / num_runs);
+  printf("speedup: %3.2fx\n", t_reference / t_sweep);
+  printf("mismatches: %d\n", num_mismatches);
+  printf("==============================================\n");
+
+  return (num_mismatches == 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
@@ -0,0 +1,132 @@
+#include <random>
+
+#include <gpd/grasp_tracker.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+const double VOXEL_SIZE = 0.01;
+const double CHANGE_RADIUS = 0.03;
+const float NOISE = 0.002f;  // sensor jitter, well below the voxel size
+const Eigen::Vector3d BOX_CENTER(0.25, 0.25, 0.05);
+const Eigen::Vector3d FAR_POINT(0.02, 0.02, 0.0);
+
+/**
+ * Create a table (0.5 x 0.5 m at z = 0) with jitter on each point and,
+ * optionally, the top of a box (0.1 x 0.1 m around <BOX_CENTER>) on it.
+ */
+util::Cloud createScene(bool with_box, std::mt19937 &generator,
+                        int &num_box_points) {
+  std::uniform_real_distribution<float> jitter(-NOISE, NOISE);
+  util::PointCloudRGB::Ptr points(new util::PointCloudRGB);
+  pcl::PointXYZRGBA p;
+
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++) {
+      p.x = i * 0.005f + jitter(generator);
+      p.y = j * 0.005f + jitter(generator);
+      p.z = jitter(generator);
+      points->push_back(p);
+    }
+  }
+
+  num_box_points = 0;
+  if (with_box) {
+    for (int i = 0; i < 20; i++) {
+      for (int j = 0; j < 20; j++) {
+        p.x = BOX_CENTER(0) - 0.05 + i * 0.005f + jitter(generator);
+        p.y = BOX_CENTER(1) - 0.05 + j * 0.005f + jitter(generator);
+        p.z = BOX_CENTER(2) + jitter(generator);
+        points->push_back(p);
+        num_box_points++;
+      }
+    }
+  }
+
+  Eigen::MatrixXi camera_source = Eigen::MatrixXi::Ones(1, points->size());
+  Eigen::Matrix3Xd view_points = Eigen::Matrix3Xd::Zero(3, 1);
+  view_points(2, 0) = 1.0;
+  return util::Cloud(points, camera_source, view_points);
+}
+
+/**
+ * Mark the box points (the last <num_box_points> points) as changed, as the
+ * preprocessing does for new points (see util::VoxelMap).
+ */
+void setBoxChanged(util::Cloud &cloud, int num_box_points) {
+  const int n = cloud.getCloudProcessed()->size();
+  Eigen::Array<bool, 1, Eigen::Dynamic> mask =
+      Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(1, n, false);
+  mask.tail(num_box_points).setConstant(true);
+  cloud.setChangedMask(mask);
+}
+
+/**
+ * Feed the sequence table, jittered table, table with box, table (box removed)
+ * to a tracker. With <use_mask>, each cloud comes with a changed mask. Returns
+ * the number of steps where the tracker reports the wrong changes.
+ */
+int countMismatches(bool use_mask) {
+  std::mt19937 generator(0);
+  GraspTracker tracker(VOXEL_SIZE, CHANGE_RADIUS);
+  int num_box_points;
+  int num_mismatches = 0;
+
+  util::Cloud table = createScene(false, generator, num_box_points);
+  tracker.update(table);
+  num_mismatches +=
+      !(tracker.isChanged(FAR_POINT) && !tracker.hasPreviousFrame());
+
+  util::Cloud jittered = createScene(false, generator, num_box_points);
+  if (use_mask) {
+    setBoxChanged(jittered, num_box_points);
+  }
+  tracker.update(jittered);
+  num_mismatches += tracker.isChanged(BOX_CENTER) ||
+                    tracker.isChanged(FAR_POINT) ||
+                    tracker.getChangedFraction() != 0.0;
+
+  util::Cloud added = createScene(true, generator, num_box_points);
+  if (use_mask) {
+    setBoxChanged(added, num_box_points);
+  }
+  tracker.update(added);
+  num_mismatches +=
+      !tracker.isChanged(BOX_CENTER) || tracker.isChanged(FAR_POINT);
+
+  util::Cloud removed = createScene(false, generator, num_box_points);
+  if (use_mask) {
+    setBoxChanged(removed, num_box_points);
+  }
+  tracker.update(removed);
+  num_mismatches +=
+      !tracker.isChanged(BOX_CENTER) || tracker.isChanged(FAR_POINT);
+
+  // The samples that are selected are exactly those near the removed box.
+  Eigen::Matrix3Xd samples(3, 2);
+  samples << FAR_POINT, BOX_CENTER;
+  Eigen::Matrix3Xd selected = tracker.selectChanged(samples);
+  num_mismatches +=
+      selected.cols() != 1 || !selected.col(0).isApprox(BOX_CENTER);
+
+  return num_mismatches;
+}
+
+int DoMain(int argc, char *argv[]) {
+  const int num_mismatches_occupancy = countMismatches(false);
+  const int num_mismatches_mask = countMismatches(true);
+
+  printf("============ GRASP TRACKER TEST ============\n");
+  printf("mismatches (occupancy): %d\n", num_mismatches_occupancy);
+  printf("mismatches (changed mask): %d\n", num_mismatches_mask);
+  printf("============================================\n");
+
+  return (num_mismatches_occupancy + num_mismatches_mask == 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
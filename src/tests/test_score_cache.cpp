@@ -0,0 +1,127 @@
+#include <random>
+
+#include <gpd/score_cache.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+const double POSITION_RESOLUTION = 0.005;
+const double ORIENTATION_RESOLUTION = 0.05;
+
+/**
+ * Create a grasp candidate at a given sample with a given orientation. The
+ * closing region is the same for all candidates.
+ */
+candidate::Hand createHand(const Eigen::Vector3d &sample,
+                           const Eigen::Matrix3d &frame) {
+  candidate::FingerHand finger_hand(0.01, 0.10, 0.06, 10);
+  finger_hand.setBottom(-0.02);
+  finger_hand.setTop(0.04);
+  finger_hand.setCenter(0.0101);
+  return candidate::Hand(sample, frame, finger_hand);
+}
+
+util::Cloud createCloud(const util::PointCloudRGB::Ptr &points,
+                        const Eigen::Matrix3Xd &view_points) {
+  Eigen::MatrixXi camera_source = Eigen::MatrixXi::Ones(1, points->size());
+  return util::Cloud(points, camera_source, view_points);
+}
+
+int DoMain(int argc, char *argv[]) {
+  int num_mismatches = 0;
+
+  // 1. Create a random point cloud, a copy of it, a copy with one point moved
+  // and a copy seen from another camera position.
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> coordinate(-0.2f, 0.2f);
+  util::PointCloudRGB::Ptr points(new util::PointCloudRGB);
+  for (int i = 0; i < 1000; i++) {
+    pcl::PointXYZRGBA p;
+    p.x = coordinate(generator);
+    p.y = coordinate(generator);
+    p.z = 0.5f + coordinate(generator);
+    points->push_back(p);
+  }
+  util::PointCloudRGB::Ptr points_copy(new util::PointCloudRGB(*points));
+  util::PointCloudRGB::Ptr points_moved(new util::PointCloudRGB(*points));
+  points_moved->points[500].x += 0.001f;
+  Eigen::Matrix3Xd view_points = Eigen::Matrix3Xd::Zero(3, 1);
+  Eigen::Matrix3Xd view_points_other = Eigen::Matrix3Xd::Zero(3, 1);
+  view_points_other(0, 0) = 0.1;
+
+  const uint64_t hash = ScoreCache::hashCloud(createCloud(points, view_points));
+  const uint64_t hash_copy =
+      ScoreCache::hashCloud(createCloud(points_copy, view_points));
+  const uint64_t hash_moved =
+      ScoreCache::hashCloud(createCloud(points_moved, view_points));
+  const uint64_t hash_other =
+      ScoreCache::hashCloud(createCloud(points, view_points_other));
+  num_mismatches += (hash_copy != hash);
+  num_mismatches += (hash_moved == hash);
+  num_mismatches += (hash_other == hash);
+
+  // 2. A hit returns the stored score, also for a candidate that differs by
+  // less than the quantization resolution.
+  ScoreCache cache(3, POSITION_RESOLUTION, ORIENTATION_RESOLUTION);
+  const Eigen::Vector3d sample(0.1001, 0.2001, 0.3001);
+  const Eigen::Matrix3d frame = Eigen::Matrix3d::Identity();
+  const uint64_t key = cache.computeKey(createHand(sample, frame), hash);
+  cache.insert(key, 0.75f);
+  float score = 0.0f;
+  num_mismatches += !(cache.find(key, score) && score == 0.75f);
+
+  const Eigen::Vector3d jitter(0.0005, -0.0005, 0.0005);
+  const Eigen::Matrix3d frame_jitter =
+      Eigen::AngleAxisd(0.005, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  const uint64_t key_jitter =
+      cache.computeKey(createHand(sample + jitter, frame_jitter), hash);
+  num_mismatches += (key_jitter != key);
+
+  // 3. A shifted sample, a rotated frame or a different cloud is a miss.
+  const Eigen::Vector3d shift(0.01, 0.0, 0.0);
+  const Eigen::Matrix3d frame_rotated =
+      Eigen::AngleAxisd(0.2, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  const uint64_t misses[3] = {
+      cache.computeKey(createHand(sample + shift, frame), hash),
+      cache.computeKey(createHand(sample, frame_rotated), hash),
+      cache.computeKey(createHand(sample, frame), hash_moved)};
+  for (int i = 0; i < 3; i++) {
+    num_mismatches += cache.find(misses[i], score);
+  }
+  const long num_hits = cache.getNumHits();
+  const long num_misses = cache.getNumMisses();
+  num_mismatches += (num_hits != 1 || num_misses != 3);
+
+  // 4. At capacity, the least recently used entry is evicted. Looking up an
+  // entry makes it the most recently used one.
+  cache.clear();
+  cache.insert(1, 0.1f);
+  cache.insert(2, 0.2f);
+  cache.insert(3, 0.3f);
+  cache.find(1, score);
+  cache.insert(4, 0.4f);
+  num_mismatches += (cache.size() != 3);
+  num_mismatches += cache.find(2, score);
+  num_mismatches += !(cache.find(1, score) && score == 0.1f);
+  num_mismatches += !(cache.find(3, score) && score == 0.3f);
+  num_mismatches += !(cache.find(4, score) && score == 0.4f);
+
+  // 5. Inserting an existing key updates its score.
+  cache.insert(3, 0.9f);
+  num_mismatches += (cache.size() != 3);
+  num_mismatches += !(cache.find(3, score) && score == 0.9f);
+
+  printf("============ SCORE CACHE TEST ============\n");
+  printf("hits: %ld, misses: %ld (expected: 1, 3)\n", num_hits, num_misses);
+  printf("mismatches: %d\n", num_mismatches);
+  printf("==========================================\n");
+
+  return (num_mismatches == 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#include <gpd/top_k_selector.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+std::unique_ptr<candidate::Hand> createHand(double score) {
+  std::unique_ptr<candidate::Hand> hand = std::make_unique<candidate::Hand>();
+  hand->setScore(score);
+  return hand;
+}
+
+/**
+ * Reference selection: the <k> highest scores, in descending order.
+ */
+std::vector<double> selectReference(std::vector<double> scores, int k) {
+  const int num_selected = std::min(k, (int)scores.size());
+  std::partial_sort(scores.begin(), scores.begin() + num_selected,
+                    scores.end(), std::greater<double>());
+  scores.resize(num_selected);
+  return scores;
+}
+
+std::vector<double> getScores(
+    const std::vector<std::unique_ptr<candidate::Hand>> &hands) {
+  std::vector<double> scores(hands.size());
+  for (int i = 0; i < hands.size(); i++) {
+    scores[i] = hands[i]->getScore();
+  }
+  return scores;
+}
+
+/**
+ * Push all scores and compare the selection with the reference. A push must
+ * succeed exactly if canEnter() is true for the score.
+ */
+bool isSelectionCorrect(const std::vector<double> &scores, int k) {
+  TopKSelector selector(k);
+  bool is_consistent = true;
+
+  for (int i = 0; i < scores.size(); i++) {
+    const bool can_enter = selector.canEnter(scores[i]);
+    if (selector.push(createHand(scores[i])) != can_enter) {
+      is_consistent = false;
+    }
+  }
+
+  const bool is_full_size = selector.size() == std::min(k, (int)scores.size());
+  std::vector<std::unique_ptr<candidate::Hand>> hands = selector.extract();
+  return is_consistent && is_full_size && selector.size() == 0 &&
+         getScores(hands) == selectReference(scores, k);
+}
+
+/**
+ * Select grasps the way GraspDetector does: in the order of an upper bound on
+ * their score, skipping those whose bound cannot enter the selection. The
+ * result has to be the same as without skipping.
+ */
+bool isBoundCorrect(const std::vector<double> &scores,
+                    const std::vector<double> &bounds, int k,
+                    int &num_skipped) {
+  std::vector<int> order(scores.size());
+  for (int i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&bounds](int a, int b) { return bounds[a] > bounds[b]; });
+
+  TopKSelector selector(k);
+  for (int i = 0; i < order.size(); i++) {
+    if (!selector.canEnter(bounds[order[i]])) {
+      num_skipped++;
+      continue;
+    }
+    selector.push(createHand(scores[order[i]]));
+  }
+
+  std::vector<std::unique_ptr<candidate::Hand>> hands = selector.extract();
+  return getScores(hands) == selectReference(scores, k);
+}
+
+int DoMain(int argc, char *argv[]) {
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::uniform_int_distribution<int> level(0, 9);  // many ties
+  std::uniform_real_distribution<double> margin(0.0, 0.2);
+  const int sizes[] = {0, 1, 2, 10, 100, 1000};
+  int num_cases = 0;
+  int num_skipped = 0;
+  int num_mismatches = 0;
+
+  for (int n : sizes) {
+    for (int trial = 0; trial < 10; trial++) {
+      std::vector<double> scores(n);
+      std::vector<double> tied(n);
+      std::vector<double> bounds(n);
+      for (int i = 0; i < n; i++) {
+        scores[i] = uniform(generator);
+        tied[i] = 0.1 * level(generator);
+        bounds[i] = scores[i] + margin(generator);
+      }
+
+      const int ks[] = {0, 1, 5, n / 2, n, n + 3};
+      for (int k : ks) {
+        num_mismatches += !isSelectionCorrect(scores, k);
+        num_mismatches += !isSelectionCorrect(tied, k);
+        num_mismatches += !isBoundCorrect(scores, bounds, k, num_skipped);
+        num_mismatches += !isBoundCorrect(tied, tied, k, num_skipped);
+        num_cases += 4;
+      }
+    }
+  }
+
+  printf("============ TOP-K SELECTOR TEST =============\n");
+  printf("cases: %d, candidates skipped by the bound: %d\n", num_cases,
+         num_skipped);
+  printf("mismatches: %d\n", num_mismatches);
+  printf("==============================================\n");
+
+  return (num_mismatches == 0 && num_skipped > 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
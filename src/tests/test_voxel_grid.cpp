@@ -0,0 +1,204 @@
+#include <cmath>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <omp.h>
+
+#include <gpd/util/cloud.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+/**
+ * Return the order of the voxels sorted lexicographically by their position,
+ * so that two voxelizations can be compared independently of their output
+ * order.
+ */
+std::vector<int> sortVoxels(const util::PointCloudRGB &cloud) {
+  std::vector<int> order(cloud.size());
+  for (int i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&cloud](int a, int b) {
+    const float *pa = cloud.points[a].data;
+    const float *pb = cloud.points[b].data;
+    return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+  });
+  return order;
+}
+
+/**
+ * Compare the voxels, surface normals and camera sources of two voxelized
+ * clouds.
+ *
+ * The camera source of a voxel from voxelizeCloudParallel() is the union over
+ * its points, while voxelizeCloud() takes it from a single point. So the
+ * camera source of <cloud_set> has to be contained in that of
+ * <cloud_parallel>, and that of <cloud_parallel> has to equal <union_source>.
+ */
+bool compareVoxels(const util::Cloud &cloud_set,
+                   const util::Cloud &cloud_parallel,
+                   const Eigen::MatrixXi &union_source) {
+  const util::PointCloudRGB &points_set = *cloud_set.getCloudProcessed();
+  const util::PointCloudRGB &points_parallel =
+      *cloud_parallel.getCloudProcessed();
+  if (points_set.size() != points_parallel.size()) {
+    printf("different number of voxels\n");
+    return false;
+  }
+
+  const std::vector<int> order_set = sortVoxels(points_set);
+  const std::vector<int> order_parallel = sortVoxels(points_parallel);
+  int num_positions = 0;
+  int num_normals = 0;
+  int num_sources = 0;
+
+  for (int i = 0; i < order_set.size(); i++) {
+    const int a = order_set[i];
+    const int b = order_parallel[i];
+    if (points_set.points[a].getVector3fMap() !=
+        points_parallel.points[b].getVector3fMap()) {
+      num_positions++;
+    }
+    const Eigen::Vector3d normal_set = cloud_set.getNormals().col(a);
+    const Eigen::Vector3d normal_parallel = cloud_parallel.getNormals().col(b);
+    if (!(normal_set.hasNaN() && normal_parallel.hasNaN()) &&
+        !((normal_set - normal_parallel).norm() <= 1e-9)) {
+      num_normals++;
+    }
+    const Eigen::VectorXi source_set = cloud_set.getCameraSource().col(a);
+    const Eigen::VectorXi source_parallel =
+        cloud_parallel.getCameraSource().col(b);
+    if ((source_set.array() > source_parallel.array()).any() ||
+        source_parallel != union_source.col(b)) {
+      num_sources++;
+    }
+  }
+
+  printf("mismatches: %d positions, %d normals, %d camera sources\n",
+         num_positions, num_normals, num_sources);
+  return num_positions == 0 && num_normals == 0 && num_sources == 0;
+}
+
+/**
+ * Calculate the union of the camera sources of the points in each voxel of
+ * the parallel voxelization (brute force).
+ */
+Eigen::MatrixXi unionCameraSource(const util::PointCloudRGB &points,
+                                  const Eigen::MatrixXi &camera_source,
+                                  const util::PointCloudRGB &voxels,
+                                  float voxel_size) {
+  Eigen::Vector3f min_pt = points.points[0].getVector3fMap();
+  for (int i = 1; i < points.size(); i++) {
+    min_pt = min_pt.cwiseMin(points.points[i].getVector3fMap());
+  }
+  auto cell = [&min_pt, voxel_size](const Eigen::Vector3f &p) {
+    return std::make_tuple(
+        (int)std::floor((p(0) - min_pt(0)) / voxel_size),
+        (int)std::floor((p(1) - min_pt(1)) / voxel_size),
+        (int)std::floor((p(2) - min_pt(2)) / voxel_size));
+  };
+
+  std::map<std::tuple<int, int, int>, Eigen::VectorXi> sources;
+  for (int i = 0; i < points.size(); i++) {
+    auto it = sources
+                  .insert(std::make_pair(
+                      cell(points.points[i].getVector3fMap()),
+                      Eigen::VectorXi::Zero(camera_source.rows())))
+                  .first;
+    it->second = it->second.cwiseMax(camera_source.col(i));
+  }
+
+  // The voxel positions are the lower corners of their cells, so they are
+  // looked up at the center of the cell.
+  Eigen::MatrixXi union_source(camera_source.rows(), voxels.size());
+  for (int i = 0; i < voxels.size(); i++) {
+    const Eigen::Vector3f center =
+        voxels.points[i].getVector3fMap() +
+        Eigen::Vector3f::Constant(0.5f * voxel_size);
+    union_source.col(i) = sources[cell(center)];
+  }
+  return union_source;
+}
+
+int DoMain(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cout << "ERROR: Not enough arguments given!\n";
+    std::cout << "Usage: test_voxel_grid INPUT_FILE [VOXEL_SIZE] "
+                 "[NUM_THREADS] [NUM_RUNS]\n";
+    return -1;
+  }
+
+  const float voxel_size = (argc >= 3) ? std::stof(argv[2]) : 0.003f;
+  const int num_threads = (argc >= 4) ? std::stoi(argv[3]) : 4;
+  const int num_runs = (argc >= 5) ? std::stoi(argv[4]) : 10;
+
+  // Load the point cloud and calculate surface normals once.
+  Eigen::Matrix3Xd view_points = Eigen::Matrix3Xd::Zero(3, 1);
+  util::Cloud cloud(argv[1], view_points);
+  if (cloud.getCloudOriginal()->size() == 0) {
+    std::cout << "Error: Input point cloud is empty or does not exist!\n";
+    return -1;
+  }
+  cloud.removeNans();
+  cloud.calculateNormals(num_threads, 0.03);
+  util::PointCloudRGB::Ptr points = cloud.getCloudProcessed();
+  const Eigen::Matrix3Xd normals = cloud.getNormals();
+
+  // Pretend that the points are seen by two cameras, with some points seen by
+  // both, so that the camera sources of the points in a voxel differ.
+  view_points.conservativeResize(3, 2);
+  view_points.col(1) << 1.0, 0.0, 0.0;
+  Eigen::MatrixXi camera_source(2, points->size());
+  for (int i = 0; i < points->size(); i++) {
+    camera_source(0, i) = (i % 3 != 2) ? 1 : 0;
+    camera_source(1, i) = (i % 3 != 0) ? 1 : 0;
+  }
+
+  // Both methods modify the cloud, so each run starts from a fresh copy.
+  double t_set = 0.0;
+  double t_parallel = 0.0;
+  util::Cloud cloud_set;
+  util::Cloud cloud_parallel;
+  for (int i = 0; i < num_runs; i++) {
+    cloud_set = util::Cloud(points, camera_source, view_points);
+    cloud_set.setNormals(normals);
+    double t0 = omp_get_wtime();
+    cloud_set.voxelizeCloud(voxel_size);
+    t_set += omp_get_wtime() - t0;
+
+    cloud_parallel = util::Cloud(points, camera_source, view_points);
+    cloud_parallel.setNormals(normals);
+    t0 = omp_get_wtime();
+    cloud_parallel.voxelizeCloudParallel(voxel_size, num_threads);
+    t_parallel += omp_get_wtime() - t0;
+  }
+
+  // Compare the voxels of both methods.
+  const Eigen::MatrixXi union_source =
+      unionCameraSource(*points, camera_source,
+                        *cloud_parallel.getCloudProcessed(), voxel_size);
+  const bool is_equal = compareVoxels(cloud_set, cloud_parallel, union_source);
+
+  printf("============ VOXEL GRID BENCHMARK ============\n");
+  printf("points: %zu, voxel_size: %.4f, threads: %d, runs: %d\n",
+         points->size(), voxel_size, num_threads, num_runs);
+  printf("set:      %zu voxels, %3.4fs per run\n",
+         cloud_set.getCloudProcessed()->size(), t_set / num_runs);
+  printf("parallel: %zu voxels, %3.4fs per run\n",
+         cloud_parallel.getCloudProcessed()->size(), t_parallel / num_runs);
+  printf("speedup: %3.2fx\n", t_set / t_parallel);
+  printf("same voxels, normals and camera sources: %s\n",
+         is_equal ? "true" : "false");
+  printf("==============================================\n");
+
+  return is_equal ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }
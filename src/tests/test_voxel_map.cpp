@@ -0,0 +1,132 @@
+#include <gpd/util/voxel_map.h>
+
+namespace gpd {
+namespace test {
+namespace {
+
+const float VOXEL_SIZE = 0.005f;
+// Squared distances between voxels are integer multiples of VOXEL_SIZE^2, so
+// no voxel lies exactly on the radius.
+const double NORMALS_RADIUS = 4.2 * VOXEL_SIZE;
+const int NUM_THREADS = 4;
+
+/**
+ * Create a voxelized table (0.3 x 0.3 m) with a patch (0.05 x 0.05 m) that is
+ * raised by 2 cm at a given position.
+ */
+util::Cloud createScene(const Eigen::Vector2i &patch) {
+  util::PointCloudRGB::Ptr points(new util::PointCloudRGB);
+  pcl::PointXYZRGBA p;
+
+  for (int i = 0; i < 60; i++) {
+    for (int j = 0; j < 60; j++) {
+      const bool is_patch = i >= patch(0) && i < patch(0) + 10 &&
+                            j >= patch(1) && j < patch(1) + 10;
+      p.x = (i + 0.5f) * VOXEL_SIZE;
+      p.y = (j + 0.5f) * VOXEL_SIZE;
+      p.z = ((is_patch ? 4 : 0) + 0.5f) * VOXEL_SIZE;
+      points->push_back(p);
+    }
+  }
+
+  Eigen::MatrixXi camera_source = Eigen::MatrixXi::Ones(1, points->size());
+  Eigen::Matrix3Xd view_points(3, 1);
+  view_points << 0.15, 0.15, 1.0;
+  util::Cloud cloud(points, camera_source, view_points);
+  cloud.voxelizeCloud(VOXEL_SIZE, true);
+  return cloud;
+}
+
+/**
+ * Find the points of a cloud that are within the normals radius of a voxel
+ * that is only in one of two clouds (brute force).
+ */
+Eigen::Array<bool, 1, Eigen::Dynamic> findAffected(const util::Cloud &cloud,
+                                                   const util::Cloud &other) {
+  const util::PointCloudRGB &points = *cloud.getCloudProcessed();
+  const util::PointCloudRGB &points_other = *other.getCloudProcessed();
+  std::vector<Eigen::Vector3f> changed;
+
+  for (int k = 0; k < 2; k++) {
+    const util::PointCloudRGB &a = (k == 0) ? points : points_other;
+    const util::PointCloudRGB &b = (k == 0) ? points_other : points;
+    for (int i = 0; i < a.size(); i++) {
+      bool is_found = false;
+      for (int j = 0; j < b.size() && !is_found; j++) {
+        is_found = (a[i].getVector3fMap() - b[j].getVector3fMap()).norm() <
+                   0.5f * VOXEL_SIZE;
+      }
+      if (!is_found) {
+        changed.push_back(a[i].getVector3fMap());
+      }
+    }
+  }
+
+  Eigen::Array<bool, 1, Eigen::Dynamic> is_affected =
+      Eigen::Array<bool, 1, Eigen::Dynamic>::Constant(1, points.size(), false);
+  for (int i = 0; i < points.size(); i++) {
+    for (int j = 0; j < changed.size() && !is_affected(i); j++) {
+      is_affected(i) =
+          (points[i].getVector3fMap() - changed[j]).norm() <= NORMALS_RADIUS;
+    }
+  }
+  return is_affected;
+}
+
+int DoMain(int argc, char *argv[]) {
+  util::VoxelMap map(VOXEL_SIZE);
+  int num_mismatches = 0;
+
+  // 1. The first cloud has all of its normals calculated.
+  util::Cloud first = createScene(Eigen::Vector2i(10, 10));
+  map.update(first, NUM_THREADS, NORMALS_RADIUS);
+  const int n = first.getCloudProcessed()->size();
+  num_mismatches +=
+      !(map.getNumRecalculated() == n && first.getChangedMask().all());
+
+  // 2. An unchanged cloud keeps all normals, and no point is marked.
+  util::Cloud same = createScene(Eigen::Vector2i(10, 10));
+  map.update(same, NUM_THREADS, NORMALS_RADIUS);
+  num_mismatches += (map.getNumRecalculated() != 0);
+  num_mismatches +=
+      (same.getChangedMask().size() != n || same.getChangedMask().any());
+  num_mismatches += !same.getNormals().isApprox(first.getNormals());
+
+  // 3. Moving the patch recalculates exactly the normals of the points within
+  // the normals radius of the old and the new patch.
+  util::Cloud moved = createScene(Eigen::Vector2i(40, 40));
+  map.update(moved, NUM_THREADS, NORMALS_RADIUS);
+  const Eigen::Array<bool, 1, Eigen::Dynamic> is_affected =
+      findAffected(moved, same);
+  const Eigen::Array<bool, 1, Eigen::Dynamic> &changed_mask =
+      moved.getChangedMask();
+  const int num_recalculated = map.getNumRecalculated();
+  num_mismatches += (num_recalculated == 0 ||
+                     num_recalculated == moved.getCloudProcessed()->size());
+  num_mismatches += !(changed_mask.size() == is_affected.size() &&
+                      (changed_mask == is_affected).all() &&
+                      num_recalculated == is_affected.count());
+
+  // 4. All normals, recalculated or kept, equal those of a full calculation.
+  util::Cloud full(moved.getCloudProcessed(), moved.getCameraSource(),
+                   moved.getViewPoints());
+  full.calculateNormals(NUM_THREADS, NORMALS_RADIUS);
+  const double max_error =
+      (moved.getNormals() - full.getNormals()).colwise().norm().maxCoeff();
+  num_mismatches += (max_error >= 1e-5);
+
+  printf("============ VOXEL MAP TEST ============\n");
+  printf("normals recalculated after the move: %d of %d\n", num_recalculated,
+         (int)moved.getCloudProcessed()->size());
+  printf("max. normal difference to full calculation: %.3e\n", max_error);
+  printf("mismatches: %d\n", num_mismatches);
+  printf("========================================\n");
+
+  return (num_mismatches == 0) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace gpd
+
+int main(int argc, char *argv[]) { return gpd::test::DoMain(argc, argv); }